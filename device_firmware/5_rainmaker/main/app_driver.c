@@ -59,6 +59,14 @@ void app_driver_init()
         .duty_resolution = LEDC_TIMER_11_BIT,
     };
     ESP_ERROR_CHECK(light_driver_init(&driver_config));
+
+    /**
+     * @brief The sliders of the phone app send a stream of updates while dragged, move along it smoothly.
+     *        Follow is off by default and only takes commands without a transition of their own,
+     *        so this example sends none and applies the Transition parameter as the fade period
+     */
+    ESP_ERROR_CHECK(light_driver_set_follow(true, FOLLOW_MAX_RATE));
+
     app_light_set_power(true);
 }
 
@@ -84,8 +92,16 @@ bool app_driver_get_state(void)
     return g_output_state;
 }
 
+esp_err_t app_light_set_transition(uint32_t transition_ms)
+{
+    /**< Not a transition of each command, it would end the streams that are followed */
+    return light_driver_config(transition_ms, LIGHT_BLINK_PERIOD_MS);
+}
+
 esp_err_t app_light_set_power(bool power)
 {
+    g_output_state = power;
+
     if (power) {
         // light on
         light_driver_set_switch(true);
@@ -98,7 +114,7 @@ esp_err_t app_light_set_power(bool power)
 
 esp_err_t app_light_set(uint32_t hue, uint32_t saturation, uint32_t brightness)
 {
-    return light_driver_set_hsv(hue,saturation, brightness);
+    return light_driver_set_hsv(hue, saturation, brightness);
 }
 
 esp_err_t app_light_set_brightness(uint16_t brightness)
@@ -106,6 +122,21 @@ esp_err_t app_light_set_brightness(uint16_t brightness)
     return light_driver_set_brightness(brightness);
 }
 
+esp_err_t app_light_set_cct(uint16_t kelvin)
+{
+    return light_driver_set_kelvin(kelvin);
+}
+
+uint16_t app_light_get_cct(void)
+{
+    return light_driver_get_cct();
+}
+
+esp_err_t app_light_get_cct_range(uint16_t *kelvin_min, uint16_t *kelvin_max)
+{
+    return light_driver_get_cct_range(kelvin_min, kelvin_max);
+}
+
 esp_err_t app_light_set_hue(uint16_t hue)
 {
     return light_driver_set_hue(hue);
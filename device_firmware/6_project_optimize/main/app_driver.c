@@ -22,6 +22,7 @@
 #define TAG "app_driver"
 
 static bool g_output_state = true;
+static uint32_t g_transition_ms = LIGHT_TRANSITION_DEFAULT;
 
 static void push_btn_cb(void *arg)
 {
@@ -59,6 +60,7 @@ void app_driver_init()
         .duty_resolution = LEDC_TIMER_11_BIT,
     };
     ESP_ERROR_CHECK(light_driver_init(&driver_config));
+
     app_light_set_power(true);
 }
 
@@ -84,16 +86,24 @@ bool app_driver_get_state(void)
     return g_output_state;
 }
 
+esp_err_t app_light_set_transition(uint32_t transition_ms)
+{
+    g_transition_ms = transition_ms;
+    return ESP_OK;
+}
+
 esp_err_t app_light_set_power(bool power)
 {
+    g_output_state = power;
+
     if (power) {
         // PM Lock
         app_pm_lock_acquire();
         // light on
-        light_driver_set_switch(true);
+        light_driver_set_switch_ex(true, g_transition_ms);
     } else {
         // light off
-        light_driver_set_switch(false);
+        light_driver_set_switch_ex(false, g_transition_ms);
         // PM UnLock
         app_pm_lock_release();
     }
@@ -102,20 +112,35 @@ esp_err_t app_light_set_power(bool power)
 
 esp_err_t app_light_set(uint32_t hue, uint32_t saturation, uint32_t brightness)
 {
-    return light_driver_set_hsv(hue,saturation, brightness);
+    return light_driver_set_hsv_ex(hue, saturation, brightness, g_transition_ms);
 }
 
 esp_err_t app_light_set_brightness(uint16_t brightness)
 {
-    return light_driver_set_brightness(brightness);
+    return light_driver_set_brightness_ex(brightness, g_transition_ms);
+}
+
+esp_err_t app_light_set_cct(uint16_t kelvin)
+{
+    return light_driver_set_kelvin_ex(kelvin, g_transition_ms);
+}
+
+uint16_t app_light_get_cct(void)
+{
+    return light_driver_get_cct();
+}
+
+esp_err_t app_light_get_cct_range(uint16_t *kelvin_min, uint16_t *kelvin_max)
+{
+    return light_driver_get_cct_range(kelvin_min, kelvin_max);
 }
 
 esp_err_t app_light_set_hue(uint16_t hue)
 {
-    return light_driver_set_hue(hue);
+    return light_driver_set_hue_ex(hue, g_transition_ms);
 }
 
 esp_err_t app_light_set_saturation(uint16_t saturation)
 {
-    return light_driver_set_saturation(saturation);
+    return light_driver_set_saturation_ex(saturation, g_transition_ms);
 }
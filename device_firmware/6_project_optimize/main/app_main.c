@@ -33,6 +33,7 @@
 #include "app_wifi.h"
 #include "app_storage.h"
 #include "app_priv.h"
+#include "light_driver.h"
 
 static const char *TAG = "performance_optimize";
 
@@ -65,6 +66,20 @@ static esp_err_t write_cb(const esp_rmaker_device_t *device, const esp_rmaker_pa
         ESP_LOGI(TAG, "Received value = %d for %s - %s",
                 val.val.i, device_name, param_name);
         app_light_set_saturation(val.val.i);
+    } else if (strcmp(param_name, CCT_PARAM_NAME) == 0) {
+        ESP_LOGI(TAG, "Received value = %d for %s - %s",
+                val.val.i, device_name, param_name);
+        uint16_t kelvin_min = 0, kelvin_max = 0;
+        app_light_get_cct_range(&kelvin_min, &kelvin_max);
+        int kelvin = (val.val.i < kelvin_min) ? kelvin_min : (val.val.i > kelvin_max) ? kelvin_max : val.val.i;
+        app_light_set_cct(kelvin);
+        /* Report the temperature clamped to the LEDs, the light task applies it shortly after */
+        esp_rmaker_param_update_and_report(param, esp_rmaker_int(kelvin));
+        return ESP_OK;
+    } else if (strcmp(param_name, TRANSITION_PARAM_NAME) == 0) {
+        ESP_LOGI(TAG, "Received value = %d for %s - %s",
+                val.val.i, device_name, param_name);
+        app_light_set_transition(val.val.i);
     } else {
         /* Silently ignoring invalid params */
         return ESP_OK;
@@ -73,6 +88,56 @@ static esp_err_t write_cb(const esp_rmaker_device_t *device, const esp_rmaker_pa
     return ESP_OK;
 }
 
+/**
+ * @brief Report a param if the cloud does not have its value yet, e.g. after the button was pressed
+ */
+static void app_param_report(const char *name, esp_rmaker_param_val_t val)
+{
+    esp_rmaker_param_t *param = esp_rmaker_device_get_param_by_name(light_device, name);
+    esp_rmaker_param_val_t *current = param ? esp_rmaker_param_get_val(param) : NULL;
+
+    if (!current) {
+        return;
+    }
+
+    if (current->type == val.type && ((val.type == RMAKER_VAL_TYPE_BOOLEAN) ? current->val.b == val.val.b
+                                      : current->val.i == val.val.i)) {
+        return;
+    }
+
+    esp_rmaker_param_update_and_report(param, val);
+}
+
+/* Observer of the light driver, pushes every change of the light to RainMaker whatever its source */
+static void app_light_report(light_handle_t handle, const light_driver_state_t *state, void *arg)
+{
+    if (state->changed & LIGHT_CHANGE_ON) {
+        app_param_report(ESP_RMAKER_DEF_POWER_NAME, esp_rmaker_bool(state->on));
+    }
+
+    if (state->mode == MODE_HSV) {
+        if (state->changed & (LIGHT_CHANGE_MODE | LIGHT_CHANGE_HUE)) {
+            app_param_report(ESP_RMAKER_DEF_HUE_NAME, esp_rmaker_int(state->hue));
+        }
+
+        if (state->changed & (LIGHT_CHANGE_MODE | LIGHT_CHANGE_SATURATION)) {
+            app_param_report(ESP_RMAKER_DEF_SATURATION_NAME, esp_rmaker_int(state->saturation));
+        }
+
+        if (state->changed & (LIGHT_CHANGE_MODE | LIGHT_CHANGE_VALUE)) {
+            app_param_report(ESP_RMAKER_DEF_BRIGHTNESS_NAME, esp_rmaker_int(state->value));
+        }
+    } else if (state->mode == MODE_CTB) {
+        if (state->changed & (LIGHT_CHANGE_MODE | LIGHT_CHANGE_BRIGHTNESS)) {
+            app_param_report(ESP_RMAKER_DEF_BRIGHTNESS_NAME, esp_rmaker_int(state->brightness));
+        }
+
+        if ((state->changed & (LIGHT_CHANGE_MODE | LIGHT_CHANGE_KELVIN)) && state->kelvin) {
+            app_param_report(CCT_PARAM_NAME, esp_rmaker_int(state->kelvin));
+        }
+    }
+}
+
 void app_main()
 {    
     int i = 0;
@@ -123,8 +188,28 @@ void app_main()
     esp_rmaker_device_add_param(light_device, esp_rmaker_hue_param_create(ESP_RMAKER_DEF_HUE_NAME, DEFAULT_HUE));
     esp_rmaker_device_add_param(light_device, esp_rmaker_saturation_param_create(ESP_RMAKER_DEF_SATURATION_NAME, DEFAULT_SATURATION));
 
+    /* Colour temperature of the white LEDs in Kelvin, the light driver stores it */
+    uint16_t cct_min = 0, cct_max = 0;
+    app_light_get_cct_range(&cct_min, &cct_max);
+    esp_rmaker_param_t *cct_param = esp_rmaker_param_create(CCT_PARAM_NAME, CCT_PARAM_TYPE,
+            esp_rmaker_int(app_light_get_cct()), PROP_FLAG_READ | PROP_FLAG_WRITE);
+    esp_rmaker_param_add_ui_type(cct_param, ESP_RMAKER_UI_SLIDER);
+    esp_rmaker_param_add_bounds(cct_param, esp_rmaker_int(cct_min), esp_rmaker_int(cct_max), esp_rmaker_int(100));
+    esp_rmaker_device_add_param(light_device, cct_param);
+
+    /* Fade time in ms of the following changes, 0 applies them at once */
+    esp_rmaker_param_t *transition_param = esp_rmaker_param_create(TRANSITION_PARAM_NAME, TRANSITION_PARAM_TYPE,
+            esp_rmaker_int(DEFAULT_TRANSITION), PROP_FLAG_READ | PROP_FLAG_WRITE | PROP_FLAG_PERSIST);
+    esp_rmaker_param_add_ui_type(transition_param, ESP_RMAKER_UI_SLIDER);
+    esp_rmaker_param_add_bounds(transition_param, esp_rmaker_int(0), esp_rmaker_int(TRANSITION_MAX), esp_rmaker_int(100));
+    esp_rmaker_device_add_param(light_device, transition_param);
+    app_light_set_transition(esp_rmaker_param_get_val(transition_param)->val.i);
+
     esp_rmaker_node_add_device(node, light_device);
 
+    /* Report the changes that do not come from the cloud, e.g. of the push button */
+    light_driver_add_observer(app_light_report, NULL);
+
     /* Enable OTA */
     esp_rmaker_ota_config_t ota_config = {
         .server_cert = ota_server_cert,
@@ -19,6 +19,14 @@
 #define DEFAULT_HUE         180
 #define DEFAULT_SATURATION  100
 #define DEFAULT_BRIGHTNESS  25
+#define DEFAULT_TRANSITION  100     /**< ms */
+#define TRANSITION_MAX      10000   /**< ms */
+
+#define TRANSITION_PARAM_NAME "Transition"
+#define TRANSITION_PARAM_TYPE "esp.param.transition"
+
+#define CCT_PARAM_NAME      "CCT"
+#define CCT_PARAM_TYPE      "esp.param.cct"
 
 /**
  * @brief 
@@ -61,7 +69,7 @@ esp_err_t app_light_set(uint32_t hue, uint32_t saturation, uint32_t brightness);
 esp_err_t app_light_set_power(bool power);
 
 /**
- * @brief 
+ * @brief Set the brightness of the white LEDs, the colour temperature is kept
  * 
  * @param brightness 
  * @return esp_err_t 
@@ -84,6 +92,38 @@ esp_err_t app_light_set_hue(uint16_t hue);
  */
 esp_err_t app_light_set_saturation(uint16_t saturation);
 
+/**
+ * @brief Set the fade time of the following light changes, it is not stored by the light driver
+ *
+ * @param transition_ms 0 applies the changes at once
+ * @return esp_err_t
+ */
+esp_err_t app_light_set_transition(uint32_t transition_ms);
+
+/**
+ * @brief Set the colour temperature of the white LEDs, the brightness is kept
+ *
+ * @param kelvin Clamped to the range of app_light_get_cct_range()
+ * @return esp_err_t
+ */
+esp_err_t app_light_set_cct(uint16_t kelvin);
+
+/**
+ * @brief Get the colour temperature of the light driver, the changes are applied by its task shortly after they are set
+ *
+ * @return Kelvin
+ */
+uint16_t app_light_get_cct(void);
+
+/**
+ * @brief Get the colour temperatures of the warm and the cold LEDs
+ *
+ * @param kelvin_min The warm LED
+ * @param kelvin_max The cold LED
+ * @return esp_err_t
+ */
+esp_err_t app_light_get_cct_range(uint16_t *kelvin_min, uint16_t *kelvin_max);
+
 /**
  * @brief 
  * 
@@ -16,18 +16,76 @@
 #include "iot_button.h"
 #include "light_driver.h"
 
+#if CONFIG_DIAG_ENABLE_METRICS
+#include "esp_timer.h"
+#include "esp_diagnostics_metrics.h"
+#endif
+
 #include DEVELOPMENT_BOARD
 #include "app_priv.h"
 
 #define TAG "app_driver"
 
 static bool g_output_state = true;
+static uint32_t g_transition_ms = LIGHT_TRANSITION_DEFAULT;
 
 static void push_btn_cb(void *arg)
 {
     app_driver_set_state(!g_output_state);
 }
 
+#if CONFIG_DIAG_ENABLE_METRICS
+#define LIGHT_METRICS_PERIOD_MS (60 * 1000)
+
+/**
+ * @brief Report the power of the LEDs and the cost of the fade interrupt over
+ *        the last period, so they can be lined up with the Wi-Fi metrics of the same device
+ */
+static void light_metrics_cb(void *arg)
+{
+    uint32_t power_mw = 0;
+
+    if (light_driver_get_power(&power_mw, NULL) == ESP_OK) {
+        esp_diag_metrics_add_uint("light_power", power_mw);
+    }
+
+#if CONFIG_LIGHT_DRIVER_ISR_STATS
+    iot_led_isr_stats_t stats = {0};
+
+    if (light_driver_get_isr_stats(&stats, true) != ESP_OK || !stats.count) {
+        return;
+    }
+
+    esp_diag_metrics_add_uint("fade_isr_runs", stats.count);
+    esp_diag_metrics_add_uint("fade_isr_avg", stats.cycles_total / stats.count);
+    esp_diag_metrics_add_uint("fade_isr_max", stats.cycles_max);
+    esp_diag_metrics_add_uint("fade_isr_chan", stats.channels);
+    esp_diag_metrics_add_uint("fade_isr_missed", stats.missed);
+#endif
+}
+
+static void light_metrics_init(void)
+{
+    esp_timer_handle_t timer = NULL;
+    const esp_timer_create_args_t timer_args = {
+        .callback = light_metrics_cb,
+        .name     = "light_metrics",
+    };
+
+    esp_diag_metrics_register("light", "light_power", "Estimated power of the LEDs (mW)", "light.power", ESP_DIAG_DATA_TYPE_UINT);
+#if CONFIG_LIGHT_DRIVER_ISR_STATS
+    esp_diag_metrics_register("light", "fade_isr_runs", "Fade interrupt runs", "light.isr", ESP_DIAG_DATA_TYPE_UINT);
+    esp_diag_metrics_register("light", "fade_isr_avg", "Fade interrupt average CPU cycles", "light.isr", ESP_DIAG_DATA_TYPE_UINT);
+    esp_diag_metrics_register("light", "fade_isr_max", "Fade interrupt longest CPU cycles", "light.isr", ESP_DIAG_DATA_TYPE_UINT);
+    esp_diag_metrics_register("light", "fade_isr_chan", "Fade interrupt channel updates", "light.isr", ESP_DIAG_DATA_TYPE_UINT);
+    esp_diag_metrics_register("light", "fade_isr_missed", "Fade interrupt missed alarms", "light.isr", ESP_DIAG_DATA_TYPE_UINT);
+#endif
+
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(timer, LIGHT_METRICS_PERIOD_MS * 1000ULL));
+}
+#endif
+
 void app_driver_init()
 {
     /* Configure push button */
@@ -59,7 +117,28 @@ void app_driver_init()
         .duty_resolution = LEDC_TIMER_11_BIT,
     };
     ESP_ERROR_CHECK(light_driver_init(&driver_config));
+
+    /**
+     * @brief Keep the LEDs within what the board and its supply sustain
+     */
+    light_driver_power_config_t power_config = {
+        .red_mw             = LIGHT_POWER_RED_MW,
+        .green_mw           = LIGHT_POWER_GREEN_MW,
+        .blue_mw            = LIGHT_POWER_BLUE_MW,
+        .warm_mw            = LIGHT_POWER_WARM_MW,
+        .cold_mw            = LIGHT_POWER_COLD_MW,
+        .budget_mw          = LIGHT_POWER_BUDGET_MW,
+        .derate_start_c     = LIGHT_DERATE_START_C,
+        .derate_end_c       = LIGHT_DERATE_END_C,
+        .derate_min_percent = LIGHT_DERATE_MIN_PERCENT,
+    };
+    ESP_ERROR_CHECK(light_driver_set_power_config(&power_config));
+
     app_light_set_power(true);
+
+#if CONFIG_DIAG_ENABLE_METRICS
+    light_metrics_init();
+#endif
 }
 
 int IRAM_ATTR app_driver_set_state(bool state)
@@ -84,16 +163,24 @@ bool app_driver_get_state(void)
     return g_output_state;
 }
 
+esp_err_t app_light_set_transition(uint32_t transition_ms)
+{
+    g_transition_ms = transition_ms;
+    return ESP_OK;
+}
+
 esp_err_t app_light_set_power(bool power)
 {
+    g_output_state = power;
+
     if (power) {
         // PM Lock
         app_pm_lock_acquire();
         // light on
-        light_driver_set_switch(true);
+        light_driver_set_switch_ex(true, g_transition_ms);
     } else {
         // light off
-        light_driver_set_switch(false);
+        light_driver_set_switch_ex(false, g_transition_ms);
         // PM UnLock
         app_pm_lock_release();
     }
@@ -102,20 +189,35 @@ esp_err_t app_light_set_power(bool power)
 
 esp_err_t app_light_set(uint32_t hue, uint32_t saturation, uint32_t brightness)
 {
-    return light_driver_set_hsv(hue,saturation, brightness);
+    return light_driver_set_hsv_ex(hue, saturation, brightness, g_transition_ms);
 }
 
 esp_err_t app_light_set_brightness(uint16_t brightness)
 {
-    return light_driver_set_brightness(brightness);
+    return light_driver_set_brightness_ex(brightness, g_transition_ms);
+}
+
+esp_err_t app_light_set_cct(uint16_t kelvin)
+{
+    return light_driver_set_kelvin_ex(kelvin, g_transition_ms);
+}
+
+uint16_t app_light_get_cct(void)
+{
+    return light_driver_get_cct();
+}
+
+esp_err_t app_light_get_cct_range(uint16_t *kelvin_min, uint16_t *kelvin_max)
+{
+    return light_driver_get_cct_range(kelvin_min, kelvin_max);
 }
 
 esp_err_t app_light_set_hue(uint16_t hue)
 {
-    return light_driver_set_hue(hue);
+    return light_driver_set_hue_ex(hue, g_transition_ms);
 }
 
 esp_err_t app_light_set_saturation(uint16_t saturation)
 {
-    return light_driver_set_saturation(saturation);
+    return light_driver_set_saturation_ex(saturation, g_transition_ms);
 }
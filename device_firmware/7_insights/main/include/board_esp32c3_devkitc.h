@@ -29,5 +29,14 @@
 #define LIGHT_FADE_PERIOD_MS    100     /**< The time from the current state to the next state */
 #define LIGHT_BLINK_PERIOD_MS   1500    /**< Period of blinking lights */
 #define LIGHT_FREQ_HZ           5000    /**< frequency of ledc signal */
+#define LIGHT_POWER_RED_MW      1000    /**< Power of each colour at full duty */
+#define LIGHT_POWER_GREEN_MW    1000
+#define LIGHT_POWER_BLUE_MW     1000
+#define LIGHT_POWER_WARM_MW     3000
+#define LIGHT_POWER_COLD_MW     3000
+#define LIGHT_POWER_BUDGET_MW   4500    /**< What the supply sustains with all colours on together */
+#define LIGHT_DERATE_START_C    60      /**< Temperature reported by light_driver_set_temperature() */
+#define LIGHT_DERATE_END_C      85
+#define LIGHT_DERATE_MIN_PERCENT 50
 
 #endif /**< __BOARD_ESP32C3_DEVKITC_H__ */
@@ -132,3 +132,47 @@ esp_err_t app_storage_get(const char *key, void *value, size_t length)
 
     return ESP_OK;
 }
+
+esp_err_t app_storage_factory_get(const char *name_space, const char *key, void *value, size_t length)
+{
+    APP_STORAGE_PARAM_CHECK(name_space);
+    APP_STORAGE_PARAM_CHECK(key);
+    APP_STORAGE_PARAM_CHECK(value);
+    APP_STORAGE_PARAM_CHECK(length > 0);
+
+    static bool init_flag = false;
+    esp_err_t ret     = ESP_OK;
+    nvs_handle handle = 0;
+
+    /**< The factory partition is never erased here, it only holds data written during manufacturing */
+    if (!init_flag) {
+        ret = nvs_flash_init_partition(CONFIG_APP_STORAGE_FACTORY_PARTITION_NAME);
+        APP_STORAGE_ERROR_CHECK(ret != ESP_OK, ret, "Initialize factory partition: %s",
+                                CONFIG_APP_STORAGE_FACTORY_PARTITION_NAME);
+        init_flag = true;
+    }
+
+    ret = nvs_open_from_partition(CONFIG_APP_STORAGE_FACTORY_PARTITION_NAME, name_space, NVS_READONLY, &handle);
+
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGD(TAG, "<ESP_ERR_NVS_NOT_FOUND> Open factory namespace: %s", name_space);
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    APP_STORAGE_ERROR_CHECK(ret != ESP_OK, ret, "Open factory namespace: %s", name_space);
+
+    /**< get variable length binary value for given key */
+    ret = nvs_get_blob(handle, key, value, &length);
+
+    /**< Close the storage handle and free any allocated resources */
+    nvs_close(handle);
+
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGD(TAG, "<ESP_ERR_NVS_NOT_FOUND> Get factory value, key: %s", key);
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    APP_STORAGE_ERROR_CHECK(ret != ESP_OK, ret, "Get factory value, key: %s", key);
+
+    return ESP_OK;
+}
@@ -94,6 +94,24 @@ esp_err_t app_storage_get(const char *key, void *value, size_t length);
  */
 esp_err_t app_storage_erase(const char *key);
 
+/**
+ * @brief  Load a value written to the factory NVS partition during manufacturing
+ *
+ * @note   The partition named CONFIG_APP_STORAGE_FACTORY_PARTITION_NAME is
+ *         initialised on first use and opened read-only
+ *
+ * @param  name_space Namespace of the value in the factory partition
+ * @param  key        The corresponding key of the information that want to load
+ * @param  value      The corresponding value of key
+ * @param  length     The length of the value
+ *
+ * @return
+ *     - ESP_ERR_NVS_NOT_FOUND
+ *     - ESP_FAIL
+ *     - ESP_OK
+ */
+esp_err_t app_storage_factory_get(const char *name_space, const char *key, void *value, size_t length);
+
 #ifdef __cplusplus
 }
 #endif
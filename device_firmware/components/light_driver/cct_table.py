@@ -0,0 +1,154 @@
+#!/usr/bin/env python
+#
+# Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Generate light_color_cct.h, the warm and cold output of light_color_kelvin2cw()
+
+    python cct_table.py [warm_kelvin cold_kelvin [warm_flux cold_flux]] > light_color_cct.h
+
+warm_kelvin and cold_kelvin are the colour temperatures of the LED bins,
+warm_flux and cold_flux their relative luminous flux at full output. The
+two whites are taken to lie on the Planckian locus. For each entry the
+flux of the LEDs is split so that the mix is closest to the target on the
+locus in CIE 1960 uv, and the total flux is that of the weaker LED at full
+output, so the brightness is the same across the range.
+"""
+
+import sys
+
+CCT_TABLE_SIZE = 33
+MIRED_Q = 8
+
+
+def mired_q8(kelvin):
+    """Same integer rounding as LIGHT_CCT_MIRED_Q8() of light_color.c"""
+    return (1000000 * (1 << MIRED_Q) + kelvin // 2) // kelvin
+
+
+def planck_xy(kelvin):
+    """CIE 1931 xy of the Planckian locus, Kim et al. cubic spline, 1667 K .. 25000 K"""
+    t = float(kelvin)
+
+    if t <= 4000:
+        x = -0.2661239e9 / t ** 3 - 0.2343589e6 / t ** 2 + 0.8776956e3 / t + 0.179910
+    else:
+        x = -3.0258469e9 / t ** 3 + 2.1070379e6 / t ** 2 + 0.2226347e3 / t + 0.240390
+
+    if t <= 2222:
+        y = -1.1063814 * x ** 3 - 1.34811020 * x ** 2 + 2.18555832 * x - 0.20219683
+    elif t <= 4000:
+        y = -0.9549476 * x ** 3 - 1.37418593 * x ** 2 + 2.09137015 * x - 0.16748867
+    else:
+        y = 3.0817580 * x ** 3 - 5.87338670 * x ** 2 + 3.75112997 * x - 0.37001483
+
+    return x, y
+
+
+def xy_to_uv(x, y):
+    d = -2 * x + 12 * y + 3
+    return 4 * x / d, 6 * y / d
+
+
+def mix_uv(warm_xy, cold_xy, warm_share):
+    """uv of warm_share of the flux from the warm LED and the rest from the cold one"""
+    xyz = [0.0, 0.0, 0.0]
+
+    for (x, y), flux in ((warm_xy, warm_share), (cold_xy, 1 - warm_share)):
+        xyz[0] += flux * x / y
+        xyz[1] += flux
+        xyz[2] += flux * (1 - x - y) / y
+
+    total = sum(xyz)
+    return xy_to_uv(xyz[0] / total, xyz[1] / total)
+
+
+def distance(a, b):
+    return ((a[0] - b[0]) ** 2 + (a[1] - b[1]) ** 2) ** 0.5
+
+
+def warm_share(warm_xy, cold_xy, kelvin):
+    """Flux share of the warm LED whose mix is closest to kelvin on the locus, by golden section"""
+    target = xy_to_uv(*planck_xy(kelvin))
+    low, high = 0.0, 1.0
+    ratio = (5 ** 0.5 - 1) / 2
+
+    for _ in range(100):
+        a = high - (high - low) * ratio
+        b = low + (high - low) * ratio
+
+        if distance(mix_uv(warm_xy, cold_xy, a), target) < distance(mix_uv(warm_xy, cold_xy, b), target):
+            high = b
+        else:
+            low = a
+
+    return (low + high) / 2
+
+
+def cct_table(warm_kelvin, cold_kelvin, warm_flux, cold_flux):
+    warm_xy, cold_xy = planck_xy(warm_kelvin), planck_xy(cold_kelvin)
+    mired_min, mired_max = mired_q8(cold_kelvin), mired_q8(warm_kelvin)
+    flux = min(warm_flux, cold_flux)
+    table = []
+
+    for i in range(CCT_TABLE_SIZE):
+        mired = mired_min + (mired_max - mired_min) * i / (CCT_TABLE_SIZE - 1.0)
+        share = warm_share(warm_xy, cold_xy, 1e6 * (1 << MIRED_Q) / mired)
+
+        if i == 0:
+            share = 0.0
+        elif i == CCT_TABLE_SIZE - 1:
+            share = 1.0
+
+        table.append((int(round(share * flux / warm_flux * 0xFFFF)),
+                      int(round((1 - share) * flux / cold_flux * 0xFFFF))))
+
+    return table
+
+
+def main():
+    warm_kelvin = int(sys.argv[1]) if len(sys.argv) > 2 else 2700
+    cold_kelvin = int(sys.argv[2]) if len(sys.argv) > 2 else 6500
+    warm_flux = float(sys.argv[3]) if len(sys.argv) > 4 else 1.0
+    cold_flux = float(sys.argv[4]) if len(sys.argv) > 4 else 1.0
+    table = cct_table(warm_kelvin, cold_kelvin, warm_flux, cold_flux)
+
+    print('/**')
+    print(' * @brief Warm and cold output of light_color.c, %d K .. %d K LEDs, relative flux %s / %s'
+          % (warm_kelvin, cold_kelvin, warm_flux, cold_flux))
+    print(' *')
+    print(' * Generated by cct_table.py, do not edit')
+    print(' */')
+    print('')
+    print('#ifndef __LIGHT_COLOR_CCT_H__')
+    print('#define __LIGHT_COLOR_CCT_H__')
+    print('')
+    print('#define LIGHT_CCT_KELVIN_MIN (%d) /**< The warm LED */' % warm_kelvin)
+    print('#define LIGHT_CCT_KELVIN_MAX (%d) /**< The cold LED */' % cold_kelvin)
+    print('#define LIGHT_CCT_TABLE_SIZE (%d)   /**< Even steps of mired from LIGHT_CCT_KELVIN_MAX, interpolated */'
+          % CCT_TABLE_SIZE)
+    print('')
+    print('static const uint16_t s_cct_table[LIGHT_CCT_TABLE_SIZE][2] = {')
+
+    for i in range(0, CCT_TABLE_SIZE, 4):
+        print('    ' + ' '.join('{%5d, %5d},' % entry for entry in table[i:i + 4]))
+
+    print('};')
+    print('')
+    print('#endif /**< __LIGHT_COLOR_CCT_H__ */')
+
+
+if __name__ == '__main__':
+    main()
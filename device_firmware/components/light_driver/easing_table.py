@@ -0,0 +1,99 @@
+#!/usr/bin/env python
+#
+# Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Generate iot_led_easing.h, the easing curves of iot_led.c
+
+    python easing_table.py [correction] > iot_led_easing.h
+
+The curves are listed in the order of iot_led_easing_t, from IOT_LED_EASE_IN_CUBIC.
+correction must match GAMMA_CORRECTION of include/iot_led.h, the perceptual
+curve undoes the gamma table to get to CIE lightness.
+"""
+
+import math
+import sys
+
+EASING_TABLE_SIZE = 65
+
+
+def lightness_to_luminance(lightness):
+    """CIE 1976 L* (0 .. 1) to relative luminance"""
+    lightness *= 100
+
+    if lightness > 8:
+        return ((lightness + 16) / 116) ** 3
+
+    return lightness / 903.3
+
+
+def in_out_expo(t):
+    if t <= 0.5:
+        return (2 ** (20 * t - 10) - 2 ** -10) / (2 * (1 - 2 ** -10))
+
+    return 1 - in_out_expo(1 - t)
+
+
+def curves(correction):
+    return [
+        ('IOT_LED_EASE_IN_CUBIC', lambda t: t ** 3),
+        ('IOT_LED_EASE_OUT_CUBIC', lambda t: 1 - (1 - t) ** 3),
+        ('IOT_LED_EASE_IN_OUT_CUBIC', lambda t: 4 * t ** 3 if t < 0.5 else 1 - (2 - 2 * t) ** 3 / 2),
+        ('IOT_LED_EASE_OUT_SINE', lambda t: math.sin(t * math.pi / 2)),
+        ('IOT_LED_EASE_IN_OUT_SINE', lambda t: (1 - math.cos(t * math.pi)) / 2),
+        ('IOT_LED_EASE_OUT_EXPO', lambda t: (1 - 2 ** (-10 * t)) / (1 - 2 ** -10)),
+        ('IOT_LED_EASE_IN_OUT_EXPO', in_out_expo),
+        ('IOT_LED_EASE_PERCEPTUAL', lambda t: lightness_to_luminance(t) ** correction),
+    ]
+
+
+def main():
+    correction = float(sys.argv[1]) if len(sys.argv) > 1 else 0.8
+    tables = curves(correction)
+
+    print('/**')
+    print(' * @brief Easing curves of iot_led.c, GAMMA_CORRECTION %s' % correction)
+    print(' *')
+    print(' * Generated by easing_table.py, do not edit')
+    print(' */')
+    print('')
+    print('#ifndef __IOT_LED_EASING_H__')
+    print('#define __IOT_LED_EASING_H__')
+    print('')
+    print('#define IOT_LED_EASING_GAMMA_CORRECTION_X1000 (%d)' % round(correction * 1000))
+    print('#define EASING_TABLE_SIZE (%d) /**< Points of a curve, the progress between two is interpolated */' % EASING_TABLE_SIZE)
+    print('#define EASING_TABLE_NUM (%d)  /**< Curves from IOT_LED_EASE_IN_CUBIC */' % len(tables))
+    print('')
+    print('static const DRAM_ATTR uint16_t s_easing_table[EASING_TABLE_NUM][EASING_TABLE_SIZE] = {')
+
+    for name, curve in tables:
+        table = [int(round(curve(i / (EASING_TABLE_SIZE - 1.0)) * 0xFFFF)) for i in range(EASING_TABLE_SIZE)]
+        table[0], table[-1] = 0, 0xFFFF
+
+        print('    [%s - IOT_LED_EASE_IN_CUBIC] = {' % name)
+
+        for i in range(0, EASING_TABLE_SIZE, 8):
+            print('        ' + ' '.join('%5d,' % value for value in table[i:i + 8]))
+
+        print('    },')
+
+    print('};')
+    print('')
+    print('#endif /**< __IOT_LED_EASING_H__ */')
+
+
+if __name__ == '__main__':
+    main()
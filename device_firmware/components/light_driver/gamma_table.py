@@ -0,0 +1,83 @@
+#!/usr/bin/env python
+#
+# Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Generate iot_led_gamma.h, the default gamma table of iot_led.c
+
+    python gamma_table.py [correction] > iot_led_gamma.h
+
+correction must match GAMMA_CORRECTION of include/iot_led.h. The arithmetic
+is done in single precision, so the table is the same as the one the former
+gamma_table_create() computed with powf() at boot.
+"""
+
+import struct
+import sys
+
+GAMMA_TABLE_SIZE = 256
+LEDC_FIXED_Q = 8
+
+
+def f32(value):
+    return struct.unpack('f', struct.pack('f', value))[0]
+
+
+def gamma_table(correction):
+    """
+    gamma curve formula: y=a*x^(1/gm)
+    x in (0,(GAMMA_TABLE_SIZE-1)/GAMMA_TABLE_SIZE)
+    a = GAMMA_TABLE_SIZE
+    """
+    exponent = f32(1.0 / f32(correction))
+    table = []
+
+    for i in range(GAMMA_TABLE_SIZE):
+        value = f32(f32(float(i) / (GAMMA_TABLE_SIZE - 1)) ** exponent)
+        table.append(int(value * GAMMA_TABLE_SIZE * (1 << LEDC_FIXED_Q)) & 0xFFFF)
+
+    if table[-1] == 0:
+        table[-1] = 0xFFFF
+
+    return table
+
+
+def main():
+    correction = float(sys.argv[1]) if len(sys.argv) > 1 else 0.8
+    table = gamma_table(correction)
+
+    print('/**')
+    print(' * @brief Default gamma table of iot_led.c, GAMMA_CORRECTION %s' % correction)
+    print(' *')
+    print(' * Generated by gamma_table.py, do not edit')
+    print(' */')
+    print('')
+    print('#ifndef __IOT_LED_GAMMA_H__')
+    print('#define __IOT_LED_GAMMA_H__')
+    print('')
+    print('#define IOT_LED_GAMMA_CORRECTION_X1000 (%d)' % round(correction * 1000))
+    print('')
+    print('static const DRAM_ATTR uint16_t s_gamma_table_default[GAMMA_TABLE_SIZE] = {')
+
+    for i in range(0, GAMMA_TABLE_SIZE, 8):
+        print('    ' + ' '.join('%5d,' % value for value in table[i:i + 8]))
+
+    print('};')
+    print('')
+    print('#endif /**< __IOT_LED_GAMMA_H__ */')
+
+
+if __name__ == '__main__':
+    main()
@@ -25,9 +25,15 @@ extern "C" {
 #define HW_TIMER_ID (0)                                    /**< Hardware timer number */
 #define HW_TIMER_DIVIDER (16)                              /**< Hardware timer clock divider */
 #define HW_TIMER_SCALE (TIMER_BASE_CLK / HW_TIMER_DIVIDER) /**< Convert counter value to seconds */
-#define GAMMA_CORRECTION 0.8                               /**< Gamma curve parameter */
+#define GAMMA_CORRECTION 0.8                               /**< Gamma curve parameter, iot_led_gamma.h is generated for it */
 #define GAMMA_TABLE_SIZE 256                               /**< Gamma table size, used for led fade*/
 #define DUTY_SET_CYCLE (20)                                /**< Set duty cycle */
+#define IOT_LED_PROGRAM_CHANNEL_MAX (5)                    /**< Channels driven by one fade program */
+#define HW_FADE_SEGMENT_MAX (4)                            /**< LEDC fades of one transition in IOT_LED_FADE_HARDWARE */
+#define HW_FADE_SEGMENT_MIN_MS (250)                       /**< Shortest LEDC fade of IOT_LED_FADE_HARDWARE */
+#define IOT_LED_DUTY_RESOLUTION_AUTO ((ledc_timer_bit_t)0)   /**< Highest duty resolution the frequency allows */
+#define IOT_LED_ISR_HIST_NUM (8)                           /**< Buckets of the fade interrupt cycle histogram */
+#define IOT_LED_ISR_HIST_SHIFT (10)                        /**< Bucket 0 counts runs below 2^10 CPU cycles */
 
 /**
  * Macro which can be used to check the error code,
@@ -51,6 +57,82 @@ extern "C" {
         } \
     } while(0)
 
+/**
+ * @brief Curve from the start to the target values of a keyframe
+ */
+typedef enum {
+    IOT_LED_EASE_LINEAR = 0,   /**< Constant speed */
+    IOT_LED_EASE_STEP,         /**< Jump to the target at once and hold it for the duration */
+    IOT_LED_EASE_SMOOTH,       /**< Slow start and slow end (smoothstep) */
+    IOT_LED_EASE_IN_CUBIC,     /**< The curves from here on are tables of iot_led_easing.h */
+    IOT_LED_EASE_OUT_CUBIC,    /**< Most of the change early, good for interactive changes */
+    IOT_LED_EASE_IN_OUT_CUBIC,
+    IOT_LED_EASE_OUT_SINE,
+    IOT_LED_EASE_IN_OUT_SINE,
+    IOT_LED_EASE_OUT_EXPO,
+    IOT_LED_EASE_IN_OUT_EXPO,
+    IOT_LED_EASE_PERCEPTUAL,   /**< Even steps of CIE lightness on a fade from or to off */
+    IOT_LED_EASE_MAX,
+} iot_led_easing_t;
+
+/**
+ * @brief How iot_led_set_channels() and friends run a transition
+ */
+typedef enum {
+    IOT_LED_FADE_TIMER = 0, /**< The fade interrupt moves the channel every DUTY_SET_CYCLE */
+    IOT_LED_FADE_HARDWARE,  /**< Up to HW_FADE_SEGMENT_MAX long LEDC fades, the interrupt only fires between them */
+    IOT_LED_FADE_MODE_MAX,
+} iot_led_fade_mode_t;
+
+/**
+ * @brief One keyframe of a fade program
+ */
+typedef struct {
+    uint8_t values[IOT_LED_PROGRAM_CHANNEL_MAX]; /**< Target of each channel of the program, 0 .. 255 */
+    uint8_t jitter;                              /**< Random offset of up to +-jitter added to the targets */
+    uint8_t easing;                              /**< iot_led_easing_t */
+    uint32_t duration_ms;                        /**< Time to reach the targets from the previous keyframe */
+} iot_led_keyframe_t;
+
+/**
+ * @brief Fade program, a sequence of keyframes stepped by the fade interrupt
+ */
+typedef struct {
+    const iot_led_keyframe_t *keyframes;
+    uint8_t keyframe_num;
+    uint8_t loop_from;      /**< Keyframe the program continues with after the last one */
+    uint16_t loop_count;    /**< Times the program is run, 0 runs it until it is stopped */
+} iot_led_program_t;
+
+/**
+ * @brief Calibration of the LED of one channel, see iot_led_set_calibration()
+ *
+ * The calibrated output of a non-zero value is offset + gain * gamma(value),
+ * in the 16-bit full scale of the gamma table. Zero stays off.
+ */
+typedef struct {
+    uint16_t gamma_x1000;   /**< Gamma curve parameter times 1000, 0 uses the shared gamma table */
+    uint16_t gain;          /**< 16-bit fraction, 65535 is 100 % */
+    uint16_t offset;        /**< Output of the lowest non-zero value, e.g. the turn-on threshold of the LED */
+} iot_led_calibration_t;
+
+/**
+ * @brief Cost of the fade interrupt, see iot_led_get_isr_stats()
+ *
+ * Bucket i of hist counts the runs of 2^(IOT_LED_ISR_HIST_SHIFT + i - 1) up to
+ * 2^(IOT_LED_ISR_HIST_SHIFT + i) CPU cycles, the first and last one are open ended.
+ */
+typedef struct {
+    uint32_t count;         /**< Runs of the fade interrupt */
+    uint32_t cycles_min;    /**< CPU cycles of the shortest run */
+    uint32_t cycles_max;    /**< CPU cycles of the longest run */
+    uint64_t cycles_total;  /**< CPU cycles of all runs, cycles_total / count is the average */
+    uint32_t hist[IOT_LED_ISR_HIST_NUM];
+    uint32_t channels;      /**< Channel updates written to the LEDC */
+    uint32_t channels_max;  /**< Most channel updates of one run */
+    uint32_t missed;        /**< Alarms that were served a whole interval or more late */
+} iot_led_isr_stats_t;
+
 /**
   * @brief Initialize and set the ledc timer for the iot led
   *
@@ -66,6 +148,7 @@ extern "C" {
   * @param clk_cfg clock srouce of ledc
   *
   * @param duty_resolution LEDC channel duty resolution
+  *     IOT_LED_DUTY_RESOLUTION_AUTO selects the highest one for freq_hz and clk_cfg
   *
   * @return
   *	    - ESP_OK if sucess
@@ -102,6 +185,50 @@ esp_err_t iot_led_deinit();
 */
 esp_err_t iot_led_regist_channel(ledc_channel_t channel, gpio_num_t gpio_num);
 
+/**
+  * @brief Configure another ledc timer, or change the frequency of one, for a
+  *     group of channels with their own frequency and resolution
+  *
+  * @param timer_num The timer index of ledc timer group
+  * @param freq_hz frequency of ledc timer
+  * @param clk_cfg clock source of ledc, all timers of the ESP32-C3 share one
+  * @param duty_resolution LEDC channel duty resolution, or IOT_LED_DUTY_RESOLUTION_AUTO
+  *
+  * @note  The idle channels of a reconfigured timer are rewritten at its new resolution
+  *
+  * @return
+  *	    - ESP_OK if sucess
+  *	    - ESP_ERR_INVALID_ARG Parameter error or iot_led_init() is not called yet
+  *     - ESP_FAIL Can not find a proper pre-divider number base on the given frequency
+  *         and duty_resolution.
+*/
+esp_err_t iot_led_timer_config(ledc_timer_t timer_num, uint32_t freq_hz, ledc_clk_cfg_t clk_cfg, ledc_timer_bit_t duty_resolution);
+
+/**
+  * @brief Same as iot_led_regist_channel(), the channel runs from the given ledc timer
+  *
+  * @param timer_num The timer of iot_led_init() or of iot_led_timer_config()
+  *
+  * @return
+  *	    - ESP_OK if sucess
+  *	    - ESP_ERR_INVALID_ARG Parameter error, iot_led_init() is not called yet or
+  *         the timer is not configured
+*/
+esp_err_t iot_led_regist_channel_ex(ledc_channel_t channel, gpio_num_t gpio_num, ledc_timer_t timer_num);
+
+/**
+  * @brief Stop the ledc channel registered by iot_led_regist_channel() and
+  *     clear its fade state, the output is set to low level
+  *
+  * @param channel The ledc channel
+  *     This parameter can be LEDC_CHANNEL_x where x can be (0 .. 15)
+  *
+  * @return
+  *	    - ESP_OK if sucess
+  *     - ESP_ERR_INVALID_ARG if lot_led_init() is not called yet or the parameter is invalid
+*/
+esp_err_t iot_led_unregist_channel(ledc_channel_t channel);
+
 /**
   * @brief Returns the channel value 
   * @note before calling this function, you need to call iot_led_regist_channel() to
@@ -117,6 +244,17 @@ esp_err_t iot_led_regist_channel(ledc_channel_t channel, gpio_num_t gpio_num);
 */
 esp_err_t iot_led_get_channel(ledc_channel_t channel, uint8_t* dst);
 
+/**
+  * @brief Returns the channel value with 16 bits of precision
+  *
+  * @param channel The ledc channel
+  * @param dst The address where the channel value (0 .. 65535) is stored
+  * @return
+  *     - ESP_OK if sucess
+  *	    - ESP_ERR_INVALID_ARG if lot_led_init() is not called yet or the parameter is invalid
+*/
+esp_err_t iot_led_get_channel16(ledc_channel_t channel, uint16_t *dst);
+
 /**
   * @brief Set the fade state for the specified channel
   * @note before calling this function, you need to call iot_led_regist_channel() to
@@ -133,6 +271,99 @@ esp_err_t iot_led_get_channel(ledc_channel_t channel, uint8_t* dst);
 */
 esp_err_t iot_led_set_channel(ledc_channel_t channel, uint8_t value, uint32_t fade_ms);
 
+/**
+  * @brief Set the fade state for the specified channel with a 16-bit target
+  * @note The fade state is kept in Q16, so a 16-bit target and the steps of a
+  *     slow fade are not truncated to 256 levels. iot_led_set_channel() is
+  *     the same as this function with value * 257
+  *
+  * @param channel The ledc channel
+  * @param value The target output brightness of iot led
+  *     This parameter can be (0 .. 65535)
+  * @param fade_ms The time from the current value to the target value
+  * @return
+  *	    - ESP_OK if sucess
+  *	    - ESP_ERR_INVALID_ARG if lot_led_init() is not called yet or the parameter is invalid
+*/
+esp_err_t iot_led_set_channel16(ledc_channel_t channel, uint16_t value, uint32_t fade_ms);
+
+/**
+  * @brief Set the fade state for several channels at once
+  * @note before calling this function, you need to call iot_led_regist_channel() to
+  *     set the channels
+  * @note All channels are published to the fade engine in one step, so their fades
+  *     start on the same tick and no intermediate colour is output
+  *
+  * @param channel_mask Bit mask of the ledc channels, BIT(x) for LEDC_CHANNEL_x
+  * @param values The target output brightness, values[x] is used for LEDC_CHANNEL_x
+  *     Each element can be (0 .. 255)
+  * @param fade_ms The time from the current value to the target value
+  * @return
+  *	    - ESP_OK if sucess
+  *	    - ESP_ERR_INVALID_ARG if lot_led_init() is not called yet or the parameter is invalid
+*/
+esp_err_t iot_led_set_channels(uint32_t channel_mask, const uint8_t values[], uint32_t fade_ms);
+
+/**
+  * @brief Set the fade state for several channels at once with 16-bit targets
+  *
+  * @param channel_mask Bit mask of the ledc channels, BIT(x) for LEDC_CHANNEL_x
+  * @param values The target output brightness, values[x] is used for LEDC_CHANNEL_x
+  *     Each element can be (0 .. 65535)
+  * @param fade_ms The time from the current value to the target value
+  * @return
+  *	    - ESP_OK if sucess
+  *	    - ESP_ERR_INVALID_ARG if lot_led_init() is not called yet or the parameter is invalid
+*/
+esp_err_t iot_led_set_channels16(uint32_t channel_mask, const uint16_t values[], uint32_t fade_ms);
+
+/**
+  * @brief Set several channels at once with 16-bit targets along an easing curve
+  *
+  * @param channel_mask Bit mask of the ledc channels, BIT(x) for LEDC_CHANNEL_x
+  * @param values The target output brightness, values[x] is used for LEDC_CHANNEL_x
+  * @param fade_ms The time from the current value to the target value
+  * @param easing Curve of this transition, iot_led_set_channels16() is IOT_LED_EASE_LINEAR
+  * @return
+  *	    - ESP_OK if sucess
+  *	    - ESP_ERR_INVALID_ARG if lot_led_init() is not called yet or the parameter is invalid
+*/
+esp_err_t iot_led_set_channels16_ex(uint32_t channel_mask, const uint16_t values[], uint32_t fade_ms,
+                                    iot_led_easing_t easing);
+
+/**
+  * @brief Fade a red, green and blue channel to a colour in HSV space
+  * @note before calling this function, you need to call iot_led_regist_channel() to
+  *     set the channels
+  * @note The hue moves along the shorter arc of the colour circle and the colour is
+  *     computed by the fade interrupt on every tick, so the fade passes through
+  *     saturated colours instead of the grey mid-points of an RGB fade.
+  *     Setting any of the channels with another function stops the fade
+  *
+  * @param channels The ledc channels of red, green and blue
+  * @param hue 16-bit hue, 0 .. 65535 maps to 0 .. 360 degrees
+  * @param saturation 16-bit saturation
+  * @param value 16-bit value
+  * @param fade_ms The time from the current colour to the target colour
+  * @return
+  *	    - ESP_OK if sucess
+  *	    - ESP_ERR_INVALID_ARG if lot_led_init() is not called yet or the parameter is invalid
+  *	    - ESP_ERR_NO_MEM if LEDC_CHANNEL_MAX / 3 groups of channels are fading already
+*/
+esp_err_t iot_led_set_hsv_channels(const ledc_channel_t channels[3], uint16_t hue,
+                                   uint16_t saturation, uint16_t value, uint32_t fade_ms);
+
+/**
+  * @brief Fade a red, green and blue channel to a colour in HSV space along an easing curve
+  *
+  * @param easing Curve of this transition, iot_led_set_hsv_channels() is IOT_LED_EASE_LINEAR
+  *
+  * @note  The other parameters are those of iot_led_set_hsv_channels()
+*/
+esp_err_t iot_led_set_hsv_channels_ex(const ledc_channel_t channels[3], uint16_t hue,
+                                      uint16_t saturation, uint16_t value, uint32_t fade_ms,
+                                      iot_led_easing_t easing);
+
 /**
   * @brief Set the blink state or loop fade for the specified channel
   * @note before calling this function, you need to call iot_led_regist_channel() to
@@ -163,6 +394,37 @@ esp_err_t iot_led_start_blink(ledc_channel_t channel, uint8_t value, uint32_t pe
 */
 esp_err_t iot_led_stop_blink(ledc_channel_t channel);
 
+/**
+  * @brief Run a fade program on a group of channels
+  * @note before calling this function, you need to call iot_led_regist_channel() to
+  *     set the channels
+  * @note The keyframes are copied to internal RAM and stepped by the fade interrupt,
+  *     so the program runs without any task wakeup. When the program ends the
+  *     channels keep the values of the last keyframe. Setting any of the channels
+  *     with another function stops the program
+  *
+  * @param channels The ledc channels, keyframe values[x] is used for channels[x]
+  * @param channel_num Number of channels, (1 .. IOT_LED_PROGRAM_CHANNEL_MAX)
+  * @param program The fade program
+  * @return
+  *	    - ESP_OK if sucess
+  *	    - ESP_ERR_INVALID_ARG if lot_led_init() is not called yet or the parameter is invalid
+  *	    - ESP_ERR_NO_MEM if the keyframes can not be copied
+*/
+esp_err_t iot_led_start_program(const ledc_channel_t channels[], uint8_t channel_num,
+                                const iot_led_program_t *program);
+
+/**
+  * @brief Stop the fade programs that drive any of the channels, the channels keep
+  *     their current values
+  *
+  * @param channel_mask Bit mask of the ledc channels, BIT(x) for LEDC_CHANNEL_x
+  * @return
+  *	    - ESP_OK if sucess
+  *	    - ESP_ERR_INVALID_ARG if lot_led_init() is not called yet
+*/
+esp_err_t iot_led_stop_program(uint32_t channel_mask);
+
 /**
   * @brief Set the specified gamma_table to control the fade effect, usually 
   *     no need to set
@@ -174,7 +436,8 @@ esp_err_t iot_led_stop_blink(ledc_channel_t channel);
   *     fixed-point number. The decimal point is before the eighth bit 
   *     and after the ninth bit, so the range of expressions can be 
   *     0x00.00 ~ 0xff.ff. 
-  * @note default gamma_table is created in iot_led_init()
+  * @note default gamma_table is generated for GAMMA_CORRECTION by gamma_table.py
+  *     and kept in DRAM, a table set here is copied to internal RAM
   *
   * @return
   *	    - ESP_OK if sucess
@@ -182,6 +445,89 @@ esp_err_t iot_led_stop_blink(ledc_channel_t channel);
 */
 esp_err_t iot_led_set_gamma_table(const uint16_t gamma_table[GAMMA_TABLE_SIZE]);
 
+/**
+  * @brief Replace the gamma table of one channel by a calibrated one
+  *
+  * @param channel     LEDC channel
+  * @param calibration Calibration of the LED, NULL goes back to the shared gamma table
+  *
+  * @note  The table is built here in internal RAM, the fade interrupt only
+  *     selects it by channel. A calibration with gamma_x1000 of 0 is built from
+  *     the shared gamma table at the time of the call
+  *
+  * @return
+  *	    - ESP_OK if sucess
+  *	    - ESP_ERR_INVALID_ARG Parameter error or iot_led_init() is not called yet
+  *	    - ESP_ERR_NO_MEM Out of memory
+*/
+esp_err_t iot_led_set_calibration(ledc_channel_t channel, const iot_led_calibration_t *calibration);
+
+/**
+  * @brief Linear light of a 16-bit channel value, through the shared gamma table
+  *
+  * @param value 16-bit value of iot_led_set_channel16()
+  *
+  * @note  Colours mixed from several LEDs add up in linear light, not in channel values
+  *
+  * @return Linear light, 65535 at full output
+*/
+uint16_t iot_led_value_to_linear(uint16_t value);
+
+/**
+  * @brief Duty of a channel at a 16-bit channel value, through the gamma table of the channel
+  *
+  * @param channel LEDC channel
+  * @param value   16-bit value of iot_led_set_channel16()
+  *
+  * @note  Unlike iot_led_value_to_linear() this follows the calibration of the
+  *     channel, so it is what the LED draws power in proportion to
+  *
+  * @return Duty, 65535 at full duty
+*/
+uint16_t iot_led_value_to_duty(ledc_channel_t channel, uint16_t value);
+
+/**
+  * @brief Inverse of iot_led_value_to_linear(), the gamma table must rise
+  *
+  * @param linear Linear light, 65535 at full output
+  *
+  * @return 16-bit value of iot_led_set_channel16()
+*/
+uint16_t iot_led_linear_to_value(uint16_t linear);
+
+/**
+  * @brief Select how the following transitions of iot_led_set_channel(), iot_led_set_channels()
+  *     and their 16-bit versions are run
+  *
+  * @param mode IOT_LED_FADE_TIMER or IOT_LED_FADE_HARDWARE
+  *
+  * @note  IOT_LED_FADE_HARDWARE follows the gamma curve with a few straight
+  *     segments, so the CPU can sleep through a transition. Hue fades, blinks
+  *     and fade programs are computed on every DUTY_SET_CYCLE in either mode
+  *
+  * @return
+  *	    - ESP_OK if sucess
+  *	    - ESP_ERR_INVALID_ARG Parameter error or iot_led_init() is not called yet
+*/
+esp_err_t iot_led_set_fade_mode(iot_led_fade_mode_t mode);
+
+/**
+  * @brief Get the cost of the fade interrupt since iot_led_init() or the last reset
+  *
+  * @param stats Filled with a consistent copy, the interrupt keeps running
+  *
+  * @param reset Start counting again from the next interrupt
+  *
+  * @note  Needs CONFIG_LIGHT_DRIVER_ISR_STATS, which adds the cycle count reads
+  *     and the bookkeeping to each run of the interrupt
+  *
+  * @return
+  *	    - ESP_OK if sucess
+  *	    - ESP_ERR_INVALID_ARG Parameter error or iot_led_init() is not called yet
+  *	    - ESP_ERR_NOT_SUPPORTED CONFIG_LIGHT_DRIVER_ISR_STATS is disabled
+*/
+esp_err_t iot_led_get_isr_stats(iot_led_isr_stats_t *stats, bool reset);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,199 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __LIGHT_COLOR_H__
+#define __LIGHT_COLOR_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Fixed-point colour conversion
+ *
+ * All components use 16 bits of precision:
+ *     - hue: 0 .. 65535 maps to 0 .. 360 degrees, 65536 wraps around to 0
+ *     - saturation, value, red, green, blue, warm, cold, brightness,
+ *       color_temperature: 0 .. 65535 maps to 0 .. 100 %
+ *
+ * No floating point is used, so the functions are cheap on targets without FPU.
+ */
+
+#define LIGHT_COLOR_MAX (UINT16_MAX) /**< Full scale of a 16-bit component */
+
+/**
+ * @brief  Convert hue in degrees (0 .. 360) to 16-bit hue
+ */
+static inline uint16_t light_color_degree_to_hue(uint16_t degree)
+{
+    return (uint16_t)(((uint32_t)degree * 0x10000 + 180) / 360);
+}
+
+/**
+ * @brief  Convert 16-bit hue to degrees (0 .. 359)
+ */
+static inline uint16_t light_color_hue_to_degree(uint16_t hue)
+{
+    return (uint16_t)((((uint32_t)hue * 360 + 0x8000) >> 16) % 360);
+}
+
+/**
+ * @brief  Convert percent (0 .. 100) to a 16-bit component
+ */
+static inline uint16_t light_color_percent_to_q16(uint8_t percent)
+{
+    return (uint16_t)(((uint32_t)percent * LIGHT_COLOR_MAX + 50) / 100);
+}
+
+/**
+ * @brief  Convert a 16-bit component to percent (0 .. 100)
+ */
+static inline uint8_t light_color_q16_to_percent(uint16_t value)
+{
+    return (uint8_t)(((uint32_t)value * 100 + LIGHT_COLOR_MAX / 2) / LIGHT_COLOR_MAX);
+}
+
+/**
+ * @brief  Convert an 8-bit component (0 .. 255) to a 16-bit component
+ */
+static inline uint16_t light_color_u8_to_q16(uint8_t value)
+{
+    return (uint16_t)(value * 257);
+}
+
+/**
+ * @brief  Convert a 16-bit component to an 8-bit component (0 .. 255)
+ */
+static inline uint8_t light_color_q16_to_u8(uint16_t value)
+{
+    return (uint8_t)(((uint32_t)value * 255 + LIGHT_COLOR_MAX / 2) / LIGHT_COLOR_MAX);
+}
+
+/**
+ * @brief  Convert HSV to RGB
+ *
+ * @note   Placed in IRAM by linker.lf, the fade interrupt of iot_led.c calls it on every tick
+ *
+ * @param  hue        16-bit hue
+ * @param  saturation 16-bit saturation
+ * @param  value      16-bit value
+ * @param  red        16-bit red output
+ * @param  green      16-bit green output
+ * @param  blue       16-bit blue output
+ */
+void light_color_hsv2rgb(uint16_t hue, uint16_t saturation, uint16_t value,
+                         uint16_t *red, uint16_t *green, uint16_t *blue);
+
+/**
+ * @brief  Convert RGB to HSV
+ *
+ * @note   Hue and saturation are 0 for grey. Converting the result back with
+ *         light_color_hsv2rgb() restores each component within 6 LSB, the
+ *         effect of one step of the 16-bit hue
+ *
+ * @param  red        16-bit red
+ * @param  green      16-bit green
+ * @param  blue       16-bit blue
+ * @param  hue        16-bit hue output
+ * @param  saturation 16-bit saturation output
+ * @param  value      16-bit value output
+ */
+void light_color_rgb2hsv(uint16_t red, uint16_t green, uint16_t blue,
+                         uint16_t *hue, uint16_t *saturation, uint16_t *value);
+
+/**
+ * @brief  Convert color temperature and brightness to warm and cold channel output
+ *
+ * @param  color_temperature 16-bit color temperature, 0 is coldest
+ * @param  brightness        16-bit brightness
+ * @param  warm              16-bit warm channel output
+ * @param  cold              16-bit cold channel output
+ */
+void light_color_ctb2cw(uint16_t color_temperature, uint16_t brightness,
+                        uint16_t *warm, uint16_t *cold);
+
+/**
+ * @brief  Convert warm and cold channel output back to color temperature and brightness
+ *
+ * @param  warm              16-bit warm channel output
+ * @param  cold              16-bit cold channel output
+ * @param  color_temperature 16-bit color temperature output
+ * @param  brightness        16-bit brightness output
+ */
+void light_color_cw2ctb(uint16_t warm, uint16_t cold,
+                        uint16_t *color_temperature, uint16_t *brightness);
+
+/**
+ * @brief  Convert a colour temperature in Kelvin to warm and cold output at full brightness
+ *
+ * @note   The output is linear light, interpolated in mired from the table that
+ *         cct_table.py generates for the LED bins. The flux of the two LEDs adds up
+ *         to the same brightness at every temperature. Temperatures outside the
+ *         LEDs are clamped to them
+ *
+ * @param  kelvin Colour temperature
+ * @param  warm   Linear 16-bit warm channel output
+ * @param  cold   Linear 16-bit cold channel output
+ */
+void light_color_kelvin2cw(uint16_t kelvin, uint16_t *warm, uint16_t *cold);
+
+/**
+ * @brief  Inverse of light_color_kelvin2cw()
+ *
+ * @param  warm       Linear 16-bit warm channel output
+ * @param  cold       Linear 16-bit cold channel output
+ * @param  kelvin     Colour temperature output, the coldest if both are off
+ * @param  brightness Linear 16-bit brightness output, the share of full brightness
+ */
+void light_color_cw2kelvin(uint16_t warm, uint16_t cold, uint16_t *kelvin, uint16_t *brightness);
+
+/**
+ * @brief  Colour temperatures of the warm and cold LEDs of light_color_kelvin2cw()
+ */
+void light_color_kelvin_range(uint16_t *kelvin_min, uint16_t *kelvin_max);
+
+/**
+ * @brief  Convert Kelvin to the 16-bit color_temperature of light_color_ctb2cw(), even in mired
+ */
+uint16_t light_color_kelvin_to_q16(uint16_t kelvin);
+
+/**
+ * @brief  Inverse of light_color_kelvin_to_q16(), rounded to 1 K
+ */
+uint16_t light_color_q16_to_kelvin(uint16_t color_temperature);
+
+/**
+ * @brief  Move the white part of a linear RGB colour to the warm and cold LEDs
+ *
+ * @note   A white LED at full output gives the light of its white point, in the
+ *         linear RGB of the colour LEDs. The white that leaves less of the colour
+ *         is taken first, as much as the colour holds, then the other one from
+ *         what is left. A zero white point is never used
+ *
+ * @param  rgb        Linear 16-bit red, green and blue, replaced by what is left for the colour LEDs
+ * @param  warm_point Linear 16-bit RGB of the warm LED at full output
+ * @param  cold_point Linear 16-bit RGB of the cold LED at full output
+ * @param  warm       Linear 16-bit warm channel output
+ * @param  cold       Linear 16-bit cold channel output
+ */
+void light_color_rgb2rgbw(uint16_t rgb[3], const uint16_t warm_point[3], const uint16_t cold_point[3],
+                          uint16_t *warm, uint16_t *cold);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /**< __LIGHT_COLOR_H__ */
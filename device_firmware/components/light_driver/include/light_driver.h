@@ -39,6 +39,16 @@ enum light_mode {
     MODE_BRIGHTNESS_DECREASE = 9,
 };
 
+/**
+ * @brief Effects run by the fade interrupt, see light_driver_effect_start()
+ */
+typedef enum {
+    LIGHT_EFFECT_CANDLE = 0, /**< Warm flicker, runs until it is stopped */
+    LIGHT_EFFECT_SUNRISE,    /**< From dark red to daylight in 10 minutes, then holds */
+    LIGHT_EFFECT_ALERT,      /**< Red double flash, runs until it is stopped */
+    LIGHT_EFFECT_MAX,
+} light_effect_t;
+
 /**
  * @brief Light driven configuration
  */
@@ -52,9 +62,84 @@ typedef struct {
     uint32_t blink_period_ms; /**< Period of flashing lights */
     uint32_t freq_hz;         /**< LEDC timer frequency (Hz) */
     ledc_clk_cfg_t clk_cfg;   /**< Clock srouce of LEDC */
-    ledc_timer_bit_t duty_resolution;  /**< LEDC channel duty resolution */
+    ledc_timer_bit_t duty_resolution;  /**< LEDC channel duty resolution, IOT_LED_DUTY_RESOLUTION_AUTO for the highest */
+    uint32_t freq_hz_white;   /**< LEDC timer frequency of the warm and cold channels (Hz), 0 runs them at freq_hz */
+    ledc_timer_bit_t duty_resolution_white; /**< Duty resolution of the warm and cold channels, with freq_hz_white */
+    const char *store_key;    /**< NVS key of the light status, at most 15 characters, "light_status" if NULL */
 } light_driver_config_t;
 
+/**
+ * @brief Handle of a light fixture
+ *
+ * @note  Every fixture owns its channel map, state and persistence key. The
+ *        GPIOs that are not valid outputs, e.g. GPIO_NUM_NC, are not connected.
+ *        All fixtures share one LEDC timer and one fade interrupt, so at most
+ *        LEDC_CHANNEL_MAX channels can be connected in total.
+ */
+typedef struct light_driver *light_handle_t;
+
+/**
+ * @brief Statistics of the light status persistence
+ */
+typedef struct {
+    uint32_t write_count;  /**< Number of snapshots written to flash */
+    uint32_t merge_count;  /**< Number of changes merged into a pending write */
+    uint32_t skip_count;   /**< Number of writes skipped because the stored bytes were unchanged */
+} light_driver_store_stats_t;
+
+/**
+ * @brief Power model and budget of a light, see light_driver_set_power_config()
+ *
+ * The power of a colour is taken as proportional to its duty, i.e. to the linear
+ * light of its 16-bit output. Above derate_start_c the budget falls linearly, to
+ * derate_min_percent at derate_end_c and beyond.
+ */
+typedef struct {
+    uint32_t red_mw;            /**< Power of the red LEDs at full duty (mW) */
+    uint32_t green_mw;          /**< Power of the green LEDs at full duty (mW) */
+    uint32_t blue_mw;           /**< Power of the blue LEDs at full duty (mW) */
+    uint32_t warm_mw;           /**< Power of the warm LEDs at full duty (mW) */
+    uint32_t cold_mw;           /**< Power of the cold LEDs at full duty (mW) */
+    uint32_t budget_mw;         /**< Most power all colours together may draw (mW), 0 for no limit */
+    int16_t derate_start_c;     /**< Temperature where the budget starts to fall (Celsius) */
+    int16_t derate_end_c;       /**< Temperature of the lowest budget (Celsius), equal to derate_start_c for no derating */
+    uint8_t derate_min_percent; /**< Budget at derate_end_c, in percent of budget_mw */
+} light_driver_power_config_t;
+
+/**
+ * @brief Fields of a light state change, see light_driver_add_observer()
+ */
+typedef enum {
+    LIGHT_CHANGE_ON                = (1 << 0),
+    LIGHT_CHANGE_MODE              = (1 << 1),
+    LIGHT_CHANGE_HUE               = (1 << 2),
+    LIGHT_CHANGE_SATURATION        = (1 << 3),
+    LIGHT_CHANGE_VALUE             = (1 << 4),
+    LIGHT_CHANGE_COLOR_TEMPERATURE = (1 << 5),
+    LIGHT_CHANGE_BRIGHTNESS        = (1 << 6),
+    LIGHT_CHANGE_KELVIN            = (1 << 7),
+} light_change_t;
+
+/**
+ * @brief State of a light passed to its observers
+ */
+typedef struct {
+    uint32_t changed;          /**< light_change_t of the fields that differ from the last notification */
+    bool on;
+    uint8_t mode;              /**< enum light_mode */
+    uint16_t hue;
+    uint8_t saturation;
+    uint8_t value;
+    uint8_t color_temperature;
+    uint8_t brightness;
+    uint16_t kelvin;           /**< 0 if the colour temperature was set in percent */
+} light_driver_state_t;
+
+/**
+ * @brief Observer of the state changes of a light, see light_driver_add_observer()
+ */
+typedef void (*light_driver_observer_t)(light_handle_t handle, const light_driver_state_t *state, void *arg);
+
 /**
  * @brief  Light initialize
  *
@@ -88,14 +173,193 @@ esp_err_t light_driver_deinit();
  */
 esp_err_t light_driver_config(uint32_t fade_period_ms, uint32_t blink_period_ms);
 
+/**
+ * @brief Set the easing curve of the transitions of the light_driver_set_* commands
+ *
+ * @note  The default is selected by CONFIG_LIGHT_DRIVER_EASING. With IOT_LED_EASE_OUT_CUBIC
+ *        most of a change is visible early in the transition, so a command feels faster
+ *        at the same fade period. Effects and the light_driver_fade_* sweeps stay linear
+ *
+ * @param  easing Curve of the transitions
+ *
+ * @return
+ *      - ESP_OK
+ *      - ESP_ERR_INVALID_ARG
+ */
+esp_err_t light_driver_set_easing(iot_led_easing_t easing);
+
+/**
+ * @brief Light the white part of the HSV colours with the warm and cold LEDs
+ *
+ * @note  The default is CONFIG_LIGHT_DRIVER_WHITE_MIX. The colour is split in linear
+ *        light against the RGB of each white LED, CONFIG_LIGHT_DRIVER_CALIBRATION_NAMESPACE
+ *        keys warm_rgb and cold_rgb (3 x uint16_t), typical 2700 K and 6500 K LEDs
+ *        without them. Pastel colours get brighter and more efficient, hue changes
+ *        then fade channel by channel instead of around the colour circle
+ *
+ * @param  enable Mix the white in, or leave warm and cold off in HSV mode
+ *
+ * @return
+ *      - ESP_OK
+ *      - ESP_ERR_INVALID_ARG
+ */
+esp_err_t light_driver_set_white_mix(bool enable);
+
+/**
+ * @brief Follow streams of commands, e.g. from a slider being dragged, as one trajectory
+ *
+ * @note  A command within 500 ms of the previous one in the same mode continues a
+ *        stream. The rate of each field is measured over the stream and the output
+ *        is extrapolated one interval ahead, then reached in a linear fade of that
+ *        interval. The light keeps moving between the commands instead of restarting
+ *        a fade at each one. Only the commands sent with LIGHT_TRANSITION_DEFAULT are
+ *        followed, a command with a transition of its own ends the stream and is
+ *        applied with that transition. Shortly after the last command the output
+ *        settles on the status. Follow is disabled by default
+ *
+ * @param  enable   Follow streams, or fade every command on its own
+ * @param  max_rate Largest change per second, in percent or degrees of hue, 0 for no limit
+ *
+ * @return
+ *      - ESP_OK
+ *      - ESP_ERR_INVALID_ARG
+ */
+esp_err_t light_driver_set_follow(bool enable, uint32_t max_rate);
+
+/**
+ * @brief  Call an observer when the state of the light changes, whatever the source of the change
+ *
+ * @note   The observer runs in the esp_timer task, outside of the light driver
+ *         lock. It is called once the light task has applied a change, and at
+ *         most once per CONFIG_LIGHT_DRIVER_NOTIFY_WINDOW_MS. The changes within
+ *         a window are merged, and a state that is back to the last notification
+ *         is not reported. Fades and effects do not change the state.
+ *
+ * @param  cb  Observer
+ * @param  arg Passed to the observer
+ *
+ * @return
+ *      - ESP_OK
+ *      - ESP_ERR_INVALID_ARG
+ *      - ESP_ERR_NO_MEM, too many observers
+ */
+esp_err_t light_driver_add_observer(light_driver_observer_t cb, void *arg);
+
+/**
+ * @brief  Stop calling an observer added with light_driver_add_observer()
+ *
+ * @note   A notification already being delivered may still call it once
+ *
+ * @return
+ *      - ESP_OK
+ *      - ESP_ERR_INVALID_ARG
+ *      - ESP_ERR_NOT_FOUND
+ */
+esp_err_t light_driver_remove_observer(light_driver_observer_t cb, void *arg);
+
+/**
+ * @brief  Write the pending status of all lights to flash immediately
+ *
+ * @note   The light status is written after CONFIG_LIGHT_DRIVER_STORE_DELAY_MS without
+ *         changes, and is flushed automatically by esp_restart(). Call this before
+ *         any other operation that loses power or RAM contents.
+ *
+ * @return
+ *      - ESP_OK
+ *      - ESP_FAIL
+ */
+esp_err_t light_driver_store_flush();
+
+/**
+ * @brief  Get the statistics of the light status persistence
+ *
+ * @param  stats Pointer to the statistics
+ *
+ * @return
+ *      - ESP_OK
+ *      - ESP_ERR_INVALID_ARG
+ */
+esp_err_t light_driver_get_store_stats(light_driver_store_stats_t *stats);
+
+/**
+ * @brief  Get the cost of the fade interrupt, which is shared by all lights
+ *
+ * @param  stats Pointer to the statistics
+ * @param  reset Start counting again from the next interrupt
+ *
+ * @return
+ *      - ESP_OK
+ *      - ESP_ERR_INVALID_ARG
+ *      - ESP_ERR_NOT_SUPPORTED CONFIG_LIGHT_DRIVER_ISR_STATS is disabled
+ */
+esp_err_t light_driver_get_isr_stats(iot_led_isr_stats_t *stats, bool reset);
+
+/**
+ * @brief  Set the power model and budget of the light
+ *
+ * @note   Every target is scaled down in linear light, all colours by the same
+ *         factor, until the colours of the command draw at most the budget. The
+ *         hue and colour temperature are kept. The colours a command leaves alone
+ *         do not count, in each mode the others are off. A hue fade is limited for
+ *         the brightest colour it passes. The power of each colour follows its
+ *         calibration. Effects are limited per keyframe, blinks are not limited
+ *
+ * @param  config Power model, copied. All zero removes the limit
+ *
+ * @return
+ *      - ESP_OK
+ *      - ESP_ERR_INVALID_ARG, e.g. derate_end_c below derate_start_c
+ */
+esp_err_t light_driver_set_power_config(const light_driver_power_config_t *config);
+
+/**
+ * @brief  Report the temperature of the LEDs for the derating of the budget
+ *
+ * @note   If the budget changes, the current status is applied again with the new one
+ *
+ * @param  temperature_c Temperature in Celsius, e.g. of an NTC next to the LEDs
+ *
+ * @return
+ *      - ESP_OK
+ *      - ESP_ERR_INVALID_ARG
+ */
+esp_err_t light_driver_set_temperature(int16_t temperature_c);
+
+/**
+ * @brief  Estimate the power the LEDs draw now, from the model of light_driver_set_power_config()
+ *
+ * @note   The estimate follows the outputs through fades and effects
+ *
+ * @param  power_mw  Power of the LEDs (mW)
+ * @param  budget_mw Budget after derating (mW), 0 for no limit, may be NULL
+ *
+ * @return
+ *      - ESP_OK
+ *      - ESP_ERR_INVALID_ARG
+ */
+esp_err_t light_driver_get_power(uint32_t *power_mw, uint32_t *budget_mw);
+
+/**
+ * @brief  Get the handle of the light created by light_driver_init()
+ *
+ * @return
+ *      - Handle of the light
+ *      - NULL if light_driver_init() has not been called
+ */
+light_handle_t light_driver_get_handle();
+
 /**@{*/
 /**
  * @brief  Set the status of the light
  *
+ * @note   The setters only post the new values to the light task and return at
+ *         once. Commands posted before the task runs are merged, the latest value
+ *         of each field wins, and are applied with a single LEDC update.
  *
  * @return
  *      - ESP_OK
- *      - MDF_ERR_INVALID_ARG
+ *      - ESP_ERR_INVALID_ARG
+ *      - ESP_ERR_INVALID_STATE, light_driver_init() has not been called
  */
 esp_err_t light_driver_set_hue(uint16_t hue);
 esp_err_t light_driver_set_saturation(uint8_t saturation);
@@ -108,9 +372,86 @@ esp_err_t light_driver_set_switch(bool status);
 
 /**@}*/
 
+/**
+ * @brief Use the fade period set by light_driver_config() as transition time
+ */
+#define LIGHT_TRANSITION_DEFAULT (UINT32_MAX)
+
 /**@{*/
 /**
- * @brief  Set the status of the light
+ * @brief  Set the status of the light with its own transition time
+ *
+ * @note   The transition only applies to this command, the fade period set by
+ *         light_driver_config() is left unchanged. 0 changes the output at once.
+ *         If several commands are merged the transition of the latest one wins.
+ *         A single field is changed on the status the light task holds, the
+ *         other fields are kept as they are.
+ *
+ * @param  transition_ms Fade time in milliseconds, or LIGHT_TRANSITION_DEFAULT
+ *
+ * @return
+ *      - ESP_OK
+ *      - ESP_ERR_INVALID_ARG
+ *      - ESP_ERR_INVALID_STATE, light_driver_init() has not been called
+ */
+esp_err_t light_driver_set_hue_ex(uint16_t hue, uint32_t transition_ms);
+esp_err_t light_driver_set_saturation_ex(uint8_t saturation, uint32_t transition_ms);
+esp_err_t light_driver_set_value_ex(uint8_t value, uint32_t transition_ms);
+esp_err_t light_driver_set_color_temperature_ex(uint8_t color_temperature, uint32_t transition_ms);
+esp_err_t light_driver_set_brightness_ex(uint8_t brightness, uint32_t transition_ms);
+esp_err_t light_driver_set_hsv_ex(uint16_t hue, uint8_t saturation, uint8_t value, uint32_t transition_ms);
+esp_err_t light_driver_set_ctb_ex(uint8_t color_temperature, uint8_t brightness, uint32_t transition_ms);
+esp_err_t light_driver_set_switch_ex(bool status, uint32_t transition_ms);
+/**@}*/
+
+/**@{*/
+/**
+ * @brief  Set the colour temperature in Kelvin and the brightness in percent
+ *
+ * @note   The warm and cold output comes from the table that cct_table.py generates
+ *         for the colour temperature and flux of the LED bins, interpolated in mired.
+ *         The brightness is the same across the range. A temperature outside the
+ *         LEDs is clamped to them, see light_driver_get_cct_range()
+ *
+ * @param  kelvin        Colour temperature, e.g. 2700 .. 6500
+ * @param  brightness    Brightness in percent
+ * @param  transition_ms Fade time in milliseconds, or LIGHT_TRANSITION_DEFAULT
+ *
+ * @return
+ *      - ESP_OK
+ *      - ESP_ERR_INVALID_ARG
+ *      - ESP_ERR_INVALID_STATE, light_driver_init() has not been called
+ */
+esp_err_t light_driver_set_cct(uint16_t kelvin, uint8_t brightness);
+esp_err_t light_driver_set_cct_ex(uint16_t kelvin, uint8_t brightness, uint32_t transition_ms);
+/**@}*/
+
+/**@{*/
+/**
+ * @brief  Set the colour temperature in Kelvin and keep the brightness
+ *
+ * @note   As light_driver_set_cct(), with the brightness the light shows: the
+ *         brightness of CTB mode, or the value of HSV mode when the light
+ *         switches from it. light_driver_set_brightness() likewise keeps the
+ *         colour temperature
+ *
+ * @param  kelvin        Colour temperature, clamped to light_driver_get_cct_range()
+ * @param  transition_ms Fade time in milliseconds, or LIGHT_TRANSITION_DEFAULT
+ *
+ * @return
+ *      - ESP_OK
+ *      - ESP_ERR_INVALID_ARG
+ *      - ESP_ERR_INVALID_STATE, light_driver_init() has not been called
+ */
+esp_err_t light_driver_set_kelvin(uint16_t kelvin);
+esp_err_t light_driver_set_kelvin_ex(uint16_t kelvin, uint32_t transition_ms);
+/**@}*/
+
+/**@{*/
+/**
+ * @brief  Get the status of the light
+ *
+ * @note   Returns the status last applied by the light task
  */
 uint16_t light_driver_get_hue();
 uint8_t light_driver_get_saturation();
@@ -119,6 +460,8 @@ esp_err_t light_driver_get_hsv(uint16_t *hue, uint8_t *saturation, uint8_t *valu
 uint8_t light_driver_get_color_temperature();
 uint8_t light_driver_get_brightness();
 esp_err_t light_driver_get_ctb(uint8_t *color_temperature, uint8_t *brightness);
+uint16_t light_driver_get_cct();
+esp_err_t light_driver_get_cct_range(uint16_t *kelvin_min, uint16_t *kelvin_max);
 bool light_driver_get_switch();
 uint8_t light_driver_get_mode();
 /**@}*/
@@ -154,6 +497,122 @@ esp_err_t light_driver_fade_warm(uint8_t color_temperature);
 esp_err_t light_driver_fade_stop();
 /**@}*/
 
+/**@{*/
+/**
+ * @brief  Run a built-in effect or a fade program of keyframes
+ *
+ * @note   The keyframes are stepped entirely by the fade interrupt, the effect
+ *         needs no task wakeup. Keyframe values are in red, green, blue, warm,
+ *         cold order, the values of unconnected colours are ignored.
+ *         Any light_driver_set_* command ends the effect, light_driver_effect_stop()
+ *         ends it and restores the status of the light.
+ *         The state of the light is not saved in nvs
+ *
+ * @return
+ *      - ESP_OK
+ *      - ESP_ERR_INVALID_ARG
+ *      - ESP_ERR_NO_MEM
+ */
+esp_err_t light_driver_effect_start(light_effect_t effect);
+esp_err_t light_driver_program_start(const iot_led_program_t *program);
+esp_err_t light_driver_effect_stop();
+/**@}*/
+
+/**
+ * @brief  Create a light fixture
+ *
+ * @note   light_driver_init() creates the light driven by the light_driver_* functions,
+ *         the light_handle_* functions below drive any light created by this function.
+ *         The LEDC timers are configured by the first light, freq_hz, clk_cfg,
+ *         duty_resolution and their white versions of the following lights are ignored.
+ *
+ * @param  config Configuration of the light
+ * @param  handle Handle of the created light
+ *
+ * @return
+ *      - ESP_OK
+ *      - ESP_ERR_INVALID_ARG
+ *      - ESP_ERR_NO_MEM
+ *      - ESP_ERR_NOT_FOUND, not enough free LEDC channels
+ */
+esp_err_t light_handle_create(const light_driver_config_t *config, light_handle_t *handle);
+
+/**
+ * @brief  Delete a light fixture, its pending commands are applied and its status is stored
+ *
+ * @param  handle Handle of the light
+ *
+ * @return
+ *      - ESP_OK
+ *      - ESP_ERR_INVALID_ARG
+ */
+esp_err_t light_handle_delete(light_handle_t handle);
+
+/**@{*/
+/**
+ * @brief  Same as the light_driver_* functions, for the given light
+ */
+esp_err_t light_handle_config(light_handle_t handle, uint32_t fade_period_ms, uint32_t blink_period_ms);
+esp_err_t light_handle_set_easing(light_handle_t handle, iot_led_easing_t easing);
+esp_err_t light_handle_set_white_mix(light_handle_t handle, bool enable);
+esp_err_t light_handle_set_follow(light_handle_t handle, bool enable, uint32_t max_rate);
+esp_err_t light_handle_add_observer(light_handle_t handle, light_driver_observer_t cb, void *arg);
+esp_err_t light_handle_remove_observer(light_handle_t handle, light_driver_observer_t cb, void *arg);
+esp_err_t light_handle_set_power_config(light_handle_t handle, const light_driver_power_config_t *config);
+esp_err_t light_handle_set_temperature(light_handle_t handle, int16_t temperature_c);
+esp_err_t light_handle_get_power(light_handle_t handle, uint32_t *power_mw, uint32_t *budget_mw);
+esp_err_t light_handle_store_flush(light_handle_t handle);
+esp_err_t light_handle_get_store_stats(light_handle_t handle, light_driver_store_stats_t *stats);
+
+esp_err_t light_handle_set_hue(light_handle_t handle, uint16_t hue);
+esp_err_t light_handle_set_saturation(light_handle_t handle, uint8_t saturation);
+esp_err_t light_handle_set_value(light_handle_t handle, uint8_t value);
+esp_err_t light_handle_set_color_temperature(light_handle_t handle, uint8_t color_temperature);
+esp_err_t light_handle_set_brightness(light_handle_t handle, uint8_t brightness);
+esp_err_t light_handle_set_hsv(light_handle_t handle, uint16_t hue, uint8_t saturation, uint8_t value);
+esp_err_t light_handle_set_ctb(light_handle_t handle, uint8_t color_temperature, uint8_t brightness);
+esp_err_t light_handle_set_switch(light_handle_t handle, bool status);
+esp_err_t light_handle_set_hue_ex(light_handle_t handle, uint16_t hue, uint32_t transition_ms);
+esp_err_t light_handle_set_saturation_ex(light_handle_t handle, uint8_t saturation, uint32_t transition_ms);
+esp_err_t light_handle_set_value_ex(light_handle_t handle, uint8_t value, uint32_t transition_ms);
+esp_err_t light_handle_set_color_temperature_ex(light_handle_t handle, uint8_t color_temperature, uint32_t transition_ms);
+esp_err_t light_handle_set_brightness_ex(light_handle_t handle, uint8_t brightness, uint32_t transition_ms);
+esp_err_t light_handle_set_hsv_ex(light_handle_t handle, uint16_t hue, uint8_t saturation, uint8_t value,
+                                  uint32_t transition_ms);
+esp_err_t light_handle_set_ctb_ex(light_handle_t handle, uint8_t color_temperature, uint8_t brightness,
+                                  uint32_t transition_ms);
+esp_err_t light_handle_set_switch_ex(light_handle_t handle, bool status, uint32_t transition_ms);
+esp_err_t light_handle_set_cct(light_handle_t handle, uint16_t kelvin, uint8_t brightness);
+esp_err_t light_handle_set_cct_ex(light_handle_t handle, uint16_t kelvin, uint8_t brightness, uint32_t transition_ms);
+esp_err_t light_handle_set_kelvin(light_handle_t handle, uint16_t kelvin);
+esp_err_t light_handle_set_kelvin_ex(light_handle_t handle, uint16_t kelvin, uint32_t transition_ms);
+
+uint16_t light_handle_get_hue(light_handle_t handle);
+uint8_t light_handle_get_saturation(light_handle_t handle);
+uint8_t light_handle_get_value(light_handle_t handle);
+esp_err_t light_handle_get_hsv(light_handle_t handle, uint16_t *hue, uint8_t *saturation, uint8_t *value);
+uint8_t light_handle_get_color_temperature(light_handle_t handle);
+uint8_t light_handle_get_brightness(light_handle_t handle);
+esp_err_t light_handle_get_ctb(light_handle_t handle, uint8_t *color_temperature, uint8_t *brightness);
+uint16_t light_handle_get_cct(light_handle_t handle);
+esp_err_t light_handle_get_cct_range(light_handle_t handle, uint16_t *kelvin_min, uint16_t *kelvin_max);
+bool light_handle_get_switch(light_handle_t handle);
+uint8_t light_handle_get_mode(light_handle_t handle);
+
+esp_err_t light_handle_set_rgb(light_handle_t handle, uint8_t red, uint8_t green, uint8_t blue);
+esp_err_t light_handle_breath_start(light_handle_t handle, uint8_t red, uint8_t green, uint8_t blue);
+esp_err_t light_handle_breath_stop(light_handle_t handle);
+
+esp_err_t light_handle_fade_brightness(light_handle_t handle, uint8_t brightness);
+esp_err_t light_handle_fade_hue(light_handle_t handle, uint16_t hue);
+esp_err_t light_handle_fade_warm(light_handle_t handle, uint8_t color_temperature);
+esp_err_t light_handle_fade_stop(light_handle_t handle);
+
+esp_err_t light_handle_effect_start(light_handle_t handle, light_effect_t effect);
+esp_err_t light_handle_program_start(light_handle_t handle, const iot_led_program_t *program);
+esp_err_t light_handle_effect_stop(light_handle_t handle);
+/**@}*/
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,114 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __LIGHT_FOLLOW_H__
+#define __LIGHT_FOLLOW_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Dead reckoning of a stream of commands, see light_handle_set_follow()
+ *
+ * A command within LIGHT_FOLLOW_TIMEOUT_MS of the previous one, in the same
+ * mode and without a transition of its own, continues a stream. Its output is
+ * extrapolated by one interval of the stream and reached in a linear fade of
+ * that interval, slowed to the largest rate, so the light keeps moving between
+ * the commands instead of restarting an eased fade at each one.
+ *
+ * No timer or lock is used, the caller passes the time and serializes the calls.
+ */
+
+#define LIGHT_FOLLOW_TIMEOUT_MS  (500)  /**< Commands further apart are not a stream */
+#define LIGHT_FOLLOW_INTERVAL_MS (100)  /**< Interval of a stream until it is measured */
+#define LIGHT_FOLLOW_DT_MIN_MS   (20)   /**< Commands closer than one fade step are taken as one step apart */
+
+/**
+ * @brief Fields of a light that are followed
+ */
+typedef enum {
+    LIGHT_FOLLOW_HUE = 0,               /**< 0 .. 359 degrees, wraps around */
+    LIGHT_FOLLOW_SATURATION,            /**< 0 .. 100 % */
+    LIGHT_FOLLOW_VALUE,                 /**< 0 .. 100 % */
+    LIGHT_FOLLOW_COLOR_TEMPERATURE,     /**< 0 .. 100 % */
+    LIGHT_FOLLOW_BRIGHTNESS,            /**< 0 .. 100 % */
+    LIGHT_FOLLOW_FIELD_MAX,
+} light_follow_field_t;
+
+/**
+ * @brief A point of the stream, indexed by light_follow_field_t
+ */
+typedef struct {
+    uint16_t field[LIGHT_FOLLOW_FIELD_MAX];
+} light_follow_point_t;
+
+typedef struct {
+    bool enable;
+    bool active;                                /**< A stream is followed, the output is ahead of the status */
+    uint32_t max_rate;                          /**< Largest change per second, in percent or degrees, 0 for no limit */
+    uint32_t interval_ms;                       /**< Average interval of the stream */
+    int64_t last_us;                            /**< Time of the last command, 0 before the first */
+    int32_t rate[LIGHT_FOLLOW_FIELD_MAX];       /**< Rate of each field, per second in Q8 */
+    light_follow_point_t last;                  /**< Point of the last command */
+    light_follow_point_t target;                /**< Output sent for the last command */
+} light_follow_t;
+
+/**
+ * @brief  Enable or disable following, and forget the current stream
+ *
+ * @param  follow   Follow state
+ * @param  enable   Follow streams of commands
+ * @param  max_rate Largest change per second, in percent or degrees, 0 for no limit
+ */
+void light_follow_config(light_follow_t *follow, bool enable, uint32_t max_rate);
+
+/**
+ * @brief  Follow a command as part of a stream
+ *
+ * A command with a transition of its own always ends the stream, its fade time
+ * and output are left as they are, so that e.g. a 0 ms command is applied at once.
+ *
+ * @param  follow     Follow state
+ * @param  now_us     Time of the command, in microseconds
+ * @param  transition The command carries its own transition
+ * @param  continues  The light was and stays on, in the same HSV or CTB mode
+ * @param  point      Point of the command
+ * @param  output     Point to drive, the prediction in a stream, otherwise the point
+ * @param  fade_ms    Fade time of the command, replaced in a stream
+ *
+ * @return true if the output follows a stream
+ */
+bool light_follow_update(light_follow_t *follow, int64_t now_us, bool transition, bool continues,
+                         const light_follow_point_t *point, light_follow_point_t *output, uint32_t *fade_ms);
+
+/**
+ * @brief  Settle a stream that has ended on its last point, at the largest rate
+ *
+ * @param  follow  Follow state
+ * @param  point   Last point of the stream
+ * @param  fade_ms Fade time to the point
+ *
+ * @return true if a stream was followed and the output must be settled
+ */
+bool light_follow_settle(light_follow_t *follow, const light_follow_point_t *point, uint32_t *fade_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /**< __LIGHT_FOLLOW_H__ */
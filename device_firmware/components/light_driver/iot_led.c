@@ -19,47 +19,178 @@
 
 #include "math.h"
 #include "esp_log.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
 #include "soc/ledc_reg.h"
 #include "soc/timer_group_struct.h"
 #include "soc/ledc_struct.h"
 #include "driver/timer.h"
 #include "driver/ledc.h"
+#ifdef CONFIG_LIGHT_DRIVER_ISR_STATS
+#include "hal/cpu_hal.h"
+#endif
 #include "iot_led.h"
+#include "light_color.h"
+#include "iot_led_gamma.h"
+#include "iot_led_easing.h"
+
+_Static_assert((int)(GAMMA_CORRECTION * 1000 + 0.5) == IOT_LED_GAMMA_CORRECTION_X1000,
+               "Regenerate iot_led_gamma.h with gamma_table.py after changing GAMMA_CORRECTION");
+_Static_assert((int)(GAMMA_CORRECTION * 1000 + 0.5) == IOT_LED_EASING_GAMMA_CORRECTION_X1000
+               && IOT_LED_EASE_MAX - IOT_LED_EASE_IN_CUBIC == EASING_TABLE_NUM && EASING_TABLE_SIZE == 65,
+               "Regenerate iot_led_easing.h with easing_table.py after changing GAMMA_CORRECTION or iot_led_easing_t");
 
 #define LEDC_FADE_MARGIN (10)
-#define LEDC_TIMER_PRECISION (LEDC_TIMER_13_BIT)
-#define LEDC_VALUE_TO_DUTY(value) (value * ((1 << LEDC_TIMER_PRECISION)) / (UINT16_MAX))
-#define LEDC_FIXED_Q (8)
+#define LEDC_FADE_SCALE_SEARCH (16)                                 /**< Scales tried for a long hardware fade */
+#define LEDC_CYCLES_PER_MS_Q (16)
+#define LEDC_FIXED_Q (16)
+#define LEDC_DUTY_DECIMAL_BITS (4)                                  /**< Fractional bits of the LEDC duty register */
+#define LEDC_DITHER_DUTY_MAX (CONFIG_LIGHT_DRIVER_DITHER_THRESHOLD << LEDC_DUTY_DECIMAL_BITS)
+#ifndef LEDC_XTAL_CLK_HZ
+#define LEDC_XTAL_CLK_HZ (40 * 1000 * 1000)
+#endif
+#ifndef LEDC_RTC8M_CLK_HZ
+#ifdef CONFIG_IDF_TARGET_ESP32C3
+#define LEDC_RTC8M_CLK_HZ (17500 * 1000)                             /**< Nominal, the RC oscillator is not calibrated */
+#else
+#define LEDC_RTC8M_CLK_HZ (8 * 1000 * 1000)                          /**< Nominal, the RC oscillator is not calibrated */
+#endif
+#endif
 #define FLOATINT_2_FIXED(X, Q) ((int)((X)*(0x1U << Q)))
 #define FIXED_2_FLOATING(X, Q) ((int)((X)/(0x1U << Q)))
 #define GET_FIXED_INTEGER_PART(X, Q) (X >> Q)
 #define GET_FIXED_DECIMAL_PART(X, Q) (X & ((0x1U << Q) - 1))
-
+#define VALUE16_2_FIXED(X) ((int)((X) * 255 + ((X) >> 8)))          /**< 16-bit value to the 0 .. 255 gamma index in Q16 */
+#define FIXED_2_VALUE16(X) ((uint16_t)(((uint32_t)(X) * 257 + 0x8000) >> 16)) /**< Inverse of VALUE16_2_FIXED, rounded */
+#define LEDC_HSV_FADE_MAX (LEDC_CHANNEL_MAX / 3)
+#define LEDC_PROGRAM_MAX (LEDC_CHANNEL_MAX)
+
+/**
+ * @brief Fade state of all LEDC channels, kept as a structure of arrays so that
+ *        fade_timercb serves the channels of every light in one pass
+ *
+ * cur, final and step are gamma table indexes (0 .. 255) in Q16, so a 16-bit
+ * value and the per-tick step of a slow fade keep their full precision.
+ *
+ * active_mask has a bit for each channel with a fade or blink in progress,
+ * fade_timercb visits only those and stops the timer once it is empty.
+ *
+ * An eased transition computes cur from start, final and its Q16 progress
+ * instead of adding step, step then only tells whether the channel moves.
+ *
+ * A channel is stepped every period ms, DUTY_SET_CYCLE unless its transition
+ * runs as a few long LEDC fades (IOT_LED_FADE_HARDWARE). fade_timercb sets its
+ * alarm to the nearest wait, so the timer only fires when a channel needs it.
+ */
 typedef struct {
-    int cur;
-    int final;
-    int step;
-    int cycle;
-    size_t num;
+    int cur[LEDC_CHANNEL_MAX];
+    int final[LEDC_CHANNEL_MAX];
+    int step[LEDC_CHANNEL_MAX];
+    int cycle[LEDC_CHANNEL_MAX];
+    size_t num[LEDC_CHANNEL_MAX];
+    uint32_t period[LEDC_CHANNEL_MAX];  /**< Time between two steps in ms */
+    uint32_t wait[LEDC_CHANNEL_MAX];    /**< Time left until the next step in ms */
+    int start[LEDC_CHANNEL_MAX];
+    uint32_t progress[LEDC_CHANNEL_MAX];
+    uint32_t progress_step[LEDC_CHANNEL_MAX];
+    uint8_t easing[LEDC_CHANNEL_MAX];   /**< iot_led_easing_t of the transition */
+    uint32_t active_mask;
 } ledc_fade_data_t;
 
+/**
+ * @brief Hue-interpolated fade of a red, green and blue channel
+ *
+ * hue, saturation and value are 16-bit components in Q16.16, so the hue wraps
+ * around the colour circle with plain unsigned overflow.
+ */
+typedef struct {
+    int8_t channel[3];      /**< LEDC channel of red, green and blue, -1 if the slot is free */
+    bool valid;             /**< hue, saturation and value match the output of the channels */
+    uint32_t hue;
+    uint32_t saturation;
+    uint32_t value;
+    int32_t hue_step;
+    int32_t saturation_step;
+    int32_t value_step;
+    uint16_t final[3];      /**< Target hue, saturation and value */
+    uint32_t num;
+    uint8_t easing;         /**< iot_led_easing_t, an eased fade computes the colour from start and delta */
+    uint32_t progress;
+    uint32_t progress_step;
+    uint32_t start[3];
+    int32_t delta[3];       /**< Change of hue, saturation and value, 16-bit */
+} ledc_hsv_fade_t;
+
+/**
+ * @brief Fade program of a group of channels, progress is a Q16 fraction of the current keyframe
+ */
+typedef struct {
+    bool active;
+    uint8_t channel_num;
+    int8_t channel[IOT_LED_PROGRAM_CHANNEL_MAX];
+    iot_led_keyframe_t *keyframes;  /**< Copy in internal RAM, the interrupt may run while the flash cache is disabled */
+    uint8_t keyframe_num;
+    uint8_t loop_from;
+    uint16_t loop_count;            /**< Runs left, 0 runs until stopped */
+    uint8_t index;                  /**< Current keyframe */
+    uint32_t num;                   /**< Ticks left in the current keyframe */
+    uint32_t progress;
+    uint32_t progress_step;
+    uint32_t seed;
+    int start[IOT_LED_PROGRAM_CHANNEL_MAX];
+    int target[IOT_LED_PROGRAM_CHANNEL_MAX];
+} ledc_program_t;
+
 typedef struct {
     timer_group_t timer_group;
     timer_idx_t timer_id;
+    timer_isr_handle_t isr_handle;
 } hw_timer_idx_t;
 
 typedef struct {
-    ledc_fade_data_t fade_data[LEDC_CHANNEL_MAX];
+    ledc_fade_data_t fade_data;
+    ledc_hsv_fade_t hsv_fade[LEDC_HSV_FADE_MAX];
+    ledc_program_t program[LEDC_PROGRAM_MAX];
+    const uint16_t *gamma_table[LEDC_CHANNEL_MAX];  /**< Gamma table of each channel, the shared one unless calibrated */
+    uint16_t *calibration[LEDC_CHANNEL_MAX];        /**< Calibrated gamma table of each channel, NULL if none */
     ledc_mode_t speed_mode;
-    ledc_timer_t timer_num;
+    ledc_timer_t timer_num;     /**< LEDC timer of iot_led_regist_channel() */
+    uint32_t timer_mask;        /**< LEDC timers configured by iot_led_init() or iot_led_timer_config() */
+    uint32_t duty_resolution[LEDC_TIMER_MAX];   /**< Bits of each LEDC timer, read back once it is configured */
+    uint32_t cycles_per_ms[LEDC_TIMER_MAX];     /**< PWM cycles per millisecond of each LEDC timer in Q16 */
+    uint8_t timer_sel[LEDC_CHANNEL_MAX];        /**< LEDC timer of each channel */
+    iot_led_fade_mode_t fade_mode;
+    uint32_t timer_period_ms;   /**< Current alarm interval of the fade timer */
+    uint32_t channel_mask;      /**< Registered channels */
+    uint32_t duty[LEDC_CHANNEL_MAX];    /**< Whole duty each channel is heading to, for ledc_hpoint_update() */
+    uint32_t hpoint[LEDC_CHANNEL_MAX];  /**< Timer count at which each channel switches on */
     hw_timer_idx_t timer_id;
 } iot_light_t;
 
+/**
+ * @brief Cost of fade_timercb, written by the interrupt only
+ *
+ * seq is odd while the interrupt updates stats, a reader copies them until it
+ * finds the same even seq before and after the copy. A reset is requested with
+ * reset and done by the next interrupt, so no lock is taken on either side.
+ */
+typedef struct {
+    uint32_t seq;
+    bool reset;
+    iot_led_isr_stats_t stats;
+} ledc_isr_stats_t;
+
 static const char *TAG = "iot_light";
 static DRAM_ATTR iot_light_t *g_light_config = NULL;
-static DRAM_ATTR uint16_t *g_gamma_table = NULL;
+static DRAM_ATTR const uint16_t *g_gamma_table = s_gamma_table_default;
+static uint16_t *g_gamma_table_custom = NULL;   /**< Table of iot_led_set_gamma_table(), in internal RAM */
 static DRAM_ATTR bool g_hw_timer_started = false;
 static DRAM_ATTR timg_dev_t *TG[2] = {&TIMERG0, &TIMERG1};
+static portMUX_TYPE g_fade_lock = portMUX_INITIALIZER_UNLOCKED; /**< Protects fade_data between tasks and fade_timercb */
+#ifdef CONFIG_LIGHT_DRIVER_ISR_STATS
+static DRAM_ATTR ledc_isr_stats_t g_isr_stats;
+#endif
 
 static IRAM_ATTR esp_err_t _timer_pause(timer_group_t group_num, timer_idx_t timer_num)
 {
@@ -91,7 +222,7 @@ static void iot_timer_create(hw_timer_idx_t *timer_id, bool auto_reload,
     timer_set_alarm_value(timer_id->timer_group, timer_id->timer_id, timer_interval_ms * HW_TIMER_SCALE / 1000);
     timer_enable_intr(timer_id->timer_group, timer_id->timer_id);
     timer_isr_register(timer_id->timer_group, timer_id->timer_id, isr_handle,
-                       (void *) timer_id->timer_id, ESP_INTR_FLAG_IRAM, NULL);
+                       (void *) timer_id->timer_id, ESP_INTR_FLAG_IRAM, &timer_id->isr_handle);
 }
 
 static void iot_timer_start(hw_timer_idx_t *timer_id)
@@ -106,6 +237,39 @@ static IRAM_ATTR void iot_timer_stop(hw_timer_idx_t *timer_id)
     g_hw_timer_started = false;
 }
 
+/**
+ * @brief Let fade_timercb serve the fades just published within DUTY_SET_CYCLE,
+ *        must be called with g_fade_lock held
+ *
+ * The timer may be stopped, or sleeping until the end of a long hardware fade.
+ */
+static void fade_timer_kick(void)
+{
+    hw_timer_idx_t *timer_id = &g_light_config->timer_id;
+    uint64_t counter = 0;
+
+    if (!g_hw_timer_started) {
+        g_light_config->timer_period_ms = DUTY_SET_CYCLE;
+        timer_set_counter_value(timer_id->timer_group, timer_id->timer_id, 0);
+        timer_set_alarm_value(timer_id->timer_group, timer_id->timer_id, DUTY_SET_CYCLE * HW_TIMER_SCALE / 1000);
+        iot_timer_start(timer_id);
+        return;
+    }
+
+    if (g_light_config->timer_period_ms <= DUTY_SET_CYCLE) {
+        return;
+    }
+
+    /**< fade_timercb takes the shortened interval as the time that has passed */
+    timer_get_counter_value(timer_id->timer_group, timer_id->timer_id, &counter);
+    uint32_t period_ms = counter * 1000 / HW_TIMER_SCALE + DUTY_SET_CYCLE;
+
+    if (period_ms < g_light_config->timer_period_ms) {
+        timer_set_alarm_value(timer_id->timer_group, timer_id->timer_id, counter + DUTY_SET_CYCLE * HW_TIMER_SCALE / 1000);
+        g_light_config->timer_period_ms = period_ms;
+    }
+}
+
 static IRAM_ATTR esp_err_t iot_ledc_duty_config(ledc_mode_t speed_mode, ledc_channel_t channel, int hpoint_val, int duty_val,
         uint32_t duty_direction, uint32_t duty_num, uint32_t duty_cycle, uint32_t duty_scale)
 {
@@ -132,9 +296,9 @@ static IRAM_ATTR esp_err_t iot_ledc_duty_config(ledc_mode_t speed_mode, ledc_cha
     return ESP_OK;
 }
 
-static IRAM_ATTR esp_err_t _iot_set_fade_with_step(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t target_duty, int scale, int cycle_num)
+static IRAM_ATTR esp_err_t _iot_set_fade_with_step(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty_cur,
+                                                    uint32_t target_duty, int scale, int cycle_num)
 {
-    uint32_t duty_cur = LEDC.channel_group[speed_mode].channel[channel].duty_rd.duty_read >> 4;
     int step_num = 0;
     int dir = LEDC_DUTY_DIR_DECREASE;
 
@@ -160,52 +324,63 @@ static IRAM_ATTR esp_err_t _iot_set_fade_with_step(ledc_mode_t speed_mode, ledc_
     return ESP_OK;
 }
 
+/**
+ * @brief Start a hardware fade from the current duty, the PWM frequency is
+ *        cached by ledc_timer_params_update(), so no LEDC timer register is read
+ */
 static IRAM_ATTR esp_err_t _iot_set_fade_with_time(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t target_duty, int max_fade_time_ms)
 {
-    uint32_t freq = 0;
     uint32_t duty_cur = LEDC.channel_group[speed_mode].channel[channel].duty_rd.duty_read >> 4;
     uint32_t duty_delta = target_duty > duty_cur ? target_duty - duty_cur : duty_cur - target_duty;
 
-    uint32_t timer_source_clk = LEDC.timer_group[speed_mode].timer[g_light_config->timer_num].conf.tick_sel;
-    uint32_t duty_resolution = LEDC.timer_group[speed_mode].timer[g_light_config->timer_num].conf.duty_resolution;
-    uint32_t clock_divider = LEDC.timer_group[speed_mode].timer[g_light_config->timer_num].conf.clock_divider;
-    uint32_t precision = (0x1U << duty_resolution);
-
-    if (timer_source_clk == LEDC_APB_CLK) {
-        freq = ((uint64_t)LEDC_APB_CLK_HZ << 8) / precision / clock_divider;
-    } else {
-        freq = ((uint64_t)LEDC_REF_CLK_HZ << 8) / precision / clock_divider;
-    }
-
     if (duty_delta == 0) {
-        return _iot_set_fade_with_step(speed_mode, channel, target_duty, 0, 0);
+        return _iot_set_fade_with_step(speed_mode, channel, duty_cur, target_duty, 0, 0);
     }
 
-    int total_cycles = max_fade_time_ms * freq / 1000;
+    uint32_t cycles_per_ms = g_light_config->cycles_per_ms[g_light_config->timer_sel[channel]];
+    int total_cycles = ((uint64_t)max_fade_time_ms * cycles_per_ms) >> LEDC_CYCLES_PER_MS_Q;
 
     if (total_cycles == 0) {
-        return _iot_set_fade_with_step(speed_mode, channel, target_duty, 0, 0);
+        return _iot_set_fade_with_step(speed_mode, channel, duty_cur, target_duty, 0, 0);
     }
 
-    int scale, cycle_num;
+    /**< The scale is raised until the fade fits in the 1023 steps of the LEDC, a long one needs that */
+    int scale = duty_delta / total_cycles;
+    int scale_min = (duty_delta + LEDC_DUTY_NUM_LSCH0_V - 1) / LEDC_DUTY_NUM_LSCH0_V;
 
-    if (total_cycles > duty_delta) {
-        scale = 1;
-        cycle_num = total_cycles / duty_delta;
+    scale = (scale > scale_min) ? scale : scale_min;
+    scale = (scale > LEDC_DUTY_SCALE_LSCH0_V) ? LEDC_DUTY_SCALE_LSCH0_V : scale;
 
-        if (cycle_num > LEDC_DUTY_NUM_LSCH0_V) {
-            cycle_num = LEDC_DUTY_NUM_LSCH0_V;
-        }
-    } else {
-        cycle_num = 1;
-        scale = duty_delta / total_cycles;
+    int cycle_num = total_cycles / (duty_delta / scale);
 
-        if (scale > LEDC_DUTY_SCALE_LSCH0_V) {
-            scale = LEDC_DUTY_SCALE_LSCH0_V;
+    /**
+     * @brief The time of a fade is (duty_delta / scale) * cycle_num, for the long fades of
+     *        IOT_LED_FADE_HARDWARE search the pair that comes closest, the per-tick fades
+     *        are short and overwritten on the next tick anyway
+     */
+    if (max_fade_time_ms > DUTY_SET_CYCLE) {
+        int error_min = INT32_MAX;
+
+        for (int i = scale; i < scale + LEDC_FADE_SCALE_SEARCH && i <= LEDC_DUTY_SCALE_LSCH0_V; i++) {
+            int step_num = duty_delta / i;
+            int cycles = (total_cycles + step_num / 2) / step_num;
+            int error = abs(step_num * cycles - total_cycles);
+
+            if (cycles > 0 && cycles <= LEDC_DUTY_CYCLE_LSCH0_V && error < error_min) {
+                error_min = error;
+                scale     = i;
+                cycle_num = cycles;
+            }
         }
     }
 
-    return _iot_set_fade_with_step(speed_mode, channel, target_duty, scale, cycle_num);
+    if (cycle_num < 1) {
+        cycle_num = 1;
+    } else if (cycle_num > LEDC_DUTY_CYCLE_LSCH0_V) {
+        cycle_num = LEDC_DUTY_CYCLE_LSCH0_V;
+    }
+
+    return _iot_set_fade_with_step(speed_mode, channel, duty_cur, target_duty, scale, cycle_num);
 }
 
 static IRAM_ATTR esp_err_t _iot_update_duty(ledc_mode_t speed_mode, ledc_channel_t channel)
@@ -220,12 +395,15 @@ static IRAM_ATTR esp_err_t _iot_update_duty(ledc_mode_t speed_mode, ledc_channel
     return ESP_OK;
 }
 
+/**
+ * @brief Set the duty directly, duty is in 1/16 LSB, the LEDC dithers the fractional bits
+ */
 static IRAM_ATTR esp_err_t iot_ledc_set_duty(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty)
 {
     return iot_ledc_duty_config(speed_mode,
                                 channel,         // uint32_t chan_num,
                                 -1,
-                                duty << 4,       // uint32_t duty_val,the least 4 bits are decimal part
+                                duty,            // uint32_t duty_val,the least 4 bits are decimal part
                                 1,               // uint32_t increase,
                                 1,               // uint32_t duty_num,
                                 1,               // uint32_t duty_cycle,
@@ -233,41 +411,406 @@ static IRAM_ATTR esp_err_t iot_ledc_set_duty(ledc_mode_t speed_mode, ledc_channe
                                );
 }
 
-static void gamma_table_create(uint16_t *gamma_table, float correction)
+/**
+ * @brief Remember the duty of a channel for ledc_hpoint_update(), duty is in 1/16 LSB
+ *
+ * A hardware fade passes through every duty between the current and the target
+ * one, the larger of the two is the longest the channel is on.
+ */
+static IRAM_ATTR void ledc_hpoint_duty(int channel, uint32_t duty, bool fade)
 {
-    float value_tmp = 0;
+    uint32_t duty_cur = LEDC.channel_group[g_light_config->speed_mode].channel[channel].duty_rd.duty_read;
 
-    /**
-     * @brief gamma curve formula: y=a*x^(1/gm)
-     * x ∈ (0,(GAMMA_TABLE_SIZE-1)/GAMMA_TABLE_SIZE)
-     * a = GAMMA_TABLE_SIZE
-     */
-    for (int i = 0; i < GAMMA_TABLE_SIZE; i++) {
-        value_tmp = (float)(i) / (GAMMA_TABLE_SIZE - 1);
-        value_tmp = powf(value_tmp, 1.0f / correction);
-        gamma_table[i] = (uint16_t)FLOATINT_2_FIXED((value_tmp * GAMMA_TABLE_SIZE), LEDC_FIXED_Q);
-    }
+    duty = (fade && duty_cur > duty) ? duty_cur : duty;
+    g_light_config->duty[channel] = (duty + BIT(LEDC_DUTY_DECIMAL_BITS) - 1) >> LEDC_DUTY_DECIMAL_BITS;
+}
+
+/**
+ * @brief Stagger the on-phases of the registered channels across the PWM period
+ *
+ * Each channel switches on where the previous one of its LEDC timer switches
+ * off, so their currents only add up once the duties together exceed the
+ * period. A channel never wraps past the end of the period, the ones that no
+ * longer fit are moved back and overlap the others there. Only changed hpoints
+ * are written, each one latched by a duty update of its own channel: the channels
+ * of written_mask with the duty fade_timercb just wrote, an idle channel with its
+ * current duty. A channel in the middle of a hardware fade is not touched, its
+ * hpoint moves at its next duty update. Must be called with g_fade_lock held.
+ */
+static IRAM_ATTR void ledc_hpoint_update(uint32_t written_mask)
+{
+    ledc_mode_t speed_mode = g_light_config->speed_mode;
+    uint32_t start[LEDC_TIMER_MAX] = {0};
+    uint32_t busy_mask = g_light_config->fade_data.active_mask & ~written_mask;
+
+    for (uint32_t mask = g_light_config->channel_mask; mask; mask &= mask - 1) {
+        int channel = __builtin_ctz(mask);
+        int timer_sel = g_light_config->timer_sel[channel];
+        uint32_t period = BIT(g_light_config->duty_resolution[timer_sel]);
+        uint32_t duty = (g_light_config->duty[channel] < period) ? g_light_config->duty[channel] : period;
+        uint32_t hpoint = (start[timer_sel] + duty > period) ? period - duty : start[timer_sel];
 
-    if (gamma_table[255] == 0) {
-        gamma_table[255] = __UINT16_MAX__;
+        start[timer_sel] += duty;
+
+        if (duty == 0 || hpoint == g_light_config->hpoint[channel] || (busy_mask & BIT(channel))) {
+            continue;
+        }
+
+        g_light_config->hpoint[channel] = hpoint;
+        LEDC.channel_group[speed_mode].channel[channel].hpoint.hpoint = hpoint & LEDC_HPOINT_LSCH1_V;
+
+        if (!(written_mask & BIT(channel))) {
+            iot_ledc_set_duty(speed_mode, channel, LEDC.channel_group[speed_mode].channel[channel].duty_rd.duty_read);
+        } else if (speed_mode == LEDC_LOW_SPEED_MODE) {
+            LEDC.channel_group[speed_mode].channel[channel].conf0.low_speed_update = 1;
+        }
     }
 }
 
-static IRAM_ATTR uint32_t gamma_value_to_duty(int value)
+/**
+ * @brief value * 2^(duty_resolution + 4) / 65535, the exact duty in 1/16 LSB without a division
+ */
+static IRAM_ATTR uint32_t ledc_value_to_duty(uint32_t value, uint32_t duty_resolution)
 {
+    uint64_t tmp = (uint64_t)value << (duty_resolution + LEDC_DUTY_DECIMAL_BITS);
+    return (tmp + (tmp >> 16) + (tmp >> 32) + 1) >> 16;
+}
+
+/**
+ * @brief Duty in 1/16 LSB of a Q16 gamma index, through the gamma table and
+ *        at the resolution of the LEDC timer of the channel
+ *
+ * The LEDC spreads the fractional bits over 16 PWM periods, which resolves the
+ * steps that a single LSB makes at the bottom of the curve. Above LEDC_DITHER_DUTY_MAX
+ * a LSB is below what the eye sees, so the duty is kept whole there.
+ */
+static IRAM_ATTR uint32_t gamma_value_to_duty(int channel, int value)
+{
+    const uint16_t *gamma_table = g_light_config->gamma_table[channel];
+    uint32_t duty_resolution = g_light_config->duty_resolution[g_light_config->timer_sel[channel]];
     uint32_t tmp_q = GET_FIXED_INTEGER_PART(value, LEDC_FIXED_Q);
     uint32_t tmp_r = GET_FIXED_DECIMAL_PART(value, LEDC_FIXED_Q);
 
-    uint16_t cur = LEDC_VALUE_TO_DUTY(g_gamma_table[tmp_q]);
-    uint16_t next = tmp_q < (GAMMA_TABLE_SIZE - 1) ? LEDC_VALUE_TO_DUTY(g_gamma_table[tmp_q + 1]) : cur;
-    uint32_t tmp = (cur + (next - cur) * tmp_r / (0x1U << LEDC_FIXED_Q));
+    int cur = ledc_value_to_duty(gamma_table[tmp_q], duty_resolution);
+    int next = tmp_q < (GAMMA_TABLE_SIZE - 1) ? ledc_value_to_duty(gamma_table[tmp_q + 1], duty_resolution) : cur;
+    uint32_t tmp = cur + (((next - cur) * (int)(tmp_r >> LEDC_DUTY_DECIMAL_BITS)) >> (LEDC_FIXED_Q - LEDC_DUTY_DECIMAL_BITS));
+
+    if (tmp >= LEDC_DITHER_DUTY_MAX) {
+        tmp &= ~(BIT(LEDC_DUTY_DECIMAL_BITS) - 1);
+    }
+
     return tmp;
 }
 
+/**
+ * @brief Build the gamma table of a calibrated channel, runs in task context
+ */
+static void calibration_table_create(uint16_t *gamma_table, const iot_led_calibration_t *calibration)
+{
+    float exponent = calibration->gamma_x1000 ? 1000.0f / calibration->gamma_x1000 : 0;
+
+    gamma_table[0] = 0;
+
+    for (int i = 1; i < GAMMA_TABLE_SIZE; i++) {
+        uint32_t value = g_gamma_table[i];
+
+        if (calibration->gamma_x1000) {
+            value = (uint32_t)(powf((float)i / (GAMMA_TABLE_SIZE - 1), exponent) * UINT16_MAX);
+        }
+
+        value = calibration->offset + (value * calibration->gain + UINT16_MAX / 2) / UINT16_MAX;
+        gamma_table[i] = (value > UINT16_MAX) ? UINT16_MAX : value;
+    }
+}
+
+/**
+ * @brief Map a Q16 progress (0 .. 0x10000) through an easing curve
+ */
+static IRAM_ATTR uint32_t fade_ease(uint8_t easing, uint32_t progress)
+{
+    uint32_t t = progress >> 4;
+
+    if (progress >= 0x10000) {
+        return 0x10000;
+    }
+
+    switch (easing) {
+        case IOT_LED_EASE_LINEAR:
+            return progress;
+
+        case IOT_LED_EASE_STEP:
+            return 0x10000;
+
+        case IOT_LED_EASE_SMOOTH:
+            /**< t * t * (3 - 2 * t) in Q12, scaled back to Q16 */
+            return ((t * t) >> 12) * (3 * 0x1000 - 2 * t) >> 8;
+
+        default: {
+            /**< 64 segments, the low 10 bits of the progress interpolate within one */
+            const uint16_t *table = s_easing_table[easing - IOT_LED_EASE_IN_CUBIC];
+            uint32_t index = progress >> 10;
+            int cur = table[index];
+            uint32_t value = cur + (((table[index + 1] - cur) * (int)(progress & 0x3FF)) >> 10);
+
+            /**< 0xFFFF of the table is 0x10000 */
+            return value + (value >> 15);
+        }
+    }
+}
+
+/**
+ * @brief Eased Q16 fraction of a fade, the lightness curve is made for a fade
+ *        up from off, so a fade down runs it backwards
+ */
+static IRAM_ATTR uint32_t fade_ease_dir(uint8_t easing, uint32_t progress, bool down)
+{
+    progress = (progress > 0x10000) ? 0x10000 : progress;
+
+    if (easing == IOT_LED_EASE_PERCEPTUAL && down) {
+        return 0x10000 - fade_ease(easing, 0x10000 - progress);
+    }
+
+    return fade_ease(easing, progress);
+}
+
+/**
+ * @brief Value of an eased fade from start to final at the Q16 progress
+ */
+static IRAM_ATTR int fade_ease_value(uint8_t easing, int start, int final, uint32_t progress)
+{
+    return start + (int)(((int64_t)(final - start) * fade_ease_dir(easing, progress, final < start)) >> 16);
+}
+
+/**
+ * @brief Let the channel loop of fade_timercb move the channel to value (Q16) during this tick
+ *
+ * Two steps ramp the LEDC duty over this tick and are overwritten on the next one,
+ * the last tick of a fade sets the duty directly.
+ */
+static IRAM_ATTR void fade_data_ramp(ledc_fade_data_t *fade_data, int channel, int value, bool last)
+{
+    fade_data->step[channel]  = value - fade_data->cur[channel];
+    fade_data->final[channel] = value;
+    fade_data->num[channel]   = last ? 1 : 2;
+    fade_data->cycle[channel] = 0;
+    fade_data->period[channel] = DUTY_SET_CYCLE;
+    fade_data->wait[channel]  = 0;
+    fade_data->easing[channel] = IOT_LED_EASE_LINEAR;
+    fade_data->active_mask   |= BIT(channel);
+}
+
+/**
+ * @brief Advance the hue-interpolated fade by one tick and let the channel loop
+ *        of fade_timercb move red, green and blue to the new colour
+ */
+static IRAM_ATTR void hsv_fade_step(ledc_hsv_fade_t *hsv_fade, ledc_fade_data_t *fade_data)
+{
+    uint16_t rgb[3] = {0};
+
+    hsv_fade->num--;
+
+    if (hsv_fade->num && hsv_fade->easing != IOT_LED_EASE_LINEAR) {
+        hsv_fade->progress += hsv_fade->progress_step;
+        int64_t eased = fade_ease_dir(hsv_fade->easing, hsv_fade->progress, hsv_fade->delta[2] < 0);
+
+        hsv_fade->hue        = hsv_fade->start[0] + (uint32_t)(hsv_fade->delta[0] * eased);
+        hsv_fade->saturation = hsv_fade->start[1] + (uint32_t)(hsv_fade->delta[1] * eased);
+        hsv_fade->value      = hsv_fade->start[2] + (uint32_t)(hsv_fade->delta[2] * eased);
+    } else if (hsv_fade->num) {
+        hsv_fade->hue        += hsv_fade->hue_step;
+        hsv_fade->saturation += hsv_fade->saturation_step;
+        hsv_fade->value      += hsv_fade->value_step;
+    } else {
+        hsv_fade->hue        = (uint32_t)hsv_fade->final[0] << 16;
+        hsv_fade->saturation = (uint32_t)hsv_fade->final[1] << 16;
+        hsv_fade->value      = (uint32_t)hsv_fade->final[2] << 16;
+    }
+
+    light_color_hsv2rgb(hsv_fade->hue >> 16, hsv_fade->saturation >> 16, hsv_fade->value >> 16,
+                        &rgb[0], &rgb[1], &rgb[2]);
+
+    for (int i = 0; i < 3; i++) {
+        fade_data_ramp(fade_data, hsv_fade->channel[i], VALUE16_2_FIXED(rgb[i]), hsv_fade->num == 0);
+    }
+}
+
+/**
+ * @brief Stop the hue-interpolated fades that drive any of the channels, must be called with g_fade_lock held
+ */
+static void hsv_fade_cancel(uint32_t channel_mask)
+{
+    for (int i = 0; i < LEDC_HSV_FADE_MAX; i++) {
+        ledc_hsv_fade_t *hsv_fade = g_light_config->hsv_fade + i;
+
+        if (hsv_fade->channel[0] < 0) {
+            continue;
+        }
+
+        for (int j = 0; j < 3; j++) {
+            if (channel_mask & BIT(hsv_fade->channel[j])) {
+                hsv_fade->num   = 0;
+                hsv_fade->valid = false;
+            }
+        }
+    }
+}
+
+static IRAM_ATTR uint32_t program_rand(ledc_program_t *program)
+{
+    uint32_t x = program->seed;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    return program->seed = x;
+}
+
+
+/**
+ * @brief Start the current keyframe from the targets of the previous one, must be called with g_fade_lock held
+ */
+static IRAM_ATTR void program_keyframe_start(ledc_program_t *program)
+{
+    const iot_led_keyframe_t *keyframe = program->keyframes + program->index;
+    uint32_t num = keyframe->duration_ms / DUTY_SET_CYCLE;
+
+    program->num           = num ? num : 1;
+    program->progress      = 0;
+    program->progress_step = 0x10000 / program->num;
+
+    for (int i = 0; i < program->channel_num; i++) {
+        int target = keyframe->values[i];
+
+        if (keyframe->jitter) {
+            target += (int)(((program_rand(program) & 0xFFFF) * (2 * keyframe->jitter + 1)) >> 16) - keyframe->jitter;
+            target  = (target < 0) ? 0 : (target > UINT8_MAX) ? UINT8_MAX : target;
+        }
+
+        program->start[i]  = program->target[i];
+        program->target[i] = FLOATINT_2_FIXED(target, LEDC_FIXED_Q);
+    }
+}
+
+/**
+ * @brief Advance the fade program by one tick and move to the next keyframe at its end
+ */
+static IRAM_ATTR void program_step(ledc_program_t *program, ledc_fade_data_t *fade_data)
+{
+    const iot_led_keyframe_t *keyframe = program->keyframes + program->index;
+    bool last = false;
+
+    program->num--;
+    program->progress += program->progress_step;
+
+    uint32_t progress = program->num ? program->progress : 0x10000;
+
+    if (program->num == 0 && program->index + 1 >= program->keyframe_num) {
+        last = (program->loop_count == 1);
+    }
+
+    for (int i = 0; i < program->channel_num; i++) {
+        int value = fade_ease_value(keyframe->easing, program->start[i], program->target[i], progress);
+        fade_data_ramp(fade_data, program->channel[i], value, last);
+    }
+
+    if (program->num) {
+        return;
+    }
+
+    if (++program->index >= program->keyframe_num) {
+        if (last) {
+            program->active = false;
+            return;
+        }
+
+        if (program->loop_count) {
+            program->loop_count--;
+        }
+
+        program->index = program->loop_from;
+    }
+
+    program_keyframe_start(program);
+}
+
+/**
+ * @brief Stop the fade programs that drive any of the channels, must be called with g_fade_lock held
+ *
+ * The channels of a stopped program keep the value of their last tick.
+ */
+static void program_cancel(uint32_t channel_mask)
+{
+    ledc_fade_data_t *fade_data = &g_light_config->fade_data;
+
+    for (int i = 0; i < LEDC_PROGRAM_MAX; i++) {
+        ledc_program_t *program = g_light_config->program + i;
+        uint32_t program_mask = 0;
+
+        if (!program->active) {
+            continue;
+        }
+
+        for (int j = 0; j < program->channel_num; j++) {
+            program_mask |= BIT(program->channel[j]);
+        }
+
+        if (!(channel_mask & program_mask)) {
+            continue;
+        }
+
+        program->active = false;
+
+        for (int j = 0; j < program->channel_num; j++) {
+            fade_data->step[program->channel[j]] = 0;
+            fade_data->num[program->channel[j]]  = 0;
+        }
+
+        fade_data->active_mask &= ~program_mask;
+    }
+}
+
+#ifdef CONFIG_LIGHT_DRIVER_ISR_STATS
+/**
+ * @brief Account one run of fade_timercb, called from the interrupt only
+ */
+static IRAM_ATTR void ledc_isr_stats_record(uint32_t cycles, uint32_t channels, uint32_t missed)
+{
+    iot_led_isr_stats_t *stats = &g_isr_stats.stats;
+    int bucket = 32 - __builtin_clz(cycles | 1) - IOT_LED_ISR_HIST_SHIFT;
+
+    bucket = (bucket < 0) ? 0 : (bucket >= IOT_LED_ISR_HIST_NUM) ? IOT_LED_ISR_HIST_NUM - 1 : bucket;
+
+    __atomic_store_n(&g_isr_stats.seq, g_isr_stats.seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&g_isr_stats.reset, __ATOMIC_RELAXED)) {
+        memset(stats, 0, sizeof(iot_led_isr_stats_t));
+        __atomic_store_n(&g_isr_stats.reset, false, __ATOMIC_RELAXED);
+    }
+
+    stats->cycles_min    = (!stats->count || cycles < stats->cycles_min) ? cycles : stats->cycles_min;
+    stats->cycles_max    = (cycles > stats->cycles_max) ? cycles : stats->cycles_max;
+    stats->cycles_total += cycles;
+    stats->hist[bucket]++;
+    stats->count++;
+    stats->channels     += channels;
+    stats->channels_max  = (channels > stats->channels_max) ? channels : stats->channels_max;
+    stats->missed       += missed;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    __atomic_store_n(&g_isr_stats.seq, g_isr_stats.seq + 1, __ATOMIC_RELAXED);
+}
+#endif
+
 static IRAM_ATTR void fade_timercb(void *para)
 {
     int timer_idx = (int) para;
-    int idle_channel_num = 0;
+#ifdef CONFIG_LIGHT_DRIVER_ISR_STATS
+    uint32_t isr_cycles = cpu_hal_get_cycle_count();
+    /**< The alarm reloaded the counter, so it holds the interrupt latency */
+    uint64_t isr_latency = timer_group_get_counter_value_in_isr(HW_TIMER_GROUP, timer_idx);
+#endif
 
     if (HW_TIMER_GROUP == TIMER_GROUP_0) {
         /* Retrieve the interrupt status */
@@ -329,56 +872,168 @@ static IRAM_ATTR void fade_timercb(void *para)
     }
 #endif
 
-    for (int channel = 0; channel < LEDC_CHANNEL_MAX; channel++) {
-        ledc_fade_data_t *fade_data = g_light_config->fade_data + channel;
+    portENTER_CRITICAL_ISR(&g_fade_lock);
 
-        if (fade_data->num > 0) {
-            fade_data->num--;
+    ledc_fade_data_t *fade_data = &g_light_config->fade_data;
+#ifdef CONFIG_LIGHT_DRIVER_ISR_STATS
+    uint32_t missed = isr_latency / ((uint64_t)g_light_config->timer_period_ms * HW_TIMER_SCALE / 1000);
+#endif
+
+    for (int i = 0; i < LEDC_HSV_FADE_MAX; i++) {
+        if (g_light_config->hsv_fade[i].num > 0) {
+            hsv_fade_step(g_light_config->hsv_fade + i, fade_data);
+        }
+    }
+
+    for (int i = 0; i < LEDC_PROGRAM_MAX; i++) {
+        if (g_light_config->program[i].active) {
+            program_step(g_light_config->program + i, fade_data);
+        }
+    }
 
-            if (fade_data->step) {
-                fade_data->cur += fade_data->step;
+    uint32_t elapsed = g_light_config->timer_period_ms;
+    uint32_t next = UINT32_MAX;
+    uint32_t written_mask = 0;
 
-                if (fade_data->num != 0) {
-                    _iot_set_fade_with_time(g_light_config->speed_mode, channel,
-                                            gamma_value_to_duty(fade_data->cur),
-                                            DUTY_SET_CYCLE - LEDC_FADE_MARGIN);
-                } else {
-                    iot_ledc_set_duty(g_light_config->speed_mode, channel, gamma_value_to_duty(fade_data->cur));
-                }
+    for (uint32_t mask = fade_data->active_mask; mask; mask &= mask - 1) {
+        int channel = __builtin_ctz(mask);
 
-                _iot_update_duty(g_light_config->speed_mode, channel);
+        if (fade_data->wait[channel] > elapsed) {
+            fade_data->wait[channel] -= elapsed;
+            next = (fade_data->wait[channel] < next) ? fade_data->wait[channel] : next;
+            continue;
+        }
+
+        fade_data->wait[channel] = fade_data->period[channel];
+        next = (fade_data->period[channel] < next) ? fade_data->period[channel] : next;
+
+        if (fade_data->num[channel] > 0) {
+            fade_data->num[channel]--;
+
+            if (fade_data->easing[channel] != IOT_LED_EASE_LINEAR) {
+                fade_data->progress[channel] += fade_data->progress_step[channel];
+                fade_data->cur[channel] = fade_ease_value(fade_data->easing[channel], fade_data->start[channel],
+                                                          fade_data->final[channel], fade_data->progress[channel]);
             } else {
-                iot_ledc_set_duty(g_light_config->speed_mode, channel, gamma_value_to_duty(fade_data->cur));
-                _iot_update_duty(g_light_config->speed_mode, channel);
+                fade_data->cur[channel] += fade_data->step[channel];
             }
-        } else if (fade_data->cycle) {
-            fade_data->num = fade_data->cycle - 1;
 
-            if (fade_data->step) {
-                fade_data->step *= -1;
-                fade_data->cur  += fade_data->step;
+            /**< The integer steps leave a remainder, the last one of a fade lands on the target */
+            if (fade_data->num[channel] == 0 && !fade_data->cycle[channel]) {
+                fade_data->cur[channel] = fade_data->final[channel];
+                fade_data->active_mask &= ~BIT(channel);
+            }
+
+            uint32_t duty = gamma_value_to_duty(channel, fade_data->cur[channel]);
+
+            ledc_hpoint_duty(channel, duty, fade_data->step[channel] && fade_data->num[channel] != 0);
+
+            if (fade_data->step[channel] && fade_data->num[channel] != 0) {
+                _iot_set_fade_with_time(g_light_config->speed_mode, channel, duty >> LEDC_DUTY_DECIMAL_BITS,
+                                        fade_data->period[channel] - LEDC_FADE_MARGIN);
             } else {
-                fade_data->cur = (fade_data->cur == fade_data->final) ? 0 : fade_data->final;
+                iot_ledc_set_duty(g_light_config->speed_mode, channel, duty);
             }
 
-            _iot_set_fade_with_time(g_light_config->speed_mode, channel,
-                                    gamma_value_to_duty(fade_data->cur),
+            _iot_update_duty(g_light_config->speed_mode, channel);
+            written_mask |= BIT(channel);
+        } else if (fade_data->cycle[channel]) {
+            fade_data->num[channel] = fade_data->cycle[channel] - 1;
+
+            if (fade_data->step[channel]) {
+                fade_data->step[channel] *= -1;
+                fade_data->cur[channel]  += fade_data->step[channel];
+            } else {
+                fade_data->cur[channel] = (fade_data->cur[channel] == fade_data->final[channel]) ? 0 : fade_data->final[channel];
+            }
+
+            uint32_t duty = gamma_value_to_duty(channel, fade_data->cur[channel]);
+
+            ledc_hpoint_duty(channel, duty, true);
+            _iot_set_fade_with_time(g_light_config->speed_mode, channel, duty >> LEDC_DUTY_DECIMAL_BITS,
                                     DUTY_SET_CYCLE - LEDC_FADE_MARGIN);
             _iot_update_duty(g_light_config->speed_mode, channel);
+            written_mask |= BIT(channel);
 
         } else {
-            idle_channel_num++;
+            fade_data->active_mask &= ~BIT(channel);
         }
     }
 
-    if (idle_channel_num >= LEDC_CHANNEL_MAX) {
+    if (written_mask) {
+        ledc_hpoint_update(written_mask);
+    }
+
+    if (!fade_data->active_mask) {
         iot_timer_stop(&g_light_config->timer_id);
+    } else if (next != g_light_config->timer_period_ms) {
+        /**< Sleep until the next step of any channel, the counter restarted from 0 at this alarm */
+        timer_group_set_alarm_value_in_isr(g_light_config->timer_id.timer_group, g_light_config->timer_id.timer_id,
+                                           (uint64_t)next * HW_TIMER_SCALE / 1000);
+        g_light_config->timer_period_ms = next;
     }
+
+    portEXIT_CRITICAL_ISR(&g_fade_lock);
+
+#ifdef CONFIG_LIGHT_DRIVER_ISR_STATS
+    ledc_isr_stats_record(cpu_hal_get_cycle_count() - isr_cycles, __builtin_popcount(written_mask), missed);
+#endif
 }
 
-esp_err_t iot_led_init(ledc_timer_t timer_num, ledc_mode_t speed_mode, uint32_t freq_hz, ledc_clk_cfg_t clk_cfg, ledc_timer_bit_t duty_resolution)
+/**
+ * @brief Frequency of the source clock selected by clk_cfg, LEDC_AUTO_CLK runs
+ *        the frequencies of a light from the APB clock
+ */
+static uint32_t ledc_clk_cfg_hz(ledc_clk_cfg_t clk_cfg)
 {
-    esp_err_t ret = ESP_OK;
+    switch (clk_cfg) {
+        case LEDC_USE_RTC8M_CLK:
+            return LEDC_RTC8M_CLK_HZ;
+
+#ifdef CONFIG_IDF_TARGET_ESP32C3
+        case LEDC_USE_XTAL_CLK:
+            return LEDC_XTAL_CLK_HZ;
+#else
+        case LEDC_USE_REF_TICK:
+            return LEDC_REF_CLK_HZ;
+#endif
+
+        default:
+            return LEDC_APB_CLK_HZ;
+    }
+}
+
+/**
+ * @brief Highest duty resolution of freq_hz, the clock divider of the LEDC
+ *        timer must not go below 1
+ */
+static ledc_timer_bit_t ledc_duty_resolution_max(uint32_t freq_hz, ledc_clk_cfg_t clk_cfg)
+{
+    uint32_t ratio = ledc_clk_cfg_hz(clk_cfg) / freq_hz;
+    int duty_resolution = ratio ? 31 - __builtin_clz(ratio) : 0;
+
+    if (duty_resolution >= LEDC_TIMER_BIT_MAX) {
+        duty_resolution = LEDC_TIMER_BIT_MAX - 1;
+    }
+
+    return (ledc_timer_bit_t)duty_resolution;
+}
+
+/**
+ * @brief Configure a LEDC timer, IOT_LED_DUTY_RESOLUTION_AUTO selects the highest resolution
+ */
+static esp_err_t ledc_timer_setup(ledc_mode_t speed_mode, ledc_timer_t timer_num, uint32_t freq_hz,
+                                  ledc_clk_cfg_t clk_cfg, ledc_timer_bit_t duty_resolution)
+{
+    LIGHT_PARAM_CHECK(timer_num < LEDC_TIMER_MAX);
+    LIGHT_PARAM_CHECK(freq_hz > 0);
+
+    if (duty_resolution == IOT_LED_DUTY_RESOLUTION_AUTO) {
+        duty_resolution = ledc_duty_resolution_max(freq_hz, clk_cfg);
+        LIGHT_ERROR_CHECK(duty_resolution == 0, ESP_ERR_INVALID_ARG, "frequency %u Hz is too high for the clock", freq_hz);
+        ESP_LOGI(TAG, "LEDC timer %d: %u Hz, %d bits", timer_num, freq_hz, duty_resolution);
+    }
+
     const ledc_timer_config_t ledc_time_config = {
         .speed_mode      = speed_mode,
         .duty_resolution = duty_resolution,
@@ -387,29 +1042,64 @@ esp_err_t iot_led_init(ledc_timer_t timer_num, ledc_mode_t speed_mode, uint32_t
         .clk_cfg         = clk_cfg,
     };
 
-    ret = ledc_timer_config(&ledc_time_config);
-    LIGHT_ERROR_CHECK(ret != ESP_OK, ret, "LEDC timer configuration");
+    return ledc_timer_config(&ledc_time_config);
+}
 
-    if (g_gamma_table == NULL) {
-        /* g_gamma_table[GAMMA_TABLE_SIZE] must be 0 */
-        g_gamma_table = calloc(GAMMA_TABLE_SIZE + 1, sizeof(uint16_t));
-        gamma_table_create(g_gamma_table, GAMMA_CORRECTION);
-    } else {
-        ESP_LOGE(TAG, "gamma_table has been initialized");
-    }
+/**
+ * @brief Cache the resolution and frequency of a LEDC timer for fade_timercb,
+ *        must be called whenever the timer is configured
+ *
+ * The frequency is read back from the registers, so it includes the rounding
+ * of the clock divider.
+ */
+static void ledc_timer_params_update(ledc_timer_t timer_num, ledc_clk_cfg_t clk_cfg)
+{
+    uint32_t timer_source_clk = LEDC.timer_group[g_light_config->speed_mode].timer[timer_num].conf.tick_sel;
+    uint32_t duty_resolution = LEDC.timer_group[g_light_config->speed_mode].timer[timer_num].conf.duty_resolution;
+    uint32_t clock_divider = LEDC.timer_group[g_light_config->speed_mode].timer[timer_num].conf.clock_divider;
+    uint64_t source_clk_hz = (timer_source_clk == LEDC_APB_CLK) ? ledc_clk_cfg_hz(clk_cfg) : LEDC_REF_CLK_HZ;
+
+    /**< clock_divider has 8 fractional bits */
+    uint64_t cycles_per_ms = (source_clk_hz << (8 + LEDC_CYCLES_PER_MS_Q)) / clock_divider / 1000;
+
+    portENTER_CRITICAL(&g_fade_lock);
+    g_light_config->duty_resolution[timer_num] = duty_resolution;
+    g_light_config->cycles_per_ms[timer_num]   = cycles_per_ms >> duty_resolution;
+    g_light_config->timer_mask |= BIT(timer_num);
+    portEXIT_CRITICAL(&g_fade_lock);
+}
+
+esp_err_t iot_led_init(ledc_timer_t timer_num, ledc_mode_t speed_mode, uint32_t freq_hz, ledc_clk_cfg_t clk_cfg, ledc_timer_bit_t duty_resolution)
+{
+    esp_err_t ret = ESP_OK;
+
+    ret = ledc_timer_setup(speed_mode, timer_num, freq_hz, clk_cfg, duty_resolution);
+    LIGHT_ERROR_CHECK(ret != ESP_OK, ret, "LEDC timer configuration");
 
     if (g_light_config == NULL) {
         g_light_config = calloc(1, sizeof(iot_light_t));
         g_light_config->timer_num  = timer_num;
         g_light_config->speed_mode = speed_mode;
 
+        for (int i = 0; i < LEDC_HSV_FADE_MAX; i++) {
+            memset(g_light_config->hsv_fade[i].channel, -1, sizeof(g_light_config->hsv_fade[i].channel));
+        }
+
+        for (int i = 0; i < LEDC_CHANNEL_MAX; i++) {
+            g_light_config->gamma_table[i] = g_gamma_table;
+            g_light_config->timer_sel[i]   = timer_num;
+        }
+
+        ledc_timer_params_update(timer_num, clk_cfg);
+
+#ifdef CONFIG_LIGHT_DRIVER_ISR_STATS
+        memset(&g_isr_stats, 0, sizeof(g_isr_stats));
+#endif
 
-        hw_timer_idx_t hw_timer = {
-            .timer_group = HW_TIMER_GROUP,
-            .timer_id    = HW_TIMER_ID,
-        };
-        g_light_config->timer_id = hw_timer;
-        iot_timer_create(&hw_timer, 1, DUTY_SET_CYCLE, fade_timercb);
+        g_light_config->timer_id.timer_group = HW_TIMER_GROUP;
+        g_light_config->timer_id.timer_id    = HW_TIMER_ID;
+        g_light_config->timer_period_ms      = DUTY_SET_CYCLE;
+        iot_timer_create(&g_light_config->timer_id, 1, DUTY_SET_CYCLE, fade_timercb);
     } else {
         ESP_LOGE(TAG, "g_light_config has been initialized");
     }
@@ -419,23 +1109,86 @@ esp_err_t iot_led_init(ledc_timer_t timer_num, ledc_mode_t speed_mode, uint32_t
 
 esp_err_t iot_led_deinit()
 {
-    if (g_gamma_table) {
-        free(g_gamma_table);
-    }
-
     if (g_light_config) {
+        iot_timer_stop(&g_light_config->timer_id);
+        timer_disable_intr(g_light_config->timer_id.timer_group, g_light_config->timer_id.timer_id);
+        esp_intr_free(g_light_config->timer_id.isr_handle);
+
+        for (int i = 0; i < LEDC_PROGRAM_MAX; i++) {
+            free(g_light_config->program[i].keyframes);
+        }
+
+        for (int i = 0; i < LEDC_CHANNEL_MAX; i++) {
+            free(g_light_config->calibration[i]);
+        }
+
         free(g_light_config);
+        g_light_config = NULL;
     }
 
-    timer_disable_intr(g_light_config->timer_id.timer_group, g_light_config->timer_id.timer_id);
+    g_gamma_table = s_gamma_table_default;
+    free(g_gamma_table_custom);
+    g_gamma_table_custom = NULL;
+
+    return ESP_OK;
+}
+
+esp_err_t iot_led_timer_config(ledc_timer_t timer_num, uint32_t freq_hz, ledc_clk_cfg_t clk_cfg, ledc_timer_bit_t duty_resolution)
+{
+    esp_err_t ret = ESP_OK;
+    LIGHT_ERROR_CHECK(g_light_config == NULL, ESP_ERR_INVALID_ARG, "iot_led_init() must be called first");
+
+    ret = ledc_timer_setup(g_light_config->speed_mode, timer_num, freq_hz, clk_cfg, duty_resolution);
+    LIGHT_ERROR_CHECK(ret != ESP_OK, ret, "LEDC timer configuration");
+
+    ledc_timer_params_update(timer_num, clk_cfg);
+
+    ledc_fade_data_t *fade_data = &g_light_config->fade_data;
+
+    /**< The duties of the idle channels of the timer are rewritten at the new resolution */
+    portENTER_CRITICAL(&g_fade_lock);
+
+    for (uint32_t mask = g_light_config->channel_mask & ~fade_data->active_mask; mask; mask &= mask - 1) {
+        int channel = __builtin_ctz(mask);
+
+        if (g_light_config->timer_sel[channel] != timer_num) {
+            continue;
+        }
+
+        fade_data->final[channel]  = fade_data->cur[channel];
+        fade_data->step[channel]   = 0;
+        fade_data->cycle[channel]  = 0;
+        fade_data->num[channel]    = 1;
+        fade_data->period[channel] = DUTY_SET_CYCLE;
+        fade_data->wait[channel]   = 0;
+        fade_data->easing[channel] = IOT_LED_EASE_LINEAR;
+        fade_data->active_mask    |= BIT(channel);
+    }
+
+    if (fade_data->active_mask) {
+        fade_timer_kick();
+    }
+
+    portEXIT_CRITICAL(&g_fade_lock);
 
     return ESP_OK;
 }
 
 esp_err_t iot_led_regist_channel(ledc_channel_t channel, gpio_num_t gpio_num)
+{
+    LIGHT_ERROR_CHECK(g_light_config == NULL, ESP_ERR_INVALID_ARG, "iot_led_init() must be called first");
+
+    return iot_led_regist_channel_ex(channel, gpio_num, g_light_config->timer_num);
+}
+
+esp_err_t iot_led_regist_channel_ex(ledc_channel_t channel, gpio_num_t gpio_num, ledc_timer_t timer_num)
 {
     esp_err_t ret = ESP_OK;
     LIGHT_ERROR_CHECK(g_light_config == NULL, ESP_ERR_INVALID_ARG, "iot_led_init() must be called first");
+    LIGHT_PARAM_CHECK(channel < LEDC_CHANNEL_MAX);
+    LIGHT_PARAM_CHECK(timer_num < LEDC_TIMER_MAX);
+    LIGHT_ERROR_CHECK(!(g_light_config->timer_mask & BIT(timer_num)), ESP_ERR_INVALID_ARG,
+                      "iot_led_timer_config() must be called first for LEDC timer %d", timer_num);
 #ifdef CONFIG_SPIRAM_SUPPORT
     LIGHT_ERROR_CHECK(gpio_num != GPIO_NUM_16 || gpio_num != GPIO_NUM_17, ESP_ERR_INVALID_ARG,
                     "gpio_num must not conflict to PSRAM(IO16 && IO17)");
@@ -445,84 +1198,545 @@ esp_err_t iot_led_regist_channel(ledc_channel_t channel, gpio_num_t gpio_num)
         .channel    = channel,
         .intr_type  = LEDC_INTR_DISABLE,
         .speed_mode = g_light_config->speed_mode,
-        .timer_sel  = g_light_config->timer_num,
+        .timer_sel  = timer_num,
     };
 
     ret = ledc_channel_config(&ledc_ch_config);
     LIGHT_ERROR_CHECK(ret != ESP_OK, ret, "LEDC channel configuration");
 
+    /**< ledc_channel_config() starts the channel off at hpoint 0 */
+    portENTER_CRITICAL(&g_fade_lock);
+    g_light_config->duty[channel]   = 0;
+    g_light_config->hpoint[channel] = 0;
+    g_light_config->timer_sel[channel] = timer_num;
+    g_light_config->channel_mask   |= BIT(channel);
+    portEXIT_CRITICAL(&g_fade_lock);
+
     return ESP_OK;
 }
 
+esp_err_t iot_led_unregist_channel(ledc_channel_t channel)
+{
+    LIGHT_ERROR_CHECK(g_light_config == NULL, ESP_ERR_INVALID_ARG, "iot_led_init() must be called first");
+    LIGHT_PARAM_CHECK(channel < LEDC_CHANNEL_MAX);
+
+    ledc_fade_data_t *fade_data = &g_light_config->fade_data;
+    uint16_t *calibration = NULL;
+
+    portENTER_CRITICAL(&g_fade_lock);
+    hsv_fade_cancel(BIT(channel));
+    program_cancel(BIT(channel));
+    fade_data->cur[channel]   = fade_data->final[channel] = fade_data->step[channel] = 0;
+    fade_data->cycle[channel] = fade_data->num[channel] = 0;
+    fade_data->active_mask   &= ~BIT(channel);
+    g_light_config->channel_mask &= ~BIT(channel);
+
+    /**< The calibration belongs to the LED, not to the channel */
+    calibration = g_light_config->calibration[channel];
+    g_light_config->calibration[channel] = NULL;
+    g_light_config->gamma_table[channel] = g_gamma_table;
+    portEXIT_CRITICAL(&g_fade_lock);
+
+    free(calibration);
+
+    return ledc_stop(g_light_config->speed_mode, channel, 0);
+}
+
 esp_err_t iot_led_get_channel(ledc_channel_t channel, uint8_t *dst)
 {
     LIGHT_ERROR_CHECK(g_light_config == NULL, ESP_ERR_INVALID_ARG, "iot_led_init() must be called first");
     LIGHT_ERROR_CHECK(dst == NULL, ESP_ERR_INVALID_ARG, "dst should not be NULL");
-    int cur = g_light_config->fade_data[channel].cur;
+    int cur = g_light_config->fade_data.cur[channel];
     *dst = FIXED_2_FLOATING(cur, LEDC_FIXED_Q);
     return ESP_OK;
 }
 
+esp_err_t iot_led_get_channel16(ledc_channel_t channel, uint16_t *dst)
+{
+    LIGHT_ERROR_CHECK(g_light_config == NULL, ESP_ERR_INVALID_ARG, "iot_led_init() must be called first");
+    LIGHT_ERROR_CHECK(dst == NULL, ESP_ERR_INVALID_ARG, "dst should not be NULL");
+    LIGHT_PARAM_CHECK(channel < LEDC_CHANNEL_MAX);
+    *dst = FIXED_2_VALUE16(g_light_config->fade_data.cur[channel]);
+    return ESP_OK;
+}
+
 esp_err_t iot_led_set_channel(ledc_channel_t channel, uint8_t value, uint32_t fade_ms)
+{
+    return iot_led_set_channel16(channel, value * 257, fade_ms);
+}
+
+esp_err_t iot_led_set_channel16(ledc_channel_t channel, uint16_t value, uint32_t fade_ms)
+{
+    uint16_t values[LEDC_CHANNEL_MAX] = {0};
+
+    LIGHT_PARAM_CHECK(channel < LEDC_CHANNEL_MAX);
+    values[channel] = value;
+
+    return iot_led_set_channels16(BIT(channel), values, fade_ms);
+}
+
+esp_err_t iot_led_set_channels(uint32_t channel_mask, const uint8_t values[], uint32_t fade_ms)
+{
+    uint16_t values16[LEDC_CHANNEL_MAX] = {0};
+
+    LIGHT_PARAM_CHECK(values);
+
+    /**< 257 maps 255 to 65535, which is exactly 255 in the Q16 fade state */
+    for (int channel = 0; channel < LEDC_CHANNEL_MAX; channel++) {
+        if (channel_mask & BIT(channel)) {
+            values16[channel] = values[channel] * 257;
+        }
+    }
+
+    return iot_led_set_channels16(channel_mask, values16, fade_ms);
+}
+
+esp_err_t iot_led_set_channels16(uint32_t channel_mask, const uint16_t values[], uint32_t fade_ms)
+{
+    return iot_led_set_channels16_ex(channel_mask, values, fade_ms, IOT_LED_EASE_LINEAR);
+}
+
+esp_err_t iot_led_set_channels16_ex(uint32_t channel_mask, const uint16_t values[], uint32_t fade_ms,
+                                    iot_led_easing_t easing)
 {
     LIGHT_ERROR_CHECK(g_light_config == NULL, ESP_ERR_INVALID_ARG, "iot_led_init() must be called first");
-    ledc_fade_data_t *fade_data = g_light_config->fade_data + channel;
+    LIGHT_PARAM_CHECK(values);
+    LIGHT_PARAM_CHECK(channel_mask != 0 && channel_mask < BIT(LEDC_CHANNEL_MAX));
+    LIGHT_PARAM_CHECK(easing < IOT_LED_EASE_MAX);
 
-    fade_data->final = FLOATINT_2_FIXED(value, LEDC_FIXED_Q);
+    ledc_fade_data_t *fade_data = &g_light_config->fade_data;
+    int final[LEDC_CHANNEL_MAX] = {0};
+    size_t num = (fade_ms < DUTY_SET_CYCLE) ? 1 : fade_ms / DUTY_SET_CYCLE;
+    size_t step_num = num;
+    uint32_t period = DUTY_SET_CYCLE;
 
-    if (fade_ms < DUTY_SET_CYCLE) {
-        fade_data->num = 1;
-    } else {
-        fade_data->num   = fade_ms / DUTY_SET_CYCLE;
+    for (int channel = 0; channel < LEDC_CHANNEL_MAX; channel++) {
+        if (channel_mask & BIT(channel)) {
+            final[channel] = VALUE16_2_FIXED(values[channel]);
+        }
     }
 
-    fade_data->step  = abs(fade_data->cur - fade_data->final) / fade_data->num;
+    /**
+     * @brief Each segment is one LEDC fade, linear between two points of the gamma curve.
+     *        One more step after the last segment sets the exact target.
+     */
+    if (g_light_config->fade_mode == IOT_LED_FADE_HARDWARE && fade_ms >= 2 * DUTY_SET_CYCLE) {
+        step_num = fade_ms / HW_FADE_SEGMENT_MIN_MS;
+        step_num = (step_num < 1) ? 1 : (step_num > HW_FADE_SEGMENT_MAX) ? HW_FADE_SEGMENT_MAX : step_num;
+        period   = fade_ms / step_num;
+        num      = step_num + 1;
+    }
 
-    if (fade_data->cur > fade_data->final) {
-        fade_data->step *= -1;
+    /**
+     * @brief All channels are published in one critical section, so fade_timercb
+     *        starts their fades on the same tick
+     */
+    portENTER_CRITICAL(&g_fade_lock);
+    hsv_fade_cancel(channel_mask);
+    program_cancel(channel_mask);
+
+    for (int channel = 0; channel < LEDC_CHANNEL_MAX; channel++) {
+        if (!(channel_mask & BIT(channel))) {
+            continue;
+        }
+
+        int step = abs(fade_data->cur[channel] - final[channel]) / (int)step_num;
+
+        fade_data->final[channel] = final[channel];
+        fade_data->step[channel]  = (fade_data->cur[channel] > final[channel]) ? -step : step;
+        fade_data->cycle[channel] = 0;
+        fade_data->num[channel]   = num;
+        fade_data->period[channel] = period;
+        fade_data->wait[channel]  = 0;
+        fade_data->start[channel] = fade_data->cur[channel];
+        fade_data->progress[channel] = 0;
+        fade_data->progress_step[channel] = 0x10000 / step_num;
+        fade_data->easing[channel] = easing;
     }
 
-    if (fade_data->cycle != 0) {
-        fade_data->cycle = 0;
+    fade_data->active_mask |= channel_mask;
+
+    fade_timer_kick();
+    portEXIT_CRITICAL(&g_fade_lock);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Find the hue-interpolated fade of the channels, or a free or idle slot for them
+ */
+static ledc_hsv_fade_t *hsv_fade_slot(const ledc_channel_t channels[3])
+{
+    ledc_hsv_fade_t *free_slot = NULL;
+
+    for (int i = 0; i < LEDC_HSV_FADE_MAX; i++) {
+        ledc_hsv_fade_t *hsv_fade = g_light_config->hsv_fade + i;
+
+        if (hsv_fade->channel[0] == channels[0] && hsv_fade->channel[1] == channels[1]
+                && hsv_fade->channel[2] == channels[2]) {
+            return hsv_fade;
+        }
+
+        if (!free_slot && (hsv_fade->channel[0] < 0 || hsv_fade->num == 0)) {
+            free_slot = hsv_fade;
+        }
     }
 
-    if (g_hw_timer_started != true) {
-        iot_timer_start(&g_light_config->timer_id);
+    if (free_slot) {
+        free_slot->valid = false;
+
+        for (int i = 0; i < 3; i++) {
+            free_slot->channel[i] = channels[i];
+        }
     }
 
+    return free_slot;
+}
+
+esp_err_t iot_led_set_hsv_channels(const ledc_channel_t channels[3], uint16_t hue,
+                                   uint16_t saturation, uint16_t value, uint32_t fade_ms)
+{
+    return iot_led_set_hsv_channels_ex(channels, hue, saturation, value, fade_ms, IOT_LED_EASE_LINEAR);
+}
+
+esp_err_t iot_led_set_hsv_channels_ex(const ledc_channel_t channels[3], uint16_t hue,
+                                      uint16_t saturation, uint16_t value, uint32_t fade_ms,
+                                      iot_led_easing_t easing)
+{
+    LIGHT_ERROR_CHECK(g_light_config == NULL, ESP_ERR_INVALID_ARG, "iot_led_init() must be called first");
+    LIGHT_PARAM_CHECK(channels);
+    LIGHT_PARAM_CHECK(easing < IOT_LED_EASE_MAX);
+    LIGHT_PARAM_CHECK(channels[0] < LEDC_CHANNEL_MAX && channels[1] < LEDC_CHANNEL_MAX && channels[2] < LEDC_CHANNEL_MAX);
+    LIGHT_PARAM_CHECK(channels[0] != channels[1] && channels[0] != channels[2] && channels[1] != channels[2]);
+
+    ledc_fade_data_t *fade_data = &g_light_config->fade_data;
+    const uint16_t final[3] = {hue, saturation, value};
+    uint32_t channel_mask = BIT(channels[0]) | BIT(channels[1]) | BIT(channels[2]);
+    uint32_t num = (fade_ms < DUTY_SET_CYCLE) ? 1 : fade_ms / DUTY_SET_CYCLE;
+    uint16_t start[3] = {0};
+
+    portENTER_CRITICAL(&g_fade_lock);
+
+    ledc_hsv_fade_t *hsv_fade = hsv_fade_slot(channels);
+
+    if (hsv_fade == NULL) {
+        portEXIT_CRITICAL(&g_fade_lock);
+        ESP_LOGW(TAG, "<ESP_ERR_NO_MEM> No free hsv fade slot");
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (hsv_fade->valid) {
+        start[0] = hsv_fade->hue >> 16;
+        start[1] = hsv_fade->saturation >> 16;
+        start[2] = hsv_fade->value >> 16;
+    } else {
+        uint16_t rgb[3] = {0};
+
+        for (int i = 0; i < 3; i++) {
+            rgb[i] = FIXED_2_VALUE16(fade_data->cur[channels[i]]);
+        }
+
+        light_color_rgb2hsv(rgb[0], rgb[1], rgb[2], &start[0], &start[1], &start[2]);
+
+        /**< Black and grey have no hue, do not sweep the hue circle when coming from them */
+        if (start[2] == 0) {
+            start[0] = hue;
+            start[1] = saturation;
+        } else if (start[1] == 0) {
+            start[0] = hue;
+        }
+    }
+
+    /**< Stop the other fades of these channels, the slot found above is started again below */
+    hsv_fade_cancel(channel_mask);
+    program_cancel(channel_mask);
+
+    hsv_fade->hue             = (uint32_t)start[0] << 16;
+    hsv_fade->saturation      = (uint32_t)start[1] << 16;
+    hsv_fade->value           = (uint32_t)start[2] << 16;
+    hsv_fade->hue_step        = (int32_t)(((int64_t)(int16_t)(hue - start[0]) << 16) / (int32_t)num);
+    hsv_fade->saturation_step = (int32_t)(((int64_t)(saturation - start[1]) << 16) / (int32_t)num);
+    hsv_fade->value_step      = (int32_t)(((int64_t)(value - start[2]) << 16) / (int32_t)num);
+    hsv_fade->num             = num;
+    hsv_fade->valid           = true;
+    hsv_fade->easing          = easing;
+    hsv_fade->progress        = 0;
+    hsv_fade->progress_step   = 0x10000 / num;
+    hsv_fade->delta[0]        = (int16_t)(hue - start[0]);
+    hsv_fade->delta[1]        = saturation - start[1];
+    hsv_fade->delta[2]        = value - start[2];
+
+    for (int i = 0; i < 3; i++) {
+        hsv_fade->start[i] = (uint32_t)start[i] << 16;
+    }
+
+    memcpy(hsv_fade->final, final, sizeof(final));
+
+    fade_timer_kick();
+    portEXIT_CRITICAL(&g_fade_lock);
+
     return ESP_OK;
 }
 
 esp_err_t iot_led_start_blink(ledc_channel_t channel, uint8_t value, uint32_t period_ms, bool fade_flag)
 {
     LIGHT_ERROR_CHECK(g_light_config == NULL, ESP_ERR_INVALID_ARG, "iot_led_init() must be called first");
-    ledc_fade_data_t *fade_data = g_light_config->fade_data + channel;
+    ledc_fade_data_t *fade_data = &g_light_config->fade_data;
+
+    portENTER_CRITICAL(&g_fade_lock);
+    hsv_fade_cancel(BIT(channel));
+    program_cancel(BIT(channel));
+    fade_data->final[channel] = fade_data->cur[channel] = FLOATINT_2_FIXED(value, LEDC_FIXED_Q);
+    fade_data->cycle[channel] = period_ms / 2 / DUTY_SET_CYCLE;
+    fade_data->num[channel]   = (fade_flag) ? period_ms / 2 / DUTY_SET_CYCLE : 0;
+    fade_data->step[channel]  = (fade_flag) ? fade_data->cur[channel] / (int)fade_data->num[channel] * -1 : 0;
+    fade_data->period[channel] = DUTY_SET_CYCLE;
+    fade_data->wait[channel]  = 0;
+    fade_data->easing[channel] = IOT_LED_EASE_LINEAR;
+    fade_data->active_mask   |= BIT(channel);
+    fade_timer_kick();
+    portEXIT_CRITICAL(&g_fade_lock);
+
+    return ESP_OK;
+
+}
+
+esp_err_t iot_led_stop_blink(ledc_channel_t channel)
+{
+    LIGHT_ERROR_CHECK(g_light_config == NULL, ESP_ERR_INVALID_ARG, "iot_led_init() must be called first");
+    ledc_fade_data_t *fade_data = &g_light_config->fade_data;
 
-    fade_data->final = fade_data->cur = FLOATINT_2_FIXED(value, LEDC_FIXED_Q);
-    fade_data->cycle = period_ms / 2 / DUTY_SET_CYCLE;
-    fade_data->num = (fade_flag) ? period_ms / 2 / DUTY_SET_CYCLE : 0;
-    fade_data->step  = (fade_flag) ? fade_data->cur / fade_data->num * -1 : 0;
+    portENTER_CRITICAL(&g_fade_lock);
+    hsv_fade_cancel(BIT(channel));
+    program_cancel(BIT(channel));
+    fade_data->cycle[channel] = fade_data->num[channel] = 0;
+    fade_data->active_mask   &= ~BIT(channel);
+    portEXIT_CRITICAL(&g_fade_lock);
 
-    if (g_hw_timer_started != true) {
-        iot_timer_start(&g_light_config->timer_id);
+    return ESP_OK;
+}
+
+esp_err_t iot_led_start_program(const ledc_channel_t channels[], uint8_t channel_num,
+                                const iot_led_program_t *program)
+{
+    LIGHT_ERROR_CHECK(g_light_config == NULL, ESP_ERR_INVALID_ARG, "iot_led_init() must be called first");
+    LIGHT_PARAM_CHECK(channels);
+    LIGHT_PARAM_CHECK(channel_num > 0 && channel_num <= IOT_LED_PROGRAM_CHANNEL_MAX);
+    LIGHT_PARAM_CHECK(program && program->keyframes);
+    LIGHT_PARAM_CHECK(program->keyframe_num > 0 && program->loop_from < program->keyframe_num);
+
+    ledc_fade_data_t *fade_data = &g_light_config->fade_data;
+    uint32_t channel_mask = 0;
+    iot_led_keyframe_t *keyframes = NULL;
+    ledc_program_t *slot = NULL;
+
+    for (int i = 0; i < channel_num; i++) {
+        LIGHT_PARAM_CHECK(channels[i] < LEDC_CHANNEL_MAX && !(channel_mask & BIT(channels[i])));
+        channel_mask |= BIT(channels[i]);
+    }
+
+    for (int i = 0; i < program->keyframe_num; i++) {
+        LIGHT_PARAM_CHECK(program->keyframes[i].easing < IOT_LED_EASE_MAX);
+    }
+
+    keyframes = heap_caps_malloc(program->keyframe_num * sizeof(iot_led_keyframe_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    LIGHT_ERROR_CHECK(keyframes == NULL, ESP_ERR_NO_MEM, "Copy %d keyframes", program->keyframe_num);
+    memcpy(keyframes, program->keyframes, program->keyframe_num * sizeof(iot_led_keyframe_t));
+
+    portENTER_CRITICAL(&g_fade_lock);
+    hsv_fade_cancel(channel_mask);
+    program_cancel(channel_mask);
+
+    /**< Programs never share a channel, so one of the LEDC_CHANNEL_MAX slots is free */
+    for (int i = 0; i < LEDC_PROGRAM_MAX && !slot; i++) {
+        if (!g_light_config->program[i].active) {
+            slot = g_light_config->program + i;
+        }
+    }
+
+    /**< The keyframes of the previous program of the slot are freed below */
+    iot_led_keyframe_t *old_keyframes = slot->keyframes;
+    slot->keyframes    = keyframes;
+    keyframes          = old_keyframes;
+    slot->channel_num  = channel_num;
+    slot->keyframe_num = program->keyframe_num;
+    slot->loop_from    = program->loop_from;
+    slot->loop_count   = program->loop_count;
+    slot->index        = 0;
+    slot->seed         = esp_random() | 1;
+
+    for (int i = 0; i < channel_num; i++) {
+        slot->channel[i] = channels[i];
+        slot->target[i]  = fade_data->cur[channels[i]];
     }
 
+    program_keyframe_start(slot);
+    slot->active = true;
+
+    fade_timer_kick();
+    portEXIT_CRITICAL(&g_fade_lock);
+
+    free(keyframes);
+
     return ESP_OK;
+}
 
+esp_err_t iot_led_stop_program(uint32_t channel_mask)
+{
+    LIGHT_ERROR_CHECK(g_light_config == NULL, ESP_ERR_INVALID_ARG, "iot_led_init() must be called first");
+
+    portENTER_CRITICAL(&g_fade_lock);
+    program_cancel(channel_mask);
+    portEXIT_CRITICAL(&g_fade_lock);
+
+    return ESP_OK;
 }
 
-esp_err_t iot_led_stop_blink(ledc_channel_t channel)
+esp_err_t iot_led_set_fade_mode(iot_led_fade_mode_t mode)
 {
     LIGHT_ERROR_CHECK(g_light_config == NULL, ESP_ERR_INVALID_ARG, "iot_led_init() must be called first");
-    ledc_fade_data_t *fade_data = g_light_config->fade_data + channel;
-    fade_data->cycle = fade_data->num = 0;
+    LIGHT_PARAM_CHECK(mode < IOT_LED_FADE_MODE_MAX);
+
+    g_light_config->fade_mode = mode;
 
     return ESP_OK;
 }
 
 esp_err_t iot_led_set_gamma_table(const uint16_t gamma_table[GAMMA_TABLE_SIZE])
 {
-    LIGHT_ERROR_CHECK(g_gamma_table == NULL, ESP_ERR_INVALID_ARG, "iot_led_init() must be called first");
-    memcpy(g_gamma_table, gamma_table, GAMMA_TABLE_SIZE * sizeof(uint16_t));
+    LIGHT_ERROR_CHECK(g_light_config == NULL, ESP_ERR_INVALID_ARG, "iot_led_init() must be called first");
+    LIGHT_PARAM_CHECK(gamma_table);
+
+    if (g_gamma_table_custom == NULL) {
+        g_gamma_table_custom = heap_caps_malloc(GAMMA_TABLE_SIZE * sizeof(uint16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        LIGHT_ERROR_CHECK(g_gamma_table_custom == NULL, ESP_ERR_NO_MEM, "Copy gamma table");
+    }
+
+    memcpy(g_gamma_table_custom, gamma_table, GAMMA_TABLE_SIZE * sizeof(uint16_t));
+
+    portENTER_CRITICAL(&g_fade_lock);
+    g_gamma_table = g_gamma_table_custom;
+
+    for (int i = 0; i < LEDC_CHANNEL_MAX; i++) {
+        if (!g_light_config->calibration[i]) {
+            g_light_config->gamma_table[i] = g_gamma_table;
+        }
+    }
+
+    portEXIT_CRITICAL(&g_fade_lock);
+
+    return ESP_OK;
+}
+
+esp_err_t iot_led_set_calibration(ledc_channel_t channel, const iot_led_calibration_t *calibration)
+{
+    LIGHT_ERROR_CHECK(g_light_config == NULL, ESP_ERR_INVALID_ARG, "iot_led_init() must be called first");
+    LIGHT_PARAM_CHECK(channel < LEDC_CHANNEL_MAX);
+    LIGHT_PARAM_CHECK(!calibration || calibration->gain > 0);
+
+    uint16_t *gamma_table = NULL;
+
+    if (calibration) {
+        gamma_table = heap_caps_malloc(GAMMA_TABLE_SIZE * sizeof(uint16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        LIGHT_ERROR_CHECK(gamma_table == NULL, ESP_ERR_NO_MEM, "Calibrated gamma table of channel %d", channel);
+        calibration_table_create(gamma_table, calibration);
+    }
+
+    /**< The previous table of the channel is freed below, once fade_timercb can no longer read it */
+    portENTER_CRITICAL(&g_fade_lock);
+    uint16_t *old_gamma_table = g_light_config->calibration[channel];
+    g_light_config->calibration[channel] = gamma_table;
+    g_light_config->gamma_table[channel] = gamma_table ? gamma_table : g_gamma_table;
+    portEXIT_CRITICAL(&g_fade_lock);
+
+    free(old_gamma_table);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Interpolate a gamma table at a 16-bit channel value
+ */
+static uint16_t gamma_table_lookup(const uint16_t *gamma_table, uint16_t value)
+{
+    uint32_t tmp_q = GET_FIXED_INTEGER_PART(VALUE16_2_FIXED(value), LEDC_FIXED_Q);
+    uint32_t tmp_r = GET_FIXED_DECIMAL_PART(VALUE16_2_FIXED(value), LEDC_FIXED_Q);
+
+    if (tmp_q >= GAMMA_TABLE_SIZE - 1) {
+        return gamma_table[GAMMA_TABLE_SIZE - 1];
+    }
+
+    int cur  = gamma_table[tmp_q];
+    int next = gamma_table[tmp_q + 1];
+
+    return cur + (int)(((int64_t)(next - cur) * tmp_r) >> LEDC_FIXED_Q);
+}
+
+uint16_t iot_led_value_to_linear(uint16_t value)
+{
+    return gamma_table_lookup(g_gamma_table, value);
+}
+
+uint16_t iot_led_value_to_duty(ledc_channel_t channel, uint16_t value)
+{
+    const uint16_t *gamma_table = g_gamma_table;
+
+    if (g_light_config && channel < LEDC_CHANNEL_MAX && g_light_config->gamma_table[channel]) {
+        gamma_table = g_light_config->gamma_table[channel];
+    }
+
+    return gamma_table_lookup(gamma_table, value);
+}
+
+uint16_t iot_led_linear_to_value(uint16_t linear)
+{
+    const uint16_t *gamma_table = g_gamma_table;
+    uint32_t low = 0, high = GAMMA_TABLE_SIZE - 1;
+
+    if (linear <= gamma_table[0]) {
+        return 0;
+    } else if (linear >= gamma_table[GAMMA_TABLE_SIZE - 1]) {
+        return UINT16_MAX;
+    }
+
+    /**< Last entry at or below linear */
+    while (high - low > 1) {
+        uint32_t mid = (low + high) / 2;
+
+        if (gamma_table[mid] <= linear) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    uint32_t span  = gamma_table[low + 1] - gamma_table[low];
+    uint32_t tmp_r = span ? ((uint32_t)(linear - gamma_table[low]) << LEDC_FIXED_Q) / span : 0;
+
+    return FIXED_2_VALUE16((low << LEDC_FIXED_Q) + tmp_r);
+}
+
+esp_err_t iot_led_get_isr_stats(iot_led_isr_stats_t *stats, bool reset)
+{
+#ifdef CONFIG_LIGHT_DRIVER_ISR_STATS
+    LIGHT_ERROR_CHECK(g_light_config == NULL, ESP_ERR_INVALID_ARG, "iot_led_init() must be called first");
+    LIGHT_PARAM_CHECK(stats);
+
+    uint32_t seq = 0;
+
+    do {
+        seq = __atomic_load_n(&g_isr_stats.seq, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        *stats = g_isr_stats.stats;
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    } while ((seq & 1) || seq != __atomic_load_n(&g_isr_stats.seq, __ATOMIC_RELAXED));
+
+    if (reset) {
+        __atomic_store_n(&g_isr_stats.reset, true, __ATOMIC_RELAXED);
+    }
+
     return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
 }
@@ -0,0 +1,105 @@
+/**
+ * @brief Easing curves of iot_led.c, GAMMA_CORRECTION 0.8
+ *
+ * Generated by easing_table.py, do not edit
+ */
+
+#ifndef __IOT_LED_EASING_H__
+#define __IOT_LED_EASING_H__
+
+#define IOT_LED_EASING_GAMMA_CORRECTION_X1000 (800)
+#define EASING_TABLE_SIZE (65) /**< Points of a curve, the progress between two is interpolated */
+#define EASING_TABLE_NUM (8)  /**< Curves from IOT_LED_EASE_IN_CUBIC */
+
+static const DRAM_ATTR uint16_t s_easing_table[EASING_TABLE_NUM][EASING_TABLE_SIZE] = {
+    [IOT_LED_EASE_IN_CUBIC - IOT_LED_EASE_IN_CUBIC] = {
+            0,     0,     2,     7,    16,    31,    54,    86,
+          128,   182,   250,   333,   432,   549,   686,   844,
+         1024,  1228,  1458,  1715,  2000,  2315,  2662,  3042,
+         3456,  3906,  4394,  4921,  5488,  6097,  6750,  7448,
+         8192,  8984,  9826, 10719, 11664, 12663, 13718, 14830,
+        16000, 17230, 18522, 19876, 21296, 22781, 24334, 25955,
+        27648, 29412, 31250, 33162, 35151, 37219, 39365, 41593,
+        43903, 46298, 48777, 51344, 53999, 56744, 59581, 62511,
+        65535,
+    },
+    [IOT_LED_EASE_OUT_CUBIC - IOT_LED_EASE_IN_CUBIC] = {
+            0,  3024,  5954,  8791, 11536, 14191, 16758, 19237,
+        21632, 23942, 26170, 28316, 30384, 32373, 34285, 36123,
+        37887, 39580, 41201, 42754, 44239, 45659, 47013, 48305,
+        49535, 50705, 51817, 52872, 53871, 54816, 55709, 56551,
+        57343, 58087, 58785, 59438, 60047, 60614, 61141, 61629,
+        62079, 62493, 62873, 63220, 63535, 63820, 64077, 64307,
+        64511, 64691, 64849, 64986, 65103, 65202, 65285, 65353,
+        65407, 65449, 65481, 65504, 65519, 65528, 65533, 65535,
+        65535,
+    },
+    [IOT_LED_EASE_IN_OUT_CUBIC - IOT_LED_EASE_IN_CUBIC] = {
+            0,     1,     8,    27,    64,   125,   216,   343,
+          512,   729,  1000,  1331,  1728,  2197,  2744,  3375,
+         4096,  4913,  5832,  6859,  8000,  9261, 10648, 12167,
+        13824, 15625, 17576, 19683, 21952, 24389, 27000, 29791,
+        32768, 35744, 38535, 41146, 43583, 45852, 47959, 49910,
+        51711, 53368, 54887, 56274, 57535, 58676, 59703, 60622,
+        61439, 62160, 62791, 63338, 63807, 64204, 64535, 64806,
+        65023, 65192, 65319, 65410, 65471, 65508, 65527, 65534,
+        65535,
+    },
+    [IOT_LED_EASE_OUT_SINE - IOT_LED_EASE_IN_CUBIC] = {
+            0,  1608,  3216,  4821,  6424,  8022,  9616, 11204,
+        12785, 14359, 15924, 17479, 19024, 20557, 22078, 23586,
+        25079, 26557, 28020, 29465, 30893, 32302, 33692, 35061,
+        36409, 37736, 39039, 40319, 41575, 42806, 44011, 45189,
+        46340, 47464, 48558, 49624, 50659, 51664, 52638, 53580,
+        54490, 55367, 56211, 57021, 57797, 58537, 59243, 59913,
+        60546, 61144, 61704, 62227, 62713, 63161, 63571, 63943,
+        64276, 64570, 64826, 65042, 65219, 65357, 65456, 65515,
+        65535,
+    },
+    [IOT_LED_EASE_IN_OUT_SINE - IOT_LED_EASE_IN_CUBIC] = {
+            0,    39,   158,   355,   630,   982,  1411,  1915,
+         2494,  3146,  3869,  4662,  5522,  6448,  7438,  8488,
+         9597, 10762, 11980, 13248, 14563, 15922, 17321, 18758,
+        20228, 21728, 23256, 24806, 26375, 27960, 29556, 31160,
+        32767, 34375, 35979, 37575, 39160, 40729, 42279, 43807,
+        45307, 46777, 48214, 49613, 50972, 52287, 53555, 54773,
+        55938, 57047, 58097, 59087, 60013, 60873, 61666, 62389,
+        63041, 63620, 64124, 64553, 64905, 65180, 65377, 65496,
+        65535,
+    },
+    [IOT_LED_EASE_OUT_EXPO - IOT_LED_EASE_IN_CUBIC] = {
+            0,  6733, 12776, 18198, 23063, 27429, 31347, 34863,
+        38018, 40849, 43390, 45669, 47715, 49551, 51198, 52676,
+        54003, 55193, 56261, 57220, 58080, 58852, 59544, 60166,
+        60723, 61224, 61673, 62076, 62438, 62762, 63053, 63315,
+        63549, 63760, 63948, 64118, 64270, 64406, 64529, 64639,
+        64737, 64826, 64905, 64976, 65040, 65098, 65149, 65195,
+        65237, 65274, 65307, 65337, 65364, 65388, 65410, 65429,
+        65447, 65462, 65476, 65489, 65500, 65510, 65520, 65528,
+        65535,
+    },
+    [IOT_LED_EASE_IN_OUT_EXPO - IOT_LED_EASE_IN_CUBIC] = {
+            0,     8,    17,    29,    44,    63,    85,   114,
+          149,   193,   247,   315,   399,   503,   633,   793,
+          993,  1241,  1549,  1931,  2406,  2995,  3728,  4637,
+         5766,  7169,  8910, 11073, 13758, 17094, 21236, 26380,
+        32768, 39155, 44299, 48441, 51777, 54462, 56625, 58366,
+        59769, 60898, 61807, 62540, 63129, 63604, 63986, 64294,
+        64542, 64742, 64902, 65032, 65136, 65220, 65288, 65342,
+        65386, 65421, 65450, 65472, 65491, 65506, 65518, 65527,
+        65535,
+    },
+    [IOT_LED_EASE_PERCEPTUAL - IOT_LED_EASE_IN_CUBIC] = {
+            0,   404,   704,   974,  1226,  1466,  1707,  1971,
+         2256,  2565,  2896,  3252,  3631,  4036,  4465,  4920,
+         5401,  5908,  6442,  7003,  7592,  8208,  8853,  9526,
+        10229, 10960, 11722, 12513, 13335, 14187, 15070, 15985,
+        16931, 17909, 18919, 19962, 21037, 22146, 23287, 24463,
+        25672, 26916, 28194, 29506, 30854, 32237, 33655, 35109,
+        36599, 38126, 39689, 41288, 42925, 44599, 46310, 48059,
+        49846, 51671, 53535, 55437, 57378, 59358, 61377, 63436,
+        65535,
+    },
+};
+
+#endif /**< __IOT_LED_EASING_H__ */
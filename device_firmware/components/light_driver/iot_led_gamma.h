@@ -0,0 +1,47 @@
+/**
+ * @brief Default gamma table of iot_led.c, GAMMA_CORRECTION 0.8
+ *
+ * Generated by gamma_table.py, do not edit
+ */
+
+#ifndef __IOT_LED_GAMMA_H__
+#define __IOT_LED_GAMMA_H__
+
+#define IOT_LED_GAMMA_CORRECTION_X1000 (800)
+
+static const DRAM_ATTR uint16_t s_gamma_table_default[GAMMA_TABLE_SIZE] = {
+        0,    64,   152,   253,   363,   480,   603,   732,
+      865,  1002,  1143,  1288,  1436,  1587,  1741,  1898,
+     2058,  2220,  2384,  2551,  2720,  2891,  3064,  3239,
+     3416,  3595,  3775,  3958,  4142,  4328,  4515,  4704,
+     4894,  5086,  5280,  5475,  5671,  5868,  6067,  6268,
+     6469,  6672,  6876,  7081,  7288,  7495,  7704,  7914,
+     8125,  8337,  8551,  8765,  8980,  9197,  9414,  9632,
+     9852, 10072, 10294, 10516, 10739, 10963, 11189, 11415,
+    11642, 11869, 12098, 12328, 12558, 12789, 13021, 13254,
+    13488, 13723, 13958, 14194, 14431, 14669, 14908, 15147,
+    15387, 15628, 15869, 16112, 16355, 16598, 16843, 17088,
+    17334, 17580, 17828, 18076, 18324, 18574, 18824, 19074,
+    19326, 19578, 19830, 20083, 20337, 20592, 20847, 21103,
+    21359, 21616, 21874, 22132, 22391, 22651, 22911, 23171,
+    23432, 23694, 23957, 24220, 24483, 24747, 25012, 25277,
+    25543, 25809, 26076, 26344, 26612, 26880, 27149, 27419,
+    27689, 27960, 28231, 28503, 28775, 29048, 29321, 29595,
+    29869, 30144, 30419, 30695, 30971, 31248, 31525, 31803,
+    32081, 32360, 32639, 32919, 33199, 33480, 33761, 34042,
+    34324, 34607, 34890, 35173, 35457, 35742, 36026, 36312,
+    36597, 36883, 37170, 37457, 37745, 38032, 38321, 38610,
+    38899, 39188, 39478, 39769, 40060, 40351, 40643, 40935,
+    41228, 41521, 41814, 42108, 42402, 42697, 42992, 43288,
+    43583, 43880, 44176, 44474, 44771, 45069, 45367, 45666,
+    45965, 46264, 46564, 46864, 47165, 47466, 47767, 48069,
+    48371, 48674, 48977, 49280, 49584, 49888, 50192, 50497,
+    50802, 51107, 51413, 51719, 52026, 52333, 52640, 52948,
+    53256, 53564, 53873, 54182, 54492, 54801, 55111, 55422,
+    55733, 56044, 56356, 56667, 56980, 57292, 57605, 57918,
+    58232, 58546, 58860, 59175, 59490, 59805, 60120, 60436,
+    60753, 61069, 61386, 61703, 62021, 62339, 62657, 62976,
+    63294, 63614, 63933, 64253, 64573, 64894, 65214, 65535,
+};
+
+#endif /**< __IOT_LED_GAMMA_H__ */
@@ -0,0 +1,306 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+
+#include "light_color.h"
+#include "light_color_cct.h"
+
+#define LIGHT_COLOR_HUE_120      (0x10000 / 3)          /**< 120 degrees */
+#define LIGHT_COLOR_HUE_240      (0x20000 / 3 + 1)      /**< 240 degrees, rounded */
+#define LIGHT_COLOR_KNEE         (9830)                 /**< 15 %, below it the cw output is linear */
+#define LIGHT_COLOR_KNEE_OFFSET  (9175)                 /**< 14 %, offset of the cw output above the knee */
+#define LIGHT_COLOR_KNEE_GAIN    (86)                   /**< 86 %, gain of the cw output above the knee */
+#define LIGHT_COLOR_KNEE_OUT_MIN (LIGHT_COLOR_KNEE_OFFSET + LIGHT_COLOR_KNEE * LIGHT_COLOR_KNEE_GAIN / 100)
+#define LIGHT_CCT_MIRED_Q8(K)    ((1000000U * 256 + (K) / 2) / (K)) /**< Mired in Q8, as cct_table.py */
+#define LIGHT_CCT_MIRED_MIN      LIGHT_CCT_MIRED_Q8(LIGHT_CCT_KELVIN_MAX)
+#define LIGHT_CCT_MIRED_MAX      LIGHT_CCT_MIRED_Q8(LIGHT_CCT_KELVIN_MIN)
+
+/**
+ * @brief a * b / 65535, rounded, without a division
+ */
+static inline uint32_t light_color_mul(uint32_t a, uint32_t b)
+{
+    uint32_t tmp = a * b + 0x8000;
+    return (tmp + (tmp >> 16)) >> 16;
+}
+
+/**
+ * @brief a * f / 65536, rounded, f is a Q16 fraction (0 .. 65536)
+ */
+static inline uint32_t light_color_mul_frac(uint32_t a, uint32_t f)
+{
+    return (a * f + 0x8000) >> 16;
+}
+
+/**
+ * @brief num / den rounded to the nearest integer, den must be positive
+ */
+static inline int32_t light_color_div_round(int32_t num, uint32_t den)
+{
+    uint32_t abs_num = (num >= 0) ? (uint32_t)num : (uint32_t)(-num);
+    int32_t quotient = (abs_num + den / 2) / den;
+
+    return (num >= 0) ? quotient : -quotient;
+}
+
+void light_color_hsv2rgb(uint16_t hue, uint16_t saturation, uint16_t value,
+                         uint16_t *red, uint16_t *green, uint16_t *blue)
+{
+    uint32_t h6     = (uint32_t)hue * 6;
+    uint32_t sector = h6 >> 16;
+    uint32_t f      = h6 & 0xFFFF;
+    uint16_t v = value;
+    uint16_t p = light_color_mul(value, LIGHT_COLOR_MAX - saturation);
+    uint16_t q = light_color_mul(value, LIGHT_COLOR_MAX - light_color_mul_frac(saturation, f));
+    uint16_t t = light_color_mul(value, LIGHT_COLOR_MAX - light_color_mul_frac(saturation, 0x10000 - f));
+
+    switch (sector) {
+        case 0:
+            *red = v, *green = t, *blue = p;
+            break;
+
+        case 1:
+            *red = q, *green = v, *blue = p;
+            break;
+
+        case 2:
+            *red = p, *green = v, *blue = t;
+            break;
+
+        case 3:
+            *red = p, *green = q, *blue = v;
+            break;
+
+        case 4:
+            *red = t, *green = p, *blue = v;
+            break;
+
+        default:
+            *red = v, *green = p, *blue = q;
+            break;
+    }
+}
+
+void light_color_rgb2hsv(uint16_t red, uint16_t green, uint16_t blue,
+                         uint16_t *hue, uint16_t *saturation, uint16_t *value)
+{
+    uint16_t max = red > green ? (red > blue ? red : blue) : (green > blue ? green : blue);
+    uint16_t min = red < green ? (red < blue ? red : blue) : (green < blue ? green : blue);
+    int32_t delta = max - min;
+    int32_t h = 0;
+
+    *value = max;
+
+    if (delta == 0) {
+        *hue        = 0;
+        *saturation = 0;
+        return;
+    }
+
+    *saturation = ((uint32_t)delta * LIGHT_COLOR_MAX + max / 2) / max;
+
+    /**
+     * @brief (x / delta) * 60 degrees == x * 32768 / (3 * delta) in 16-bit hue
+     */
+    if (red == max) {
+        h = light_color_div_round(((int32_t)green - blue) * 32768, 3 * delta);
+    } else if (green == max) {
+        h = LIGHT_COLOR_HUE_120 + light_color_div_round(((int32_t)blue - red) * 32768, 3 * delta);
+    } else {
+        h = LIGHT_COLOR_HUE_240 + light_color_div_round(((int32_t)red - green) * 32768, 3 * delta);
+    }
+
+    *hue = (uint16_t)h;
+}
+
+static inline uint16_t light_color_knee(uint32_t x)
+{
+    return (x < LIGHT_COLOR_KNEE) ? x : LIGHT_COLOR_KNEE_OFFSET + x * LIGHT_COLOR_KNEE_GAIN / 100;
+}
+
+static inline uint32_t light_color_knee_inverse(uint16_t y)
+{
+    if (y < LIGHT_COLOR_KNEE) {
+        return y;
+    } else if (y < LIGHT_COLOR_KNEE_OUT_MIN) {
+        return LIGHT_COLOR_KNEE;
+    }
+
+    return ((uint32_t)(y - LIGHT_COLOR_KNEE_OFFSET) * 100 + LIGHT_COLOR_KNEE_GAIN / 2) / LIGHT_COLOR_KNEE_GAIN;
+}
+
+void light_color_ctb2cw(uint16_t color_temperature, uint16_t brightness,
+                        uint16_t *warm, uint16_t *cold)
+{
+    *warm = light_color_knee(light_color_mul(color_temperature, brightness));
+    *cold = light_color_knee(light_color_mul(LIGHT_COLOR_MAX - color_temperature, brightness));
+}
+
+void light_color_cw2ctb(uint16_t warm, uint16_t cold,
+                        uint16_t *color_temperature, uint16_t *brightness)
+{
+    uint32_t warm_tmp = light_color_knee_inverse(warm);
+    uint32_t cold_tmp = light_color_knee_inverse(cold);
+    uint32_t sum      = warm_tmp + cold_tmp;
+
+    *brightness        = sum > LIGHT_COLOR_MAX ? LIGHT_COLOR_MAX : sum;
+    *color_temperature = sum ? (warm_tmp * LIGHT_COLOR_MAX + sum / 2) / sum : 0;
+}
+
+/**
+ * @brief Most of a white, in Q16 of its full output up to 1.0, that the colour holds
+ */
+static uint32_t light_color_white_amount(const uint32_t rgb[3], const uint16_t point[3])
+{
+    uint32_t amount = 1 << 16;
+
+    if (!point[0] && !point[1] && !point[2]) {
+        return 0;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        if (point[i] && (rgb[i] << 16) / point[i] < amount) {
+            amount = (rgb[i] << 16) / point[i];
+        }
+    }
+
+    return amount;
+}
+
+static void light_color_white_remove(uint32_t rgb[3], const uint16_t point[3], uint32_t amount)
+{
+    for (int i = 0; i < 3; i++) {
+        uint32_t white = (point[i] * amount + 0x8000) >> 16;
+        rgb[i] = (rgb[i] > white) ? rgb[i] - white : 0;
+    }
+}
+
+/**
+ * @brief Take first, then second out of the colour, return what is left of it
+ */
+static uint32_t light_color_white_split(uint32_t rgb[3], const uint16_t first_point[3], const uint16_t second_point[3],
+                                        uint32_t *first, uint32_t *second)
+{
+    *first = light_color_white_amount(rgb, first_point);
+    light_color_white_remove(rgb, first_point, *first);
+    *second = light_color_white_amount(rgb, second_point);
+    light_color_white_remove(rgb, second_point, *second);
+
+    return rgb[0] + rgb[1] + rgb[2];
+}
+
+void light_color_rgb2rgbw(uint16_t rgb[3], const uint16_t warm_point[3], const uint16_t cold_point[3],
+                          uint16_t *warm, uint16_t *cold)
+{
+    uint32_t warm_first[3] = {rgb[0], rgb[1], rgb[2]};
+    uint32_t cold_first[3] = {rgb[0], rgb[1], rgb[2]};
+    uint32_t warm_a = 0, cold_a = 0, warm_b = 0, cold_b = 0;
+
+    uint32_t left_a = light_color_white_split(warm_first, warm_point, cold_point, &warm_a, &cold_a);
+    uint32_t left_b = light_color_white_split(cold_first, cold_point, warm_point, &cold_b, &warm_b);
+    const uint32_t *left = (left_a <= left_b) ? warm_first : cold_first;
+    uint32_t warm_amount = (left_a <= left_b) ? warm_a : warm_b;
+    uint32_t cold_amount = (left_a <= left_b) ? cold_a : cold_b;
+
+    *warm = (warm_amount > LIGHT_COLOR_MAX) ? LIGHT_COLOR_MAX : warm_amount;
+    *cold = (cold_amount > LIGHT_COLOR_MAX) ? LIGHT_COLOR_MAX : cold_amount;
+
+    for (int i = 0; i < 3; i++) {
+        rgb[i] = left[i];
+    }
+}
+
+/**
+ * @brief Position of a temperature between the cold and the warm LED, 0 .. 65535 even in mired
+ */
+uint16_t light_color_kelvin_to_q16(uint16_t kelvin)
+{
+    kelvin = (kelvin < LIGHT_CCT_KELVIN_MIN) ? LIGHT_CCT_KELVIN_MIN : kelvin;
+    kelvin = (kelvin > LIGHT_CCT_KELVIN_MAX) ? LIGHT_CCT_KELVIN_MAX : kelvin;
+
+    uint32_t offset = LIGHT_CCT_MIRED_Q8(kelvin) - LIGHT_CCT_MIRED_MIN;
+    uint32_t span   = LIGHT_CCT_MIRED_MAX - LIGHT_CCT_MIRED_MIN;
+
+    return ((uint64_t)offset * LIGHT_COLOR_MAX + span / 2) / span;
+}
+
+uint16_t light_color_q16_to_kelvin(uint16_t color_temperature)
+{
+    uint32_t span  = LIGHT_CCT_MIRED_MAX - LIGHT_CCT_MIRED_MIN;
+    uint32_t mired = LIGHT_CCT_MIRED_MIN + ((uint64_t)color_temperature * span + LIGHT_COLOR_MAX / 2) / LIGHT_COLOR_MAX;
+
+    return (1000000U * 256 + mired / 2) / mired;
+}
+
+void light_color_kelvin2cw(uint16_t kelvin, uint16_t *warm, uint16_t *cold)
+{
+    /**< Table position in Q8 */
+    uint32_t position = ((uint32_t)light_color_kelvin_to_q16(kelvin) * (LIGHT_CCT_TABLE_SIZE - 1) + 0x80) >> 8;
+    uint32_t index    = position >> 8;
+    uint32_t fraction = position & 0xFF;
+
+    if (index >= LIGHT_CCT_TABLE_SIZE - 1) {
+        *warm = s_cct_table[LIGHT_CCT_TABLE_SIZE - 1][0];
+        *cold = s_cct_table[LIGHT_CCT_TABLE_SIZE - 1][1];
+        return;
+    }
+
+    *warm = s_cct_table[index][0] + (((s_cct_table[index + 1][0] - s_cct_table[index][0]) * (int)fraction + 0x80) >> 8);
+    *cold = s_cct_table[index][1] + (((s_cct_table[index + 1][1] - s_cct_table[index][1]) * (int)fraction + 0x80) >> 8);
+}
+
+void light_color_cw2kelvin(uint16_t warm, uint16_t cold, uint16_t *kelvin, uint16_t *brightness)
+{
+    int64_t last = 0, cur = 0;
+    uint32_t index = 0, fraction = 0;
+
+    /**< First entry with at least the warm share of the input, the share rises along the table */
+    for (index = 0; index < LIGHT_CCT_TABLE_SIZE; index++) {
+        cur = (int64_t)s_cct_table[index][0] * cold - (int64_t)s_cct_table[index][1] * warm;
+
+        if (cur >= 0) {
+            break;
+        }
+
+        last = cur;
+    }
+
+    if (index >= LIGHT_CCT_TABLE_SIZE) {
+        index = LIGHT_CCT_TABLE_SIZE - 1;
+    } else if (index > 0) {
+        index--;
+        fraction = (-last * 256 + (cur - last) / 2) / (cur - last);
+    }
+
+    uint32_t position = (index << 8) + fraction;
+    uint32_t warm_full = s_cct_table[index][0], cold_full = s_cct_table[index][1];
+
+    if (fraction) {
+        warm_full += ((s_cct_table[index + 1][0] - s_cct_table[index][0]) * (int)fraction + 0x80) >> 8;
+        cold_full += ((s_cct_table[index + 1][1] - s_cct_table[index][1]) * (int)fraction + 0x80) >> 8;
+    }
+
+    uint32_t sum = ((uint32_t)warm + cold) * LIGHT_COLOR_MAX / (warm_full + cold_full);
+
+    *kelvin     = light_color_q16_to_kelvin((position * LIGHT_COLOR_MAX + (LIGHT_CCT_TABLE_SIZE - 1) * 128)
+                                            / ((LIGHT_CCT_TABLE_SIZE - 1) * 256));
+    *brightness = (sum > LIGHT_COLOR_MAX) ? LIGHT_COLOR_MAX : sum;
+}
+
+void light_color_kelvin_range(uint16_t *kelvin_min, uint16_t *kelvin_max)
+{
+    *kelvin_min = LIGHT_CCT_KELVIN_MIN;
+    *kelvin_max = LIGHT_CCT_KELVIN_MAX;
+}
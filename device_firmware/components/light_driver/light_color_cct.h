@@ -0,0 +1,26 @@
+/**
+ * @brief Warm and cold output of light_color.c, 2700 K .. 6500 K LEDs, relative flux 1.0 / 1.0
+ *
+ * Generated by cct_table.py, do not edit
+ */
+
+#ifndef __LIGHT_COLOR_CCT_H__
+#define __LIGHT_COLOR_CCT_H__
+
+#define LIGHT_CCT_KELVIN_MIN (2700) /**< The warm LED */
+#define LIGHT_CCT_KELVIN_MAX (6500) /**< The cold LED */
+#define LIGHT_CCT_TABLE_SIZE (33)   /**< Even steps of mired from LIGHT_CCT_KELVIN_MAX, interpolated */
+
+static const uint16_t s_cct_table[LIGHT_CCT_TABLE_SIZE][2] = {
+    {    0, 65535}, { 2330, 63205}, { 4655, 60880}, { 6971, 58564},
+    { 9279, 56256}, {11575, 53960}, {13860, 51675}, {16130, 49405},
+    {18386, 47149}, {20625, 44910}, {22847, 42688}, {25050, 40485},
+    {27233, 38302}, {29395, 36140}, {31534, 34001}, {33675, 31860},
+    {35753, 29782}, {37799, 27736}, {39816, 25719}, {41805, 23730},
+    {43766, 21769}, {45701, 19834}, {47612, 17923}, {49499, 16036},
+    {51363, 14172}, {53205, 12330}, {55025, 10510}, {56825,  8710},
+    {58605,  6930}, {60365,  5170}, {62107,  3428}, {63830,  1705},
+    {65535,     0},
+};
+
+#endif /**< __LIGHT_COLOR_CCT_H__ */
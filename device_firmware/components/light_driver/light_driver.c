@@ -13,14 +13,19 @@
 // limitations under the License.
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/timers.h"
+#include "freertos/semphr.h"
 
 #include "light_driver.h"
+#include "light_color.h"
+#include "light_follow.h"
 #include "app_storage.h"
 
 /**
@@ -36,6 +41,7 @@ typedef struct {
     uint8_t brightness;
     uint32_t fade_period_ms;
     uint32_t blink_period_ms;
+    uint16_t kelvin;            /**< Colour temperature of MODE_CTB in Kelvin, 0 if set in percent. Last, so older stored status still loads */
 } light_status_t;
 
 /**
@@ -47,680 +53,2671 @@ enum light_channel {
     CHANNEL_ID_BLUE,
     CHANNEL_ID_WARM,
     CHANNEL_ID_COLD,
+    CHANNEL_ID_MAX,
 };
 
+#define CHANNEL_MASK_RGB (BIT(CHANNEL_ID_RED) | BIT(CHANNEL_ID_GREEN) | BIT(CHANNEL_ID_BLUE))
+#define CHANNEL_MASK_CW  (BIT(CHANNEL_ID_WARM) | BIT(CHANNEL_ID_COLD))
+#define CHANNEL_MASK_ALL (CHANNEL_MASK_RGB | CHANNEL_MASK_CW)
+#define CHANNEL_NONE     (-1)  /**< The colour is not connected */
+
+/**
+ * @brief Fields of the light command mailbox
+ */
+enum light_cmd_field {
+    LIGHT_CMD_HUE               = BIT(0),
+    LIGHT_CMD_SATURATION        = BIT(1),
+    LIGHT_CMD_VALUE             = BIT(2),
+    LIGHT_CMD_COLOR_TEMPERATURE = BIT(3),
+    LIGHT_CMD_BRIGHTNESS        = BIT(4),
+    LIGHT_CMD_SWITCH            = BIT(5),
+    LIGHT_CMD_MODE              = BIT(6),
+    LIGHT_CMD_TRANSITION        = BIT(7),
+    LIGHT_CMD_KELVIN            = BIT(8),
+    LIGHT_CMD_SETTLE            = BIT(9),   /**< A followed stream has ended, see light_handle_follow() */
+};
+
+#define LIGHT_CMD_HSV (LIGHT_CMD_HUE | LIGHT_CMD_SATURATION | LIGHT_CMD_VALUE)
+#define LIGHT_CMD_CTB (LIGHT_CMD_COLOR_TEMPERATURE | LIGHT_CMD_BRIGHTNESS)
+
+/**
+ * @brief Latest-wins command mailbox of the light task
+ *
+ * A writer fills a command of its own and merges it, values and field bits
+ * together, into the mailbox under cmd_lock. The light task takes a copy of
+ * the mailbox and clears its bits under the same lock, so a burst of commands
+ * is merged into a single update and every command is seen whole or not at
+ * all, never mixed with the fields of a concurrent one.
+ */
+typedef struct {
+    uint32_t fields;
+    uint32_t hue;
+    uint32_t saturation;
+    uint32_t value;
+    uint32_t color_temperature;
+    uint32_t brightness;
+    uint32_t on;
+    uint32_t mode;
+    uint32_t transition_ms;
+    uint32_t kelvin;
+} light_cmd_t;
+
 #define LIGHT_STATUS_STORE_KEY   "light_status"
+#define LIGHT_STORE_KEY_LEN_MAX  (15)               /**< Maximum length of an NVS key */
+#define LIGHT_STORE_RETRY_MIN_MS (1000)             /**< First retry of a failed write, doubled after each failure */
+#define LIGHT_STORE_RETRY_MAX_MS (60 * 1000)
+#define LIGHT_SHUTDOWN_WAIT_MS   (500)              /**< Longest wait for the locks before a restart */
+#define LIGHT_HANDLE_MAX         (LEDC_CHANNEL_MAX) /**< Every light uses at least one LEDC channel */
 #define LIGHT_FADE_PERIOD_MAX_MS (3 * 1000)
+#define LIGHT_LEDC_TIMER         (LEDC_TIMER_0)     /**< LEDC timer of the colour channels */
+#define LIGHT_LEDC_TIMER_WHITE   (LEDC_TIMER_1)     /**< LEDC timer of the white channels, if freq_hz_white is set */
 
-static const char *TAG               = "light_driver";
-static light_status_t g_light_status = {0};
-static bool g_light_blink_flag       = false;
-static TimerHandle_t g_fade_timer    = NULL;
-static int g_fade_mode               = MODE_NONE;
-static uint16_t g_fade_hue           = 0;
-
-esp_err_t light_driver_init(light_driver_config_t *config)
-{
-    LIGHT_PARAM_CHECK(config);
+#define LIGHT_TEMPERATURE_NONE   (INT16_MIN)        /**< No temperature reported, the budget is not derated */
+#define LIGHT_OBSERVER_MAX       (4)                /**< Observers of each light, see light_handle_add_observer() */
+#define LIGHT_WHITE_POINT_WARM   (0)                /**< Index of the warm LED in white_point */
+#define LIGHT_WHITE_POINT_COLD   (1)                /**< Index of the cold LED in white_point */
 
-    memset(&g_light_status, 0, sizeof(light_status_t));
+/**
+ * @brief Linear RGB of typical 2700 K and 6500 K LEDs, replaced by the factory keys warm_rgb and cold_rgb
+ */
+static const uint16_t g_white_point_default[2][3] = {
+    [LIGHT_WHITE_POINT_WARM] = {65535, 27714, 6517},
+    [LIGHT_WHITE_POINT_COLD] = {65535, 61875, 65000},
+};
 
-    if (app_storage_get(LIGHT_STATUS_STORE_KEY, &g_light_status, sizeof(light_status_t)) != ESP_OK) {
-        ESP_LOGE(TAG, "Load light status failed");
-        memset(&g_light_status, 0, sizeof(light_status_t));
-        g_light_status.mode              = MODE_HSV;
-        g_light_status.on                = 1;
-        g_light_status.hue               = 360;
-        g_light_status.saturation        = 0;
-        g_light_status.value             = 100;
-        g_light_status.color_temperature = 0;
-        g_light_status.brightness        = 30;
-        g_light_status.fade_period_ms  = config->fade_period_ms;
-        g_light_status.blink_period_ms = config->blink_period_ms;
-    }
+#if CONFIG_LIGHT_DRIVER_EASING_OUT_CUBIC
+#define LIGHT_EASING_DEFAULT IOT_LED_EASE_OUT_CUBIC
+#elif CONFIG_LIGHT_DRIVER_EASING_PERCEPTUAL
+#define LIGHT_EASING_DEFAULT IOT_LED_EASE_PERCEPTUAL
+#else
+#define LIGHT_EASING_DEFAULT IOT_LED_EASE_LINEAR
+#endif
 
-    iot_led_init(LEDC_TIMER_0, LEDC_LOW_SPEED_MODE, config->freq_hz, config->clk_cfg, config->duty_resolution);
+/**
+ * @brief Observer of the state changes of a light
+ */
+typedef struct {
+    light_driver_observer_t cb;
+    void *arg;
+} light_observer_t;
 
-    iot_led_regist_channel(CHANNEL_ID_RED, config->gpio_red);
-    iot_led_regist_channel(CHANNEL_ID_GREEN, config->gpio_green);
-    iot_led_regist_channel(CHANNEL_ID_BLUE, config->gpio_blue);
-    iot_led_regist_channel(CHANNEL_ID_WARM, config->gpio_warm);
-    iot_led_regist_channel(CHANNEL_ID_COLD, config->gpio_cold);
+/**
+ * @brief One light fixture, created by light_handle_create()
+ */
+struct light_driver {
+    int8_t channel[CHANNEL_ID_MAX];             /**< LEDC channel of each colour, CHANNEL_NONE if not connected */
+    char store_key[LIGHT_STORE_KEY_LEN_MAX + 1];
+    light_status_t status;
+    light_cmd_t cmd;
+    portMUX_TYPE cmd_lock;                      /**< Protects cmd between the writers and the light task */
+    bool blink_flag;
+    int fade_mode;
+    iot_led_easing_t easing;                    /**< Curve of the transitions of the light_driver_set_* commands */
+    esp_timer_handle_t store_timer;
+    bool store_dirty;
+    uint32_t store_retry_ms;                    /**< Backoff of the next retry of a failed write, 0 after a success */
+    light_status_t status_stored;
+    light_driver_store_stats_t store_stats;
+    bool calibration_loaded;
+    bool white_mix;                             /**< In HSV mode the white part of the colour is lit by warm and cold */
+    uint16_t white_point[2][3];                 /**< Linear RGB of warm and cold at full output, see light_color_rgb2rgbw() */
+    light_driver_power_config_t power;          /**< Power model and budget, budget_mw 0 without a limit */
+    uint32_t power_mw[CHANNEL_ID_MAX];          /**< Power of each colour at full duty, from power */
+    int16_t temperature_c;                      /**< Of light_handle_set_temperature(), LIGHT_TEMPERATURE_NONE before */
+    light_follow_t follow;                      /**< Dead reckoning of a stream of commands, see light_handle_set_follow() */
+    esp_timer_handle_t follow_timer;            /**< Settles the output on the status once the stream ends */
+    light_observer_t observers[LIGHT_OBSERVER_MAX];
+    esp_timer_handle_t notify_timer;            /**< Delivers the changes of a coalescing window to the observers */
+    bool notify_pending;
+    int64_t notify_last_us;                     /**< Time of the last notification */
+    light_status_t status_notified;             /**< Status of the last notification, the changes are against it */
+};
 
-    ESP_LOGD(TAG, "hue: %d, saturation: %d, value: %d",
-             g_light_status.hue, g_light_status.saturation, g_light_status.value);
-    ESP_LOGD(TAG, "brightness: %d, color_temperature: %d",
-             g_light_status.brightness, g_light_status.color_temperature);
+static const char *TAG                                  = "light_driver";
+static light_handle_t g_light_handles[LIGHT_HANDLE_MAX] = {NULL};
+static light_handle_t g_light_default                   = NULL;
+static uint32_t g_ledc_channel_used                     = 0;
+static ledc_timer_t g_ledc_timer_white                  = LIGHT_LEDC_TIMER; /**< LEDC timer of the warm and cold channels */
+static TaskHandle_t g_light_task                        = NULL;
+static SemaphoreHandle_t g_light_mutex                  = NULL;
+static SemaphoreHandle_t g_store_mutex                  = NULL; /**< Keeps the flash writes of the status in order */
 
-    return ESP_OK;
+/**
+ * @brief The lights are owned by the light task, other contexts must hold this lock to access them
+ */
+static void light_status_lock()
+{
+    if (g_light_mutex) {
+        xSemaphoreTakeRecursive(g_light_mutex, portMAX_DELAY);
+    }
 }
 
-esp_err_t light_driver_deinit()
+static void light_status_unlock()
 {
-    esp_err_t ret = ESP_OK;
-
-    iot_led_deinit();
-
-    return ret;
+    if (g_light_mutex) {
+        xSemaphoreGiveRecursive(g_light_mutex);
+    }
 }
 
-esp_err_t light_driver_config(uint32_t fade_period_ms, uint32_t blink_period_ms)
+/**
+ * @brief Copy of the status, read under the lock so that the fields belong to one command
+ */
+static light_status_t light_status_get(light_handle_t light)
 {
-    g_light_status.fade_period_ms = fade_period_ms;
-    g_light_status.blink_period_ms = blink_period_ms;
+    light_status_lock();
+    light_status_t status = light->status;
+    light_status_unlock();
 
-    return ESP_OK;
+    return status;
 }
 
-esp_err_t light_driver_set_rgb(uint8_t red, uint8_t green, uint8_t blue)
+/**
+ * @brief Check that the handle has not been deleted, must be called with the lock held
+ */
+static bool light_handle_is_valid(light_handle_t light)
 {
-    esp_err_t ret = 0;
+    for (int i = 0; light && i < LIGHT_HANDLE_MAX; i++) {
+        if (g_light_handles[i] == light) {
+            return true;
+        }
+    }
 
-    ret = iot_led_set_channel(CHANNEL_ID_RED, red, 0);
-    LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+    return false;
+}
 
-    ret = iot_led_set_channel(CHANNEL_ID_GREEN, green, 0);
-    LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+static void light_driver_hsv2rgb(uint16_t hue, uint8_t saturation, uint8_t value,
+                                 uint16_t *red, uint16_t *green, uint16_t *blue);
 
-    ret = iot_led_set_channel(CHANNEL_ID_BLUE, blue, 0);
-    LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+/**
+ * @brief Power budget after derating, UINT32_MAX without a limit
+ */
+static uint32_t light_power_budget(light_handle_t light)
+{
+    const light_driver_power_config_t *power = &light->power;
+    int32_t percent = 100;
 
-    ret = iot_led_set_channel(CHANNEL_ID_WARM, 0, 0);
-    LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+    if (!power->budget_mw) {
+        return UINT32_MAX;
+    }
 
-    ret = iot_led_set_channel(CHANNEL_ID_COLD, 0, 0);
-    LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+    if (power->derate_end_c > power->derate_start_c && light->temperature_c != LIGHT_TEMPERATURE_NONE
+            && light->temperature_c > power->derate_start_c) {
+        percent = (light->temperature_c >= power->derate_end_c) ? power->derate_min_percent
+                  : 100 - (100 - power->derate_min_percent) * (light->temperature_c - power->derate_start_c)
+                  / (power->derate_end_c - power->derate_start_c);
+    }
 
-    return ESP_OK;
+    return (uint64_t)power->budget_mw * percent / 100;
 }
 
-static esp_err_t light_driver_hsv2rgb(uint16_t hue, uint8_t saturation, uint8_t value,
-                                      uint8_t *red, uint8_t *green, uint8_t *blue)
+/**
+ * @brief Power of the given colours at the given 16-bit outputs (mW), through the calibration of each colour
+ */
+static uint32_t light_power_mw(light_handle_t light, uint32_t channel_mask, const uint16_t values[CHANNEL_ID_MAX])
 {
-    uint16_t hi = (hue / 60) % 6;
-    uint16_t F = 100 * hue / 60 - 100 * hi;
-    uint16_t P = value * (100 - saturation) / 100;
-    uint16_t Q = value * (10000 - F * saturation) / 10000;
-    uint16_t T = value * (10000 - saturation * (100 - F)) / 10000;
+    uint64_t power = 0;
 
-    switch (hi) {
-        case 0:
-            *red   = value;
-            *green = T;
-            *blue  = P;
-            break;
-
-        case 1:
-            *red   = Q;
-            *green = value;
-            *blue  = P;
-            break;
-
-        case 2:
-            *red   = P;
-            *green = value;
-            *blue  = T;
-            break;
-
-        case 3:
-            *red   = P;
-            *green = Q;
-            *blue  = value;
-            break;
+    for (int id = 0; id < CHANNEL_ID_MAX; id++) {
+        if ((channel_mask & BIT(id)) && light->channel[id] != CHANNEL_NONE) {
+            power += (uint64_t)light->power_mw[id] * iot_led_value_to_duty(light->channel[id], values[id]);
+        }
+    }
 
-        case 4:
-            *red   = T;
-            *green = P;
-            *blue  = value;
-            break;
+    return (power + LIGHT_COLOR_MAX / 2) / LIGHT_COLOR_MAX;
+}
 
-        case 5:
-            *red   = value;
-            *green = P;
-            *blue  = Q;
-            break;
+/**
+ * @brief Scale the given colours by one factor in linear light until they fit in the budget
+ */
+static void light_power_limit(light_handle_t light, uint32_t channel_mask, uint16_t values[CHANNEL_ID_MAX])
+{
+    uint32_t budget = light_power_budget(light);
+    uint32_t power  = (budget == UINT32_MAX) ? 0 : light_power_mw(light, channel_mask, values);
 
-        default:
-            return ESP_FAIL;
+    if (power <= budget) {
+        return;
     }
 
-    *red   = *red * 255 / 100;
-    *green = *green * 255 / 100;
-    *blue  = *blue * 255 / 100;
-
-    return ESP_OK;
+    for (int id = 0; id < CHANNEL_ID_MAX; id++) {
+        if (channel_mask & BIT(id)) {
+            values[id] = iot_led_linear_to_value((uint64_t)iot_led_value_to_linear(values[id]) * budget / power);
+        }
+    }
 }
 
-static void light_driver_rgb2hsv(uint16_t red, uint16_t green, uint16_t blue,
-                                 uint16_t *h, uint8_t *s, uint8_t *v)
+/**
+ * @brief Map the colours of the light to their LEDC channels and update them at once
+ *
+ * @param  values 16-bit output of each colour, before the power limit
+ */
+static esp_err_t light_set_channels(light_handle_t light, uint32_t channel_mask,
+                                    const uint16_t values[CHANNEL_ID_MAX], uint32_t fade_ms,
+                                    iot_led_easing_t easing)
 {
-    double hue, saturation, value;
-    double m_max = MAX(red, MAX(green, blue));
-    double m_min = MIN(red, MIN(green, blue));
-    double m_delta = m_max - m_min;
-
-    value = m_max / 255.0;
+    uint16_t ledc_values[LEDC_CHANNEL_MAX] = {0};
+    uint16_t limited[CHANNEL_ID_MAX] = {0};
+    uint32_t ledc_mask = 0;
 
-    if (m_delta == 0) {
-        hue = 0;
-        saturation = 0;
-    } else {
-        saturation = m_delta / m_max;
+    memcpy(limited, values, sizeof(limited));
+    light_power_limit(light, channel_mask, limited);
 
-        if (red == m_max) {
-            hue = (green - blue) / m_delta;
-        } else if (green == m_max) {
-            hue = 2 + (blue - red) / m_delta;
-        } else {
-            hue = 4 + (red - green) / m_delta;
+    for (int id = 0; id < CHANNEL_ID_MAX; id++) {
+        if ((channel_mask & BIT(id)) && light->channel[id] != CHANNEL_NONE) {
+            ledc_values[light->channel[id]] = limited[id];
+            ledc_mask |= BIT(light->channel[id]);
         }
+    }
 
-        hue = hue * 60;
-
-        if (hue < 0) {
-            hue = hue + 360;
-        }
+    if (!ledc_mask) {
+        return ESP_OK;
     }
 
-    *h = (int)(hue + 0.5);
-    *s = (int)(saturation * 100 + 0.5);
-    *v = (int)(value * 100 + 0.5);
+    return iot_led_set_channels16_ex(ledc_mask, ledc_values, fade_ms, easing);
 }
 
-esp_err_t light_driver_set_hsv(uint16_t hue, uint8_t saturation, uint8_t value)
+static esp_err_t light_get_channel(light_handle_t light, int id, uint16_t *value)
 {
-    LIGHT_PARAM_CHECK(hue <= 360);
-    LIGHT_PARAM_CHECK(saturation <= 100);
-    LIGHT_PARAM_CHECK(value <= 100);
+    if (light->channel[id] == CHANNEL_NONE) {
+        *value = 0;
+        return ESP_OK;
+    }
 
-    esp_err_t ret = ESP_OK;
-    uint8_t red   = 0;
-    uint8_t green = 0;
-    uint8_t blue  = 0;
+    return iot_led_get_channel16(light->channel[id], value);
+}
 
-    ret = light_driver_hsv2rgb(hue, saturation, value, &red, &green, &blue);
-    LIGHT_ERROR_CHECK(ret < 0, ret, "light_driver_hsv2rgb, ret: %d", ret);
+static esp_err_t light_start_blink(light_handle_t light, int id, uint8_t value, uint32_t period_ms, bool fade_flag)
+{
+    if (light->channel[id] == CHANNEL_NONE) {
+        return ESP_OK;
+    }
 
-    ESP_LOGV(TAG, "red: %d, green: %d, blue: %d", red, green, blue);
+    return iot_led_start_blink(light->channel[id], value, period_ms, fade_flag);
+}
 
-    ret = iot_led_set_channel(CHANNEL_ID_RED, red, g_light_status.fade_period_ms);
-    LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+/**
+ * @brief The white part of the HSV colours goes to the warm and cold LEDs
+ */
+static bool light_white_mix_active(light_handle_t light)
+{
+    return light->white_mix
+           && (light->channel[CHANNEL_ID_WARM] != CHANNEL_NONE || light->channel[CHANNEL_ID_COLD] != CHANNEL_NONE);
+}
 
-    ret = iot_led_set_channel(CHANNEL_ID_GREEN, green, g_light_status.fade_period_ms);
-    LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+/**
+ * @brief Output of each colour for a HSV colour, mixed in linear light in white mix
+ *
+ * @return The colours to update, CHANNEL_MASK_ALL in white mix
+ */
+static uint32_t light_hsv_to_channels(light_handle_t light, uint16_t hue, uint8_t saturation, uint8_t value,
+                                      uint16_t values[CHANNEL_ID_MAX])
+{
+    static const uint16_t point_none[3] = {0};
+    uint16_t rgb[3] = {0};
+    uint16_t warm = 0, cold = 0;
 
-    ret = iot_led_set_channel(CHANNEL_ID_BLUE, blue, g_light_status.fade_period_ms);
-    LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+    light_driver_hsv2rgb(hue, saturation, value, &values[CHANNEL_ID_RED],
+                         &values[CHANNEL_ID_GREEN], &values[CHANNEL_ID_BLUE]);
 
-    if (g_light_status.mode != MODE_HSV) {
-        ret = iot_led_set_channel(CHANNEL_ID_WARM, 0, g_light_status.fade_period_ms);
-        LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+    if (!light_white_mix_active(light)) {
+        return CHANNEL_MASK_RGB;
+    }
 
-        ret = iot_led_set_channel(CHANNEL_ID_COLD, 0, g_light_status.fade_period_ms);
-        LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+    for (int i = 0; i < 3; i++) {
+        rgb[i] = iot_led_value_to_linear(values[CHANNEL_ID_RED + i]);
     }
 
-    g_light_status.mode       = MODE_HSV;
-    g_light_status.on         = 1;
-    g_light_status.hue        = hue;
-    g_light_status.value      = value;
-    g_light_status.saturation = saturation;
+    light_color_rgb2rgbw(rgb,
+                         (light->channel[CHANNEL_ID_WARM] != CHANNEL_NONE) ? light->white_point[LIGHT_WHITE_POINT_WARM] : point_none,
+                         (light->channel[CHANNEL_ID_COLD] != CHANNEL_NONE) ? light->white_point[LIGHT_WHITE_POINT_COLD] : point_none,
+                         &warm, &cold);
 
-    ret = app_storage_set(LIGHT_STATUS_STORE_KEY, &g_light_status, sizeof(light_status_t));
-    LIGHT_ERROR_CHECK(ret < 0, ret, "app_storage_set, ret: %d", ret);
+    for (int i = 0; i < 3; i++) {
+        values[CHANNEL_ID_RED + i] = iot_led_linear_to_value(rgb[i]);
+    }
 
-    return ESP_OK;
-}
+    values[CHANNEL_ID_WARM] = iot_led_linear_to_value(warm);
+    values[CHANNEL_ID_COLD] = iot_led_linear_to_value(cold);
 
-esp_err_t light_driver_set_hue(uint16_t hue)
-{
-    return light_driver_set_hsv(hue, g_light_status.saturation, g_light_status.value);
+    return CHANNEL_MASK_ALL;
 }
 
-esp_err_t light_driver_set_saturation(uint8_t saturation)
+/**
+ * @brief Current red, green and blue of the light, with the white of warm and cold added back in white mix
+ */
+static esp_err_t light_get_rgb(light_handle_t light, uint16_t *red, uint16_t *green, uint16_t *blue)
 {
-    return light_driver_set_hsv(g_light_status.hue, saturation, g_light_status.value);
-}
+    uint16_t values[CHANNEL_ID_MAX] = {0};
+    uint16_t *rgb[3] = {red, green, blue};
 
-esp_err_t light_driver_set_value(uint8_t value)
-{
-    return light_driver_set_hsv(g_light_status.hue, g_light_status.saturation, value);
-}
+    for (int id = 0; id < CHANNEL_ID_MAX; id++) {
+        esp_err_t ret = light_get_channel(light, id, &values[id]);
+        LIGHT_ERROR_CHECK(ret != ESP_OK, ret, "iot_led_get_channel, ret: %d", ret);
+    }
 
-esp_err_t light_driver_get_hsv(uint16_t *hue, uint8_t *saturation, uint8_t *value)
-{
-    LIGHT_PARAM_CHECK(hue);
-    LIGHT_PARAM_CHECK(saturation);
-    LIGHT_PARAM_CHECK(value);
+    for (int i = 0; i < 3; i++) {
+        uint32_t linear = iot_led_value_to_linear(values[CHANNEL_ID_RED + i]);
 
-    *hue        = g_light_status.hue;
-    *saturation = g_light_status.saturation;
-    *value      = g_light_status.value;
+        if (light_white_mix_active(light)) {
+            uint32_t warm = iot_led_value_to_linear(values[CHANNEL_ID_WARM]);
+            uint32_t cold = iot_led_value_to_linear(values[CHANNEL_ID_COLD]);
+
+            linear += (light->white_point[LIGHT_WHITE_POINT_WARM][i] * warm + 0x8000) >> 16;
+            linear += (light->white_point[LIGHT_WHITE_POINT_COLD][i] * cold + 0x8000) >> 16;
+        }
+
+        *rgb[i] = iot_led_linear_to_value(MIN(linear, LIGHT_COLOR_MAX));
+    }
 
     return ESP_OK;
 }
 
-uint16_t light_driver_get_hue()
+/**
+ * @brief Largest power of the RGB colours along a hue fade to the given colour (mW)
+ *
+ * The fade starts from the colour the channels show now and moves the hue
+ * along the shorter arc. At a given saturation and value one colour is at the
+ * value, one at its floor and the third moves one way within each sixth of the
+ * colour circle, so the power peaks at an end of the arc or at a sixth it crosses.
+ *
+ * @param  hue        16-bit hue of light_color_degree_to_hue()
+ * @param  saturation Q16 saturation of the target
+ * @param  value      Q16 value of the target
+ */
+static uint32_t light_power_hsv_mw(light_handle_t light, uint16_t hue, uint16_t saturation, uint16_t value)
 {
-    return g_light_status.hue;
-}
+    uint16_t values[CHANNEL_ID_MAX] = {0};
+    uint16_t start_hue = hue;
+    uint16_t start_saturation = 0;
+    uint16_t start_value = 0;
 
-uint8_t light_driver_get_saturation()
-{
-    return g_light_status.saturation;
-}
+    for (int id = CHANNEL_ID_RED; id <= CHANNEL_ID_BLUE; id++) {
+        light_get_channel(light, id, &values[id]);
+    }
 
-uint8_t light_driver_get_value()
-{
-    return g_light_status.value;
-}
+    light_color_rgb2hsv(values[CHANNEL_ID_RED], values[CHANNEL_ID_GREEN], values[CHANNEL_ID_BLUE],
+                        &start_hue, &start_saturation, &start_value);
 
-uint8_t light_driver_get_mode()
-{
-    return g_light_status.mode;
-}
+    /**< Like iot_led_set_hsv_channels_ex(), black and grey start at the target hue */
+    if (!start_value || !start_saturation) {
+        start_hue = hue;
+    }
 
-esp_err_t light_driver_set_ctb(uint8_t color_temperature, uint8_t brightness)
-{
-    LIGHT_PARAM_CHECK(brightness <= 100);
-    LIGHT_PARAM_CHECK(color_temperature <= 100);
+    int32_t arc = (int16_t)(hue - start_hue);
+    uint32_t power = 0;
 
-    esp_err_t ret = ESP_OK;
-    uint8_t warm_tmp = color_temperature * brightness / 100;
-    uint8_t cold_tmp = (100 - color_temperature) * brightness / 100;
-    warm_tmp         = warm_tmp < 15 ? warm_tmp : 14 + warm_tmp * 86 / 100;
-    cold_tmp         = cold_tmp < 15 ? cold_tmp : 14 + cold_tmp * 86 / 100;
+    for (int i = -2; i < 6; i++) {
+        /**< The ends of the arc, then the borders of the sixths */
+        uint16_t point = (i == -2) ? hue : (i == -1) ? start_hue : (uint16_t)((i * 0x10000 + 3) / 6);
+        int32_t offset = (int16_t)(point - start_hue);
 
-    ret = iot_led_set_channel(CHANNEL_ID_COLD,
-                              cold_tmp * 255 / 100, g_light_status.fade_period_ms);
-    LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+        if (i >= 0 && !(arc > 0 && offset > 0 && offset < arc) && !(arc < 0 && offset < 0 && offset > arc)) {
+            continue;
+        }
+
+        light_color_hsv2rgb(point, saturation, value, &values[CHANNEL_ID_RED],
+                            &values[CHANNEL_ID_GREEN], &values[CHANNEL_ID_BLUE]);
+        power = MAX(power, light_power_mw(light, CHANNEL_MASK_RGB, values));
+    }
 
-    ret = iot_led_set_channel(CHANNEL_ID_WARM,
-                              warm_tmp * 255 / 100, g_light_status.fade_period_ms);
-    LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+    return power;
+}
 
-    if (g_light_status.mode != MODE_CTB) {
-        ret = iot_led_set_channel(CHANNEL_ID_RED, 0, g_light_status.fade_period_ms);
-        LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+/**
+ * @brief Fade red, green and blue in HSV space, falls back to an RGB fade if not all of them are connected
+ *
+ * In white mix the colours fade channel by channel, the white part moves
+ * between the colour and the white LEDs along the way.
+ */
+static esp_err_t light_set_hsv_channels(light_handle_t light, uint16_t hue, uint8_t saturation,
+                                        uint8_t value, uint32_t fade_ms, iot_led_easing_t easing)
+{
+    const ledc_channel_t channels[3] = {
+        light->channel[CHANNEL_ID_RED], light->channel[CHANNEL_ID_GREEN], light->channel[CHANNEL_ID_BLUE],
+    };
 
-        ret = iot_led_set_channel(CHANNEL_ID_GREEN, 0, g_light_status.fade_period_ms);
-        LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+    if (light_white_mix_active(light)) {
+        uint16_t values[CHANNEL_ID_MAX] = {0};
+        uint32_t channel_mask = light_hsv_to_channels(light, hue, saturation, value, values);
 
-        ret = iot_led_set_channel(CHANNEL_ID_BLUE, 0, g_light_status.fade_period_ms);
-        LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+        return light_set_channels(light, channel_mask, values, fade_ms, easing);
     }
 
-    g_light_status.mode              = MODE_CTB;
-    g_light_status.on                = 1;
-    g_light_status.brightness        = brightness;
-    g_light_status.color_temperature = color_temperature;
+    if (light->channel[CHANNEL_ID_RED] == CHANNEL_NONE || light->channel[CHANNEL_ID_GREEN] == CHANNEL_NONE
+            || light->channel[CHANNEL_ID_BLUE] == CHANNEL_NONE) {
+        uint16_t values[CHANNEL_ID_MAX] = {0};
 
-    ret = app_storage_set(LIGHT_STATUS_STORE_KEY, &g_light_status, sizeof(light_status_t));
-    LIGHT_ERROR_CHECK(ret < 0, ret, "app_storage_set, ret: %d", ret);
+        light_driver_hsv2rgb(hue, saturation, value, &values[CHANNEL_ID_RED],
+                             &values[CHANNEL_ID_GREEN], &values[CHANNEL_ID_BLUE]);
 
-    return ESP_OK;
-}
+        return light_set_channels(light, CHANNEL_MASK_RGB, values, fade_ms, easing);
+    }
 
-esp_err_t light_driver_set_color_temperature(uint8_t color_temperature)
-{
-    return light_driver_set_ctb(color_temperature, g_light_status.brightness);
-}
+    /**
+     * The colours are in proportion to the value, scaling its linear light keeps the hue.
+     * The fade interrupt moves the hue without a limit, so the value is limited for the
+     * worst colour on the way, e.g. magenta between red and blue
+     */
+    uint16_t value_q16 = light_color_percent_to_q16(value);
+    uint32_t budget    = light_power_budget(light);
+    uint32_t power     = (budget == UINT32_MAX) ? 0 : light_power_hsv_mw(light, light_color_degree_to_hue(hue),
+                                                                        light_color_percent_to_q16(saturation), value_q16);
+
+    if (power > budget) {
+        value_q16 = iot_led_linear_to_value((uint64_t)iot_led_value_to_linear(value_q16) * budget / power);
+    }
 
-esp_err_t light_driver_set_brightness(uint8_t brightness)
-{
-    return light_driver_set_ctb(g_light_status.color_temperature, brightness);
+    return iot_led_set_hsv_channels_ex(channels, light_color_degree_to_hue(hue), light_color_percent_to_q16(saturation),
+                                       value_q16, fade_ms, easing);
 }
 
-esp_err_t light_driver_get_ctb(uint8_t *color_temperature, uint8_t *brightness)
+static esp_err_t light_stop_blink(light_handle_t light, int id)
 {
-    LIGHT_PARAM_CHECK(color_temperature);
-    LIGHT_PARAM_CHECK(brightness);
-
-    *brightness        = g_light_status.brightness;
-    *color_temperature = g_light_status.color_temperature;
+    if (light->channel[id] == CHANNEL_NONE) {
+        return ESP_OK;
+    }
 
-    return ESP_OK;
+    return iot_led_stop_blink(light->channel[id]);
 }
 
-uint8_t light_driver_get_color_temperature()
+/**
+ * @brief Write a snapshot of the status to flash if it changed, see light_status_write()
+ */
+static esp_err_t light_status_write_snapshot(light_handle_t light)
 {
-    return g_light_status.color_temperature;
-}
+    esp_err_t ret = ESP_OK;
+    light_status_t status;
+    char store_key[LIGHT_STORE_KEY_LEN_MAX + 1];
 
-uint8_t light_driver_get_brightness()
-{
-    return g_light_status.brightness;
-}
+    light_status_lock();
 
-esp_err_t light_driver_set_switch(bool on)
-{
-    esp_err_t ret     = ESP_OK;
-    g_light_status.on = on;
+    if (!light_handle_is_valid(light) || !light->store_dirty) {
+        light_status_unlock();
+        return ESP_OK;
+    }
 
-    if (!g_light_status.on) {
-        ret = iot_led_set_channel(CHANNEL_ID_RED, 0, g_light_status.fade_period_ms);
-        LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_set_channel, ret: %d", ret);
+    light->store_dirty = false;
 
-        ret = iot_led_set_channel(CHANNEL_ID_GREEN, 0, g_light_status.fade_period_ms);
-        LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_set_channel, ret: %d", ret);
+    if (!memcmp(&light->status, &light->status_stored, sizeof(light_status_t))) {
+        light->store_stats.skip_count++;
+        light_status_unlock();
+        return ESP_OK;
+    }
 
-        ret = iot_led_set_channel(CHANNEL_ID_BLUE, 0, g_light_status.fade_period_ms);
-        LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_set_channel, ret: %d", ret);
+    status = light->status;
+    memcpy(store_key, light->store_key, sizeof(store_key));
 
-        ret = iot_led_set_channel(CHANNEL_ID_COLD, 0, g_light_status.fade_period_ms);
-        LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_set_channel, ret: %d", ret);
+    light_status_unlock();
 
-        ret = iot_led_set_channel(CHANNEL_ID_WARM, 0, g_light_status.fade_period_ms);
-        LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_set_channel, ret: %d", ret);
+    ret = app_storage_set(store_key, &status, sizeof(light_status_t));
 
-    } else {
-        switch (g_light_status.mode) {
-            case MODE_HSV:
-                g_light_status.value = (g_light_status.value) ? g_light_status.value : 100;
-                ret = light_driver_set_hsv(g_light_status.hue, g_light_status.saturation, g_light_status.value);
-                LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "light_driver_set_hsv, ret: %d", ret);
-                break;
+    light_status_lock();
 
-            case MODE_CTB:
-                g_light_status.brightness = (g_light_status.brightness) ? g_light_status.brightness : 100;
-                ret = light_driver_set_ctb(g_light_status.color_temperature, g_light_status.brightness);
-                LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "light_driver_set_ctb, ret: %d", ret);
-                break;
+    if (ret == ESP_OK && light_handle_is_valid(light)) {
+        light->status_stored  = status;
+        light->store_retry_ms = 0;
+        light->store_stats.write_count++;
+    } else if (light_handle_is_valid(light)) {
+        /**< Keep the status dirty and retry, unless a newer change already restarted the timer */
+        light->store_dirty    = true;
+        light->store_retry_ms = light->store_retry_ms ? MIN(light->store_retry_ms * 2, LIGHT_STORE_RETRY_MAX_MS)
+                                : LIGHT_STORE_RETRY_MIN_MS;
 
-            default:
-                ESP_LOGW(TAG, "This operation is not supported");
-                break;
+        if (light->store_timer && !esp_timer_is_active(light->store_timer)) {
+            esp_timer_start_once(light->store_timer, light->store_retry_ms * 1000ULL);
         }
     }
 
-    ret = app_storage_set(LIGHT_STATUS_STORE_KEY, &g_light_status, sizeof(light_status_t));
-    LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "app_storage_set, ret: %d", ret);
-
-    return ESP_OK;
-}
+    light_status_unlock();
 
-bool light_driver_get_switch()
-{
-    return g_light_status.on;
+    return ret;
 }
 
-esp_err_t light_driver_breath_start(uint8_t red, uint8_t green, uint8_t blue)
+/**
+ * @brief Write the status of the light to flash if it changed
+ *
+ * The lock is only held to take a snapshot of the status and to record the
+ * result, so the light task and the setters never wait for the flash commit.
+ * Must be called without the lock held, the writes of all lights are kept in
+ * order by g_store_mutex.
+ */
+static esp_err_t light_status_write(light_handle_t light)
 {
     esp_err_t ret = ESP_OK;
 
-    ret = iot_led_start_blink(CHANNEL_ID_RED,
-                              red, g_light_status.blink_period_ms, true);
-    LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_start_blink, ret: %d", ret);
-    ret = iot_led_start_blink(CHANNEL_ID_GREEN,
-                              green, g_light_status.blink_period_ms, true);
-    LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_start_blink, ret: %d", ret);
-    ret = iot_led_start_blink(CHANNEL_ID_BLUE,
-                              blue, g_light_status.blink_period_ms, true);
-    LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_start_blink, ret: %d", ret);
+    if (g_store_mutex) {
+        xSemaphoreTake(g_store_mutex, portMAX_DELAY);
+    }
+
+    ret = light_status_write_snapshot(light);
+
+    if (g_store_mutex) {
+        xSemaphoreGive(g_store_mutex);
+    }
 
-    g_light_blink_flag = true;
+    LIGHT_ERROR_CHECK(ret != ESP_OK, ret, "app_storage_set, ret: %d", ret);
 
     return ESP_OK;
 }
 
-esp_err_t light_driver_breath_stop()
+esp_err_t light_handle_store_flush(light_handle_t light)
 {
-    esp_err_t ret = ESP_OK;
+    LIGHT_PARAM_CHECK(light);
 
-    if (g_light_blink_flag == false) {
-        return ESP_OK;
+    if (light->store_timer) {
+        esp_timer_stop(light->store_timer);
     }
 
-    ret = iot_led_stop_blink(CHANNEL_ID_RED);
-    LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_stop_blink, ret: %d", ret);
-
-    ret = iot_led_stop_blink(CHANNEL_ID_GREEN);
-    LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_stop_blink, ret: %d", ret);
-
-    ret = iot_led_stop_blink(CHANNEL_ID_BLUE);
-    LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_stop_blink, ret: %d", ret);
-
-    light_driver_set_switch(true);
-
-    return ESP_OK;
+    return light_status_write(light);
 }
 
-esp_err_t light_driver_fade_brightness(uint8_t brightness)
+esp_err_t light_driver_store_flush()
 {
     esp_err_t ret = ESP_OK;
-    g_fade_mode   = MODE_ON;
-    uint32_t fade_period_ms = 0;
-
-    if (g_light_status.mode == MODE_HSV) {
-        uint8_t red   = 0;
-        uint8_t green = 0;
-        uint8_t blue  = 0;
-
-        ret = light_driver_hsv2rgb(g_light_status.hue, g_light_status.saturation, g_light_status.value, &red, &green, &blue);
-        LIGHT_ERROR_CHECK(ret < 0, ret, "light_driver_hsv2rgb, ret: %d", ret);
+    light_handle_t lights[LIGHT_HANDLE_MAX];
 
-        if (brightness != 0) {
-            ret = iot_led_get_channel((ledc_channel_t)CHANNEL_ID_RED, &red);
-            LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_get_channel, ret: %d", ret);
-            ret = iot_led_get_channel((ledc_channel_t)CHANNEL_ID_GREEN, &green);
-            LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_get_channel, ret: %d", ret);
-            ret = iot_led_get_channel((ledc_channel_t)CHANNEL_ID_BLUE, &blue);
-            LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_get_channel, ret: %d", ret);
+    light_status_lock();
+    memcpy(lights, g_light_handles, sizeof(lights));
+    light_status_unlock();
 
-            uint8_t max_color       = MAX(MAX(red, green), blue);
-            uint8_t change_value    = brightness * 255 / 100 - max_color;
-            fade_period_ms = LIGHT_FADE_PERIOD_MAX_MS * change_value / 255;
-        } else {
-            fade_period_ms = LIGHT_FADE_PERIOD_MAX_MS * MAX(MAX(red, green), blue) / 255;
-            red   = 0;
+    /**< A light deleted meanwhile is skipped by light_status_write() */
+    for (int i = 0; i < LIGHT_HANDLE_MAX; i++) {
+        if (lights[i] && light_status_write(lights[i]) != ESP_OK) {
+            ret = ESP_FAIL;
         }
+    }
 
-        g_light_status.value = brightness;
-        light_driver_hsv2rgb(g_light_status.hue, g_light_status.saturation, g_light_status.value, &red, &green, &blue);
-
-        ret = iot_led_set_channel(CHANNEL_ID_RED, red, fade_period_ms);
-        LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+    return ret;
+}
 
-        ret = iot_led_set_channel(CHANNEL_ID_GREEN, green, fade_period_ms);
-        LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+static void light_status_store_timer_cb(void *arg)
+{
+    light_status_write((light_handle_t)arg);
+}
 
-        ret = iot_led_set_channel(CHANNEL_ID_BLUE, blue, fade_period_ms);
-        LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+/**
+ * @brief Write the status of every light before a restart
+ *
+ * The locks are taken in the order of light_status_write() but with a bounded
+ * wait, so a stuck holder cannot hang esp_restart(), the status is then lost.
+ */
+static void light_status_store_shutdown_handler()
+{
+    if (g_store_mutex && xSemaphoreTake(g_store_mutex, pdMS_TO_TICKS(LIGHT_SHUTDOWN_WAIT_MS)) != pdTRUE) {
+        ESP_LOGW(TAG, "Store busy, the light status is not written before the restart");
+        return;
+    }
 
-    } else if (g_light_status.mode == MODE_CTB) {
-        uint8_t warm_tmp = 0;
-        uint8_t cold_tmp = 0;
-        fade_period_ms = LIGHT_FADE_PERIOD_MAX_MS * g_light_status.brightness / 100;
+    if (g_light_mutex && xSemaphoreTakeRecursive(g_light_mutex, pdMS_TO_TICKS(LIGHT_SHUTDOWN_WAIT_MS)) != pdTRUE) {
+        xSemaphoreGive(g_store_mutex);
+        ESP_LOGW(TAG, "Light busy, the light status is not written before the restart");
+        return;
+    }
 
-        if (brightness != 0) {
-            uint8_t change_value = brightness - g_light_status.brightness;
-            warm_tmp = g_light_status.color_temperature;
-            cold_tmp = (brightness - g_light_status.color_temperature);
-            fade_period_ms = LIGHT_FADE_PERIOD_MAX_MS * change_value / 100;
+    for (int i = 0; i < LIGHT_HANDLE_MAX; i++) {
+        if (g_light_handles[i]) {
+            light_status_write_snapshot(g_light_handles[i]);
         }
+    }
 
-        ret = iot_led_set_channel(CHANNEL_ID_COLD,
-                                  cold_tmp * 255 / 100, fade_period_ms);
-        LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
-
-        ret = iot_led_set_channel(CHANNEL_ID_WARM,
-                                  warm_tmp * 255 / 100, fade_period_ms);
-        LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+    light_status_unlock();
 
-        g_light_status.brightness = brightness;
+    if (g_store_mutex) {
+        xSemaphoreGive(g_store_mutex);
     }
+}
 
-    ret = app_storage_set(LIGHT_STATUS_STORE_KEY, &g_light_status, sizeof(light_status_t));
-    LIGHT_ERROR_CHECK(ret < 0, ret, "app_storage_set, ret: %d", ret);
-
-    return ESP_OK;
+/**
+ * @brief Compare the status with the status of the last notification
+ *
+ * @return light_change_t of the fields that differ, 0 if none
+ */
+static uint32_t light_status_diff(const light_status_t *status, const light_status_t *notified)
+{
+    uint32_t changed = 0;
+
+    changed |= (status->on != notified->on) ? LIGHT_CHANGE_ON : 0;
+    changed |= (status->mode != notified->mode) ? LIGHT_CHANGE_MODE : 0;
+    changed |= (status->hue != notified->hue) ? LIGHT_CHANGE_HUE : 0;
+    changed |= (status->saturation != notified->saturation) ? LIGHT_CHANGE_SATURATION : 0;
+    changed |= (status->value != notified->value) ? LIGHT_CHANGE_VALUE : 0;
+    changed |= (status->color_temperature != notified->color_temperature) ? LIGHT_CHANGE_COLOR_TEMPERATURE : 0;
+    changed |= (status->brightness != notified->brightness) ? LIGHT_CHANGE_BRIGHTNESS : 0;
+    changed |= (status->kelvin != notified->kelvin) ? LIGHT_CHANGE_KELVIN : 0;
+
+    return changed;
 }
 
-static void light_fade_timer_stop()
+static void light_status_notify_timer_cb(void *arg)
 {
-    if (!g_fade_timer) {
-        return ;
-    }
+    light_handle_t light = (light_handle_t)arg;
+    light_observer_t observers[LIGHT_OBSERVER_MAX];
+    light_driver_state_t state = {0};
 
-    if (!xTimerStop(g_fade_timer, portMAX_DELAY)) {
-        ESP_LOGW(TAG, "xTimerStop timer: %p", g_fade_timer);
-    }
+    light_status_lock();
 
-    if (!xTimerDelete(g_fade_timer, portMAX_DELAY)) {
-        ESP_LOGW(TAG, "xTimerDelete timer: %p", g_fade_timer);
+    if (!light_handle_is_valid(light)) {
+        light_status_unlock();
+        return;
     }
 
-    g_fade_timer = NULL;
-}
+    light->notify_pending = false;
+    light->notify_last_us = esp_timer_get_time();
 
-static void light_fade_timer_cb(void *timer)
-{
-    uint8_t red   = 0;
-    uint8_t green = 0;
-    uint8_t blue  = 0;
-    uint32_t fade_period_ms = LIGHT_FADE_PERIOD_MAX_MS * 2 / 6;
-    int variety = (g_fade_hue > 180) ? 60 : -60;
+    state.changed           = light_status_diff(&light->status, &light->status_notified);
+    state.on                = light->status.on;
+    state.mode              = light->status.mode;
+    state.hue               = light->status.hue;
+    state.saturation        = light->status.saturation;
+    state.value             = light->status.value;
+    state.color_temperature = light->status.color_temperature;
+    state.brightness        = light->status.brightness;
+    state.kelvin            = light->status.kelvin;
 
-    if (g_light_status.hue >= 360 || g_light_status.hue <= 0) {
-        light_fade_timer_stop();
-    }
+    light->status_notified = light->status;
+    memcpy(observers, light->observers, sizeof(observers));
 
-    g_light_status.hue = g_light_status.hue >= 360 ? 360 : g_light_status.hue + variety;
-    g_light_status.hue = g_light_status.hue <= 60 ? 0 : g_light_status.hue + variety;
+    light_status_unlock();
 
-    light_driver_hsv2rgb(g_light_status.hue, g_light_status.saturation, g_light_status.value, &red, &green, &blue);
+    /**< Back where the last notification left it, nothing to report */
+    if (!state.changed) {
+        return;
+    }
 
-    iot_led_set_channel(CHANNEL_ID_RED, red, fade_period_ms);
-    iot_led_set_channel(CHANNEL_ID_GREEN, green, fade_period_ms);
-    iot_led_set_channel(CHANNEL_ID_BLUE, blue, fade_period_ms);
+    /**< Outside of the lock, so the observers may call the light driver and block on the network */
+    for (int i = 0; i < LIGHT_OBSERVER_MAX; i++) {
+        if (observers[i].cb) {
+            observers[i].cb(light, &state, observers[i].arg);
+        }
+    }
 }
 
-esp_err_t light_driver_fade_hue(uint16_t hue)
+/**
+ * @brief Notify the observers of a committed change, at most once per CONFIG_LIGHT_DRIVER_NOTIFY_WINDOW_MS
+ *
+ * The first change after a quiet window is delivered at once, the changes
+ * within the window are merged into one notification at its end.
+ */
+static void light_status_notify(light_handle_t light)
 {
-    esp_err_t ret = ESP_OK;
-    g_fade_mode   = MODE_HSV;
-    g_fade_hue    = hue;
+    if (!light->notify_timer || light->notify_pending) {
+        return;
+    }
 
-    light_fade_timer_stop();
+    int64_t wait_us = light->notify_last_us + CONFIG_LIGHT_DRIVER_NOTIFY_WINDOW_MS * 1000LL - esp_timer_get_time();
 
-    if (g_light_status.mode != MODE_HSV) {
-        ret = iot_led_set_channel(CHANNEL_ID_WARM, 0, 0);
-        LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+    light->notify_pending = true;
+    esp_timer_start_once(light->notify_timer, (wait_us > 0) ? wait_us : 0);
+}
+
+/**
+ * @brief Mark the light status dirty, it is written after CONFIG_LIGHT_DRIVER_STORE_DELAY_MS without changes
+ *
+ * @note  Every committed change passes here, so it also notifies the observers
+ */
+static esp_err_t light_status_store(light_handle_t light)
+{
+    light_status_notify(light);
 
-        ret = iot_led_set_channel(CHANNEL_ID_COLD, 0, 0);
-        LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+    if (light->store_dirty) {
+        light->store_stats.merge_count++;
     }
 
-    g_light_status.mode     = MODE_HSV;
-    g_light_status.value    = (g_light_status.value == 0) ? 100 : g_light_status.value;
-    uint32_t fade_period_ms = LIGHT_FADE_PERIOD_MAX_MS * 2 / 6;
+    light->store_dirty = true;
+
+    /**< Even without a delay the write runs in the timer task, outside of the lock */
+    esp_timer_stop(light->store_timer);
+    esp_timer_start_once(light->store_timer, CONFIG_LIGHT_DRIVER_STORE_DELAY_MS * 1000ULL);
+
+    return ESP_OK;
+}
 
-    light_fade_timer_cb(NULL);
+esp_err_t light_handle_get_store_stats(light_handle_t light, light_driver_store_stats_t *stats)
+{
+    LIGHT_PARAM_CHECK(light);
+    LIGHT_PARAM_CHECK(stats);
 
-    g_fade_timer = xTimerCreate("light_timer", fade_period_ms,
-                                true, NULL, light_fade_timer_cb);
-    xTimerStart(g_fade_timer, 0);
+    light_status_lock();
+    *stats = light->store_stats;
+    light_status_unlock();
 
     return ESP_OK;
 }
 
-esp_err_t light_driver_fade_warm(uint8_t color_temperature)
+/**
+ * @brief The colour conversions keep the channel outputs in 16 bits, the status in degrees and percent
+ */
+static void light_driver_hsv2rgb(uint16_t hue, uint8_t saturation, uint8_t value,
+                                 uint16_t *red, uint16_t *green, uint16_t *blue)
+{
+    light_color_hsv2rgb(light_color_degree_to_hue(hue), light_color_percent_to_q16(saturation),
+                        light_color_percent_to_q16(value), red, green, blue);
+}
+
+static void light_driver_rgb2hsv(uint16_t red, uint16_t green, uint16_t blue,
+                                 uint16_t *h, uint8_t *s, uint8_t *v)
+{
+    uint16_t hue        = 0;
+    uint16_t saturation = 0;
+    uint16_t value      = 0;
+
+    light_color_rgb2hsv(red, green, blue, &hue, &saturation, &value);
+
+    *h = light_color_hue_to_degree(hue);
+    *s = light_color_q16_to_percent(saturation);
+    *v = light_color_q16_to_percent(value);
+}
+
+static void light_driver_ctb2cw(uint8_t color_temperature, uint8_t brightness,
+                                uint16_t *warm, uint16_t *cold)
+{
+    light_color_ctb2cw(light_color_percent_to_q16(color_temperature),
+                       light_color_percent_to_q16(brightness), warm, cold);
+}
+
+static void light_driver_cw2ctb(uint16_t warm, uint16_t cold,
+                                uint8_t *color_temperature, uint8_t *brightness)
+{
+    uint16_t color_temperature_tmp = 0;
+    uint16_t brightness_tmp        = 0;
+
+    light_color_cw2ctb(warm, cold, &color_temperature_tmp, &brightness_tmp);
+
+    *color_temperature = light_color_q16_to_percent(color_temperature_tmp);
+    *brightness        = light_color_q16_to_percent(brightness_tmp);
+}
+
+/**
+ * @brief Warm and cold output of a colour temperature, in Kelvin through the table of
+ *        light_color_kelvin2cw() or in percent with the linear split
+ *
+ * The brightness is a channel value, the table splits its linear light.
+ */
+static void light_driver_cct2cw(uint8_t color_temperature, uint16_t kelvin, uint8_t brightness,
+                                uint16_t *warm, uint16_t *cold)
+{
+    uint16_t warm_full = 0;
+    uint16_t cold_full = 0;
+    uint32_t linear    = iot_led_value_to_linear(light_color_percent_to_q16(brightness));
+
+    if (!kelvin) {
+        light_driver_ctb2cw(color_temperature, brightness, warm, cold);
+        return;
+    }
+
+    light_color_kelvin2cw(kelvin, &warm_full, &cold_full);
+
+    *warm = iot_led_linear_to_value((warm_full * linear + 0x8000) >> 16);
+    *cold = iot_led_linear_to_value((cold_full * linear + 0x8000) >> 16);
+}
+
+static void light_driver_cw2cct(uint16_t warm, uint16_t cold, uint8_t *color_temperature,
+                                uint16_t *kelvin, uint8_t *brightness)
+{
+    uint16_t linear = 0;
+
+    if (!*kelvin) {
+        light_driver_cw2ctb(warm, cold, color_temperature, brightness);
+        return;
+    }
+
+    light_color_cw2kelvin(iot_led_value_to_linear(warm), iot_led_value_to_linear(cold), kelvin, &linear);
+
+    *color_temperature = light_color_q16_to_percent(light_color_kelvin_to_q16(*kelvin));
+    *brightness        = light_color_q16_to_percent(iot_led_linear_to_value(linear));
+}
+
+/**
+ * @brief Drive all channels of the light to the given status with one iot_led_set_channels16() call
+ */
+static esp_err_t light_driver_output(light_handle_t light, const light_status_t *status, uint32_t fade_ms,
+                                     iot_led_easing_t easing)
 {
     esp_err_t ret = ESP_OK;
-    g_fade_mode   = MODE_CTB;
+    uint16_t values[CHANNEL_ID_MAX] = {0};
+    uint32_t channel_mask = CHANNEL_MASK_ALL;
+
+    if (status->on) {
+        switch (status->mode) {
+            case MODE_HSV:
+                if (light->status.mode != MODE_HSV && !light_white_mix_active(light)) {
+                    ret = light_set_channels(light, CHANNEL_MASK_CW, values, fade_ms, easing);
+                    LIGHT_ERROR_CHECK(ret != ESP_OK, ret, "iot_led_set_channels, ret: %d", ret);
+                }
+
+                ESP_LOGV(TAG, "hue: %d, saturation: %d, value: %d", status->hue, status->saturation, status->value);
+
+                return light_set_hsv_channels(light, status->hue, status->saturation,
+                                              status->value, fade_ms, easing);
+
+            case MODE_CTB:
+                light_driver_cct2cw(status->color_temperature, status->kelvin, status->brightness,
+                                    &values[CHANNEL_ID_WARM], &values[CHANNEL_ID_COLD]);
+                channel_mask = (light->status.mode == MODE_CTB) ? CHANNEL_MASK_CW : CHANNEL_MASK_ALL;
+                break;
 
-    if (g_light_status.mode != MODE_CTB) {
-        ret = iot_led_set_channel(CHANNEL_ID_RED, 0, g_light_status.fade_period_ms);
-        LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+            default:
+                ESP_LOGW(TAG, "This operation is not supported");
+                return ESP_ERR_NOT_SUPPORTED;
+        }
+    }
+
+    ESP_LOGV(TAG, "red: %d, green: %d, blue: %d, warm: %d, cold: %d",
+             values[CHANNEL_ID_RED], values[CHANNEL_ID_GREEN], values[CHANNEL_ID_BLUE],
+             values[CHANNEL_ID_WARM], values[CHANNEL_ID_COLD]);
+
+    return light_set_channels(light, channel_mask, values, fade_ms, easing);
+}
+
+/**
+ * @brief Followed fields of a status
+ */
+static void light_follow_point(const light_status_t *status, light_follow_point_t *point)
+{
+    point->field[LIGHT_FOLLOW_HUE]               = status->hue;
+    point->field[LIGHT_FOLLOW_SATURATION]        = status->saturation;
+    point->field[LIGHT_FOLLOW_VALUE]             = status->value;
+    point->field[LIGHT_FOLLOW_COLOR_TEMPERATURE] = status->color_temperature;
+    point->field[LIGHT_FOLLOW_BRIGHTNESS]        = status->brightness;
+}
+
+/**
+ * @brief Follow a stream of commands as one trajectory, must be called with the lock held
+ *
+ * Only commands without a transition of their own are followed, see light_follow_update().
+ *
+ * @param  output  Status to drive, replaced by the prediction in a stream
+ * @param  fade_ms Fade time of the command, replaced in a stream
+ *
+ * @return true if the output follows a stream
+ */
+static bool light_handle_follow(light_handle_t light, uint32_t fields, const light_status_t *status,
+                                light_status_t *output, uint32_t *fade_ms)
+{
+    light_follow_point_t point, predicted;
+    light_follow_point(status, &point);
 
-        ret = iot_led_set_channel(CHANNEL_ID_GREEN, 0, g_light_status.fade_period_ms);
-        LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+    /**< The stream has ended, move to the last status at the largest rate */
+    if (fields == LIGHT_CMD_SETTLE) {
+        return light_follow_settle(&light->follow, &point, fade_ms);
+    }
+
+    bool continues = status->on && light->status.on && status->mode == light->status.mode
+                     && (status->mode == MODE_HSV || status->mode == MODE_CTB);
 
-        ret = iot_led_set_channel(CHANNEL_ID_BLUE, 0, g_light_status.fade_period_ms);
-        LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+    if (!light_follow_update(&light->follow, esp_timer_get_time(), fields & LIGHT_CMD_TRANSITION,
+                             continues, &point, &predicted, fade_ms)) {
+        return false;
     }
 
-    uint8_t warm_tmp =  color_temperature * g_light_status.brightness / 100;
-    uint8_t cold_tmp = (100 - color_temperature) * g_light_status.brightness / 100;
+    output->hue               = predicted.field[LIGHT_FOLLOW_HUE];
+    output->saturation        = predicted.field[LIGHT_FOLLOW_SATURATION];
+    output->value             = predicted.field[LIGHT_FOLLOW_VALUE];
+    output->color_temperature = predicted.field[LIGHT_FOLLOW_COLOR_TEMPERATURE];
+    output->brightness        = predicted.field[LIGHT_FOLLOW_BRIGHTNESS];
+
+    if (status->kelvin && output->color_temperature != status->color_temperature) {
+        output->kelvin = light_color_q16_to_kelvin(light_color_percent_to_q16(output->color_temperature));
+    }
 
-    ret = iot_led_set_channel(CHANNEL_ID_COLD, cold_tmp * 255 / 100, LIGHT_FADE_PERIOD_MAX_MS);
-    LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+    if (light->follow_timer) {
+        esp_timer_stop(light->follow_timer);
+        esp_timer_start_once(light->follow_timer, MAX(*fade_ms, light->follow.interval_ms * 2) * 1000ULL);
+    }
 
-    ret = iot_led_set_channel(CHANNEL_ID_WARM, warm_tmp * 255 / 100, LIGHT_FADE_PERIOD_MAX_MS);
-    LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channel, ret: %d", ret);
+    return true;
+}
 
-    g_light_status.mode              = MODE_CTB;
-    g_light_status.color_temperature = color_temperature;
-    ret = app_storage_set(LIGHT_STATUS_STORE_KEY, &g_light_status, sizeof(light_status_t));
-    LIGHT_ERROR_CHECK(ret < 0, ret, "app_storage_set, ret: %d", ret);
+static void light_follow_timer_cb(void *arg)
+{
+    light_handle_t light = (light_handle_t)arg;
 
-    return ESP_OK;
+    light_status_lock();
+
+    if (light_handle_is_valid(light) && g_light_task) {
+        portENTER_CRITICAL(&light->cmd_lock);
+        light->cmd.fields |= LIGHT_CMD_SETTLE;
+        portEXIT_CRITICAL(&light->cmd_lock);
+        xTaskNotifyGive(g_light_task);
+    }
+
+    light_status_unlock();
 }
 
-esp_err_t light_driver_fade_stop()
+/**
+ * @brief Merge all pending commands of the light into its status and apply the result
+ */
+static void light_cmd_apply(light_handle_t light)
 {
     esp_err_t ret = ESP_OK;
+    uint32_t fade_ms = 0;
+    light_cmd_t cmd;
 
-    light_fade_timer_stop();
+    portENTER_CRITICAL(&light->cmd_lock);
+    cmd = light->cmd;
+    light->cmd.fields = 0;
+    portEXIT_CRITICAL(&light->cmd_lock);
 
-    if (g_light_status.mode != MODE_CTB) {
-        uint16_t hue       = 0;
-        uint8_t saturation = 0;
-        uint8_t value      = 0;
+    uint32_t fields = cmd.fields;
 
-        ret = iot_led_stop_blink(CHANNEL_ID_RED);
-        LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_stop_blink, ret: %d", ret);
+    if (!fields) {
+        return;
+    }
 
-        ret = iot_led_stop_blink(CHANNEL_ID_GREEN);
-        LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_stop_blink, ret: %d", ret);
+    light_status_lock();
 
-        ret = iot_led_stop_blink(CHANNEL_ID_BLUE);
-        LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_stop_blink, ret: %d", ret);
+    light_status_t status = light->status;
 
-        uint8_t red, green, blue;
+    if (fields & LIGHT_CMD_HUE) {
+        status.hue = cmd.hue;
+    }
 
-        ret = iot_led_get_channel(CHANNEL_ID_RED, &red);
-        LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_get_channel, ret: %d", ret);
-        ret = iot_led_get_channel(CHANNEL_ID_GREEN, &green);
-        LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_get_channel, ret: %d", ret);
-        ret = iot_led_get_channel(CHANNEL_ID_BLUE, &blue);
-        LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_get_channel, ret: %d", ret);
+    if (fields & LIGHT_CMD_SATURATION) {
+        status.saturation = cmd.saturation;
+    }
 
-        light_driver_rgb2hsv(red, green, blue, &hue, &saturation, &value);
+    if (fields & LIGHT_CMD_VALUE) {
+        status.value = cmd.value;
+    }
+
+    if (fields & LIGHT_CMD_COLOR_TEMPERATURE) {
+        status.color_temperature = cmd.color_temperature;
+    }
+
+    if (fields & LIGHT_CMD_BRIGHTNESS) {
+        status.brightness = cmd.brightness;
+    }
+
+    if (fields & LIGHT_CMD_KELVIN) {
+        status.kelvin = cmd.kelvin;
+    }
+
+    if (fields & LIGHT_CMD_SWITCH) {
+        status.on = cmd.on;
+    }
+
+    if (fields & LIGHT_CMD_MODE) {
+        status.mode = cmd.mode;
+    }
+
+    /**< A change of mode without a level of its own keeps the level the light shows */
+    if (status.mode == MODE_CTB && light->status.mode == MODE_HSV && !(fields & LIGHT_CMD_BRIGHTNESS)) {
+        status.brightness = light->status.value;
+    } else if (status.mode == MODE_HSV && light->status.mode == MODE_CTB && !(fields & LIGHT_CMD_VALUE)) {
+        status.value = light->status.brightness;
+    }
+
+    /**< Switching on restores a visible brightness */
+    if ((fields & LIGHT_CMD_SWITCH) && status.on) {
+        if (status.mode == MODE_HSV && !(fields & LIGHT_CMD_VALUE) && !status.value) {
+            status.value = 100;
+        } else if (status.mode == MODE_CTB && !(fields & LIGHT_CMD_BRIGHTNESS) && !status.brightness) {
+            status.brightness = 100;
+        }
+    }
+
+    /**< The transition of a single command never changes the configured fade period */
+    fade_ms = (fields & LIGHT_CMD_TRANSITION) ? cmd.transition_ms : status.fade_period_ms;
+
+    /**< A new command continues the stream the settle timer saw ending */
+    if (fields != LIGHT_CMD_SETTLE) {
+        fields &= ~LIGHT_CMD_SETTLE;
+    }
+
+    light_status_t output = status;
+    bool follow = light_handle_follow(light, fields, &status, &output, &fade_ms);
+
+    if (fields == LIGHT_CMD_SETTLE && !follow) {
+        light_status_unlock();
+        return;
+    }
+
+    ret = light_driver_output(light, &output, fade_ms, follow ? IOT_LED_EASE_LINEAR : light->easing);
+
+    if (ret == ESP_OK && fields != LIGHT_CMD_SETTLE) {
+        light->status = status;
+        ret = light_status_store(light);
+    }
+
+    light_status_unlock();
+
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "<%s> Apply light command, fields: 0x%x", esp_err_to_name(ret), fields);
+    }
+}
+
+/**
+ * @brief Load the calibration of each connected colour from the factory partition, once
+ *
+ * Runs in the light task, so neither light_handle_create() nor the first
+ * command waits for the flash reads and the table computation.
+ */
+static void light_calibration_load(light_handle_t light)
+{
+    static const char *calibration_keys[CHANNEL_ID_MAX] = {
+        [CHANNEL_ID_RED]   = "red",
+        [CHANNEL_ID_GREEN] = "green",
+        [CHANNEL_ID_BLUE]  = "blue",
+        [CHANNEL_ID_WARM]  = "warm",
+        [CHANNEL_ID_COLD]  = "cold",
+    };
+
+    static const char *white_point_keys[2] = {
+        [LIGHT_WHITE_POINT_WARM] = "warm_rgb",
+        [LIGHT_WHITE_POINT_COLD] = "cold_rgb",
+    };
+
+    if (light->calibration_loaded) {
+        return;
+    }
+
+    light->calibration_loaded = true;
+
+    for (int i = 0; i < 2; i++) {
+        uint16_t white_point[3] = {0};
+
+        if (app_storage_factory_get(CONFIG_LIGHT_DRIVER_CALIBRATION_NAMESPACE, white_point_keys[i],
+                                    white_point, sizeof(white_point)) == ESP_OK) {
+            memcpy(light->white_point[i], white_point, sizeof(white_point));
+            ESP_LOGI(TAG, "White point of %s, red: %d, green: %d, blue: %d", white_point_keys[i],
+                     white_point[0], white_point[1], white_point[2]);
+        }
+    }
+
+    for (int id = 0; id < CHANNEL_ID_MAX; id++) {
+        iot_led_calibration_t calibration = {0};
+
+        if (light->channel[id] == CHANNEL_NONE
+                || app_storage_factory_get(CONFIG_LIGHT_DRIVER_CALIBRATION_NAMESPACE, calibration_keys[id],
+                                           &calibration, sizeof(iot_led_calibration_t)) != ESP_OK) {
+            continue;
+        }
+
+        if (iot_led_set_calibration(light->channel[id], &calibration) != ESP_OK) {
+            ESP_LOGW(TAG, "Invalid calibration of %s", calibration_keys[id]);
+            continue;
+        }
+
+        ESP_LOGI(TAG, "Calibration of %s, gamma: %d, gain: %d, offset: %d", calibration_keys[id],
+                 calibration.gamma_x1000, calibration.gain, calibration.offset);
+    }
+}
+
+static void light_driver_task(void *arg)
+{
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        light_status_lock();
+
+        /**< light_handle_delete() of the last light hands the task over to exit here, where it holds no lock */
+        if (g_light_task != xTaskGetCurrentTaskHandle()) {
+            light_status_unlock();
+            break;
+        }
 
-        g_light_status.hue   = (g_fade_mode == MODE_HSV) ? hue : g_light_status.hue;
-        g_light_status.value = (g_fade_mode == MODE_OFF || g_fade_mode == MODE_ON) ? value : g_light_status.value;
+        for (int i = 0; i < LIGHT_HANDLE_MAX; i++) {
+            if (g_light_handles[i]) {
+                light_calibration_load(g_light_handles[i]);
+                light_cmd_apply(g_light_handles[i]);
+            }
+        }
+
+        light_status_unlock();
+    }
+
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Merge a command into the mailbox of the light and wake the light task
+ *
+ * @param  cmd           Values of the command, only those of fields are used
+ * @param  transition_ms Fade time of this command, LIGHT_TRANSITION_DEFAULT for the configured fade period
+ */
+static esp_err_t light_cmd_post_ex(light_handle_t light, const light_cmd_t *cmd, uint32_t fields,
+                                   uint32_t transition_ms)
+{
+    LIGHT_ERROR_CHECK(g_light_task == NULL, ESP_ERR_INVALID_STATE, "light_handle_create() must be called first");
+
+    portENTER_CRITICAL(&light->cmd_lock);
+
+    light->cmd.hue               = (fields & LIGHT_CMD_HUE) ? cmd->hue : light->cmd.hue;
+    light->cmd.saturation        = (fields & LIGHT_CMD_SATURATION) ? cmd->saturation : light->cmd.saturation;
+    light->cmd.value             = (fields & LIGHT_CMD_VALUE) ? cmd->value : light->cmd.value;
+    light->cmd.color_temperature = (fields & LIGHT_CMD_COLOR_TEMPERATURE) ? cmd->color_temperature
+                                   : light->cmd.color_temperature;
+    light->cmd.brightness        = (fields & LIGHT_CMD_BRIGHTNESS) ? cmd->brightness : light->cmd.brightness;
+    light->cmd.kelvin            = (fields & LIGHT_CMD_KELVIN) ? cmd->kelvin : light->cmd.kelvin;
+    light->cmd.on                = (fields & LIGHT_CMD_SWITCH) ? cmd->on : light->cmd.on;
+    light->cmd.mode              = (fields & LIGHT_CMD_MODE) ? cmd->mode : light->cmd.mode;
+
+    /**< Like every other field the transition is latest-wins, a later default command drops it */
+    if (transition_ms == LIGHT_TRANSITION_DEFAULT) {
+        light->cmd.fields &= ~LIGHT_CMD_TRANSITION;
     } else {
-        uint8_t color_temperature = 0;
-        uint8_t brightness        = 0;
+        light->cmd.transition_ms = transition_ms;
+        fields |= LIGHT_CMD_TRANSITION;
+    }
 
-        ret = iot_led_stop_blink(CHANNEL_ID_COLD);
-        LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_stop_blink, ret: %d", ret);
+    light->cmd.fields |= fields;
 
-        ret = iot_led_stop_blink(CHANNEL_ID_WARM);
-        LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_stop_blink, ret: %d", ret);
+    portEXIT_CRITICAL(&light->cmd_lock);
 
-        uint8_t warm_tmp, cold_tmp;
-        uint8_t tmp;
+    xTaskNotifyGive(g_light_task);
 
-        ret = iot_led_get_channel(CHANNEL_ID_WARM, &tmp);
-        LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_get_channel, ret: %d", ret);
-        warm_tmp = (int32_t)tmp * 100 / 255;
+    return ESP_OK;
+}
 
-        ret = iot_led_get_channel(CHANNEL_ID_COLD, &tmp);
-        LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_get_channel, ret: %d", ret);
-        cold_tmp = (int32_t)tmp * 100 / 255;
+/**
+ * @brief Allocate a free LEDC channel for each connected colour of the light
+ */
+static esp_err_t light_channel_alloc(light_handle_t light, const light_driver_config_t *config)
+{
+    esp_err_t ret = ESP_OK;
+    const gpio_num_t gpio_nums[CHANNEL_ID_MAX] = {
+        [CHANNEL_ID_RED]   = config->gpio_red,
+        [CHANNEL_ID_GREEN] = config->gpio_green,
+        [CHANNEL_ID_BLUE]  = config->gpio_blue,
+        [CHANNEL_ID_WARM]  = config->gpio_warm,
+        [CHANNEL_ID_COLD]  = config->gpio_cold,
+    };
+
+    for (int id = 0; id < CHANNEL_ID_MAX; id++) {
+        int channel = 0;
+
+        if (!GPIO_IS_VALID_OUTPUT_GPIO(gpio_nums[id])) {
+            continue;
+        }
+
+        while (channel < LEDC_CHANNEL_MAX && (g_ledc_channel_used & BIT(channel))) {
+            channel++;
+        }
+
+        LIGHT_ERROR_CHECK(channel >= LEDC_CHANNEL_MAX, ESP_ERR_NOT_FOUND, "No free LEDC channel");
+
+        ret = iot_led_regist_channel_ex(channel, gpio_nums[id],
+                                        (id == CHANNEL_ID_WARM || id == CHANNEL_ID_COLD) ? g_ledc_timer_white : LIGHT_LEDC_TIMER);
+        LIGHT_ERROR_CHECK(ret != ESP_OK, ret, "iot_led_regist_channel, ret: %d", ret);
+
+        g_ledc_channel_used |= BIT(channel);
+        light->channel[id]   = channel;
+    }
+
+    return ESP_OK;
+}
 
-        color_temperature = (!warm_tmp) ? 0 : 100 / (cold_tmp / warm_tmp + 1);
-        brightness        = (!color_temperature) ? cold_tmp : warm_tmp * 100 / color_temperature;
+static void light_channel_free(light_handle_t light)
+{
+    for (int id = 0; id < CHANNEL_ID_MAX; id++) {
+        if (light->channel[id] != CHANNEL_NONE) {
+            iot_led_unregist_channel(light->channel[id]);
+            g_ledc_channel_used &= ~BIT(light->channel[id]);
+            light->channel[id] = CHANNEL_NONE;
+        }
+    }
+}
+
+esp_err_t light_handle_delete(light_handle_t light)
+{
+    bool last = true;
+    TaskHandle_t light_task = NULL;
+
+    LIGHT_PARAM_CHECK(light);
+
+    light_status_lock();
+
+    if (!light_handle_is_valid(light)) {
+        light_status_unlock();
+        ESP_LOGW(TAG, "<ESP_ERR_INVALID_ARG> light handle is not created");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /**< Apply the commands posted before the light is deleted, and store the result outside of the lock */
+    light_cmd_apply(light);
+    light_status_unlock();
+
+    light_handle_store_flush(light);
+
+    light_status_lock();
+
+    if (!light_handle_is_valid(light)) {
+        light_status_unlock();
+        ESP_LOGW(TAG, "<ESP_ERR_INVALID_ARG> light handle is deleted twice");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (int i = 0; i < LIGHT_HANDLE_MAX; i++) {
+        if (g_light_handles[i] == light) {
+            g_light_handles[i] = NULL;
+        } else if (g_light_handles[i]) {
+            last = false;
+        }
+    }
+
+    if (g_light_default == light) {
+        g_light_default = NULL;
+    }
+
+    if (light->store_timer) {
+        esp_timer_stop(light->store_timer);
+        esp_timer_delete(light->store_timer);
+    }
+
+    if (light->follow_timer) {
+        esp_timer_stop(light->follow_timer);
+        esp_timer_delete(light->follow_timer);
+    }
 
-        g_light_status.brightness        = (g_fade_mode == MODE_OFF || g_fade_mode == MODE_ON) ? brightness : g_light_status.brightness;
-        g_light_status.color_temperature = (g_fade_mode == MODE_CTB) ? color_temperature : g_light_status.color_temperature;
+    if (light->notify_timer) {
+        esp_timer_stop(light->notify_timer);
+        esp_timer_delete(light->notify_timer);
     }
 
-    ret = app_storage_set(LIGHT_STATUS_STORE_KEY, &g_light_status, sizeof(light_status_t));
-    LIGHT_ERROR_CHECK(ret < 0, ret, "app_storage_set, ret: %d", ret);
+    light_channel_free(light);
+    free(light);
+
+    if (last) {
+        esp_unregister_shutdown_handler(light_status_store_shutdown_handler);
+
+        /**< The task may wait for the lock, it is told to exit once the lock is released */
+        light_task   = g_light_task;
+        g_light_task = NULL;
+
+        iot_led_deinit();
+    }
+
+    light_status_unlock();
+
+    if (light_task) {
+        xTaskNotifyGive(light_task);
+    }
 
-    g_fade_mode = MODE_NONE;
     return ESP_OK;
 }
+
+esp_err_t light_handle_create(const light_driver_config_t *config, light_handle_t *handle)
+{
+    esp_err_t ret = ESP_OK;
+    light_handle_t light = NULL;
+    const char *store_key = NULL;
+    int index = LIGHT_HANDLE_MAX;
+    bool first = true;
+
+    LIGHT_PARAM_CHECK(config);
+    LIGHT_PARAM_CHECK(handle);
+
+    store_key = config->store_key ? config->store_key : LIGHT_STATUS_STORE_KEY;
+    LIGHT_PARAM_CHECK(strlen(store_key) <= LIGHT_STORE_KEY_LEN_MAX);
+
+    if (g_light_mutex == NULL) {
+        g_light_mutex = xSemaphoreCreateRecursiveMutex();
+        LIGHT_ERROR_CHECK(g_light_mutex == NULL, ESP_ERR_NO_MEM, "xSemaphoreCreateRecursiveMutex");
+    }
+
+    if (g_store_mutex == NULL) {
+        g_store_mutex = xSemaphoreCreateMutex();
+        LIGHT_ERROR_CHECK(g_store_mutex == NULL, ESP_ERR_NO_MEM, "xSemaphoreCreateMutex");
+    }
+
+    light = calloc(1, sizeof(struct light_driver));
+    LIGHT_ERROR_CHECK(light == NULL, ESP_ERR_NO_MEM, "calloc light");
+    light->cmd_lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+
+    memset(light->channel, CHANNEL_NONE, sizeof(light->channel));
+    strncpy(light->store_key, store_key, LIGHT_STORE_KEY_LEN_MAX);
+    light->fade_mode = MODE_NONE;
+    light->easing    = LIGHT_EASING_DEFAULT;
+    memcpy(light->white_point, g_white_point_default, sizeof(light->white_point));
+    light->temperature_c = LIGHT_TEMPERATURE_NONE;
+#ifdef CONFIG_LIGHT_DRIVER_WHITE_MIX
+    light->white_mix = true;
+#endif
+
+    if (app_storage_get(light->store_key, &light->status, sizeof(light_status_t)) != ESP_OK) {
+        ESP_LOGE(TAG, "Load light status failed, key: %s", light->store_key);
+        memset(&light->status, 0, sizeof(light_status_t));
+        light->status.mode              = MODE_HSV;
+        light->status.on                = 1;
+        light->status.hue               = 360;
+        light->status.saturation        = 0;
+        light->status.value             = 100;
+        light->status.color_temperature = 0;
+        light->status.brightness        = 30;
+        light->status.fade_period_ms    = config->fade_period_ms;
+        light->status.blink_period_ms   = config->blink_period_ms;
+    }
+
+    light->status_stored = light->status;
+
+    const esp_timer_create_args_t store_timer_args = {
+        .callback        = light_status_store_timer_cb,
+        .arg             = light,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name            = "light_store",
+    };
+
+    /**< The status is only written from the timer task, outside of the lock, a light without the timer is not created */
+    ret = esp_timer_create(&store_timer_args, &light->store_timer);
+
+    if (ret != ESP_OK) {
+        free(light);
+        ESP_LOGW(TAG, "<%s> esp_timer_create of the light status store", esp_err_to_name(ret));
+        return ret;
+    }
+
+    light_status_lock();
+
+    for (int i = LIGHT_HANDLE_MAX - 1; i >= 0; i--) {
+        if (g_light_handles[i]) {
+            first = false;
+        } else {
+            index = i;
+        }
+    }
+
+    if (index >= LIGHT_HANDLE_MAX) {
+        light_status_unlock();
+        esp_timer_delete(light->store_timer);
+        free(light);
+        ESP_LOGW(TAG, "<ESP_ERR_NO_MEM> Too many lights");
+        return ESP_ERR_NO_MEM;
+    }
+
+    /**< All lights share the LEDC timers, one fade timer and one light task */
+    if (first) {
+        iot_led_init(LIGHT_LEDC_TIMER, LEDC_LOW_SPEED_MODE, config->freq_hz, config->clk_cfg, config->duty_resolution);
+        g_ledc_timer_white = LIGHT_LEDC_TIMER;
+
+        if (config->freq_hz_white && iot_led_timer_config(LIGHT_LEDC_TIMER_WHITE, config->freq_hz_white, config->clk_cfg,
+                                                          config->duty_resolution_white) == ESP_OK) {
+            g_ledc_timer_white = LIGHT_LEDC_TIMER_WHITE;
+        }
+#ifdef CONFIG_LIGHT_DRIVER_HARDWARE_FADE
+        iot_led_set_fade_mode(IOT_LED_FADE_HARDWARE);
+#endif
+        esp_register_shutdown_handler(light_status_store_shutdown_handler);
+
+        if (xTaskCreate(light_driver_task, "light_driver", CONFIG_LIGHT_DRIVER_TASK_STACK_SIZE,
+                        NULL, CONFIG_LIGHT_DRIVER_TASK_PRIORITY, &g_light_task) != pdPASS) {
+            ret = ESP_ERR_NO_MEM;
+            g_light_task = NULL;
+        }
+    }
+
+    g_light_handles[index] = light;
+
+    if (ret == ESP_OK) {
+        ret = light_channel_alloc(light, config);
+    }
+
+    if (ret != ESP_OK) {
+        light_status_unlock();
+        light_handle_delete(light);
+        ESP_LOGW(TAG, "<%s> Create light", esp_err_to_name(ret));
+        return ret;
+    }
+
+    /**< Let the light task load the calibration of the new light */
+    xTaskNotifyGive(g_light_task);
+
+    light_status_unlock();
+
+    ESP_LOGD(TAG, "hue: %d, saturation: %d, value: %d",
+             light->status.hue, light->status.saturation, light->status.value);
+    ESP_LOGD(TAG, "brightness: %d, color_temperature: %d",
+             light->status.brightness, light->status.color_temperature);
+
+    *handle = light;
+
+    return ESP_OK;
+}
+
+esp_err_t light_handle_config(light_handle_t light, uint32_t fade_period_ms, uint32_t blink_period_ms)
+{
+    LIGHT_PARAM_CHECK(light);
+
+    light_status_lock();
+    light->status.fade_period_ms  = fade_period_ms;
+    light->status.blink_period_ms = blink_period_ms;
+    light_status_unlock();
+
+    return ESP_OK;
+}
+
+esp_err_t light_handle_set_easing(light_handle_t light, iot_led_easing_t easing)
+{
+    LIGHT_PARAM_CHECK(light);
+    LIGHT_PARAM_CHECK(easing < IOT_LED_EASE_MAX);
+
+    light_status_lock();
+    light->easing = easing;
+    light_status_unlock();
+
+    return ESP_OK;
+}
+
+esp_err_t light_handle_set_white_mix(light_handle_t light, bool enable)
+{
+    esp_err_t ret = ESP_OK;
+    const uint16_t values[CHANNEL_ID_MAX] = {0};
+
+    LIGHT_PARAM_CHECK(light);
+
+    light_status_lock();
+
+    light->white_mix = enable;
+
+    /**< Move the white of the current colour, the warm and cold LEDs are off in HSV mode without mixing */
+    if (light->status.on && light->status.mode == MODE_HSV) {
+        if (!enable) {
+            ret = light_set_channels(light, CHANNEL_MASK_CW, values, light->status.fade_period_ms, light->easing);
+        }
+
+        if (ret == ESP_OK) {
+            ret = light_driver_output(light, &light->status, light->status.fade_period_ms, light->easing);
+        }
+    }
+
+    light_status_unlock();
+
+    LIGHT_ERROR_CHECK(ret != ESP_OK, ret, "light_driver_output, ret: %d", ret);
+
+    return ESP_OK;
+}
+
+esp_err_t light_handle_add_observer(light_handle_t light, light_driver_observer_t cb, void *arg)
+{
+    esp_err_t ret = ESP_ERR_NO_MEM;
+
+    LIGHT_PARAM_CHECK(light);
+    LIGHT_PARAM_CHECK(cb);
+
+    light_status_lock();
+
+    if (!light->notify_timer) {
+        const esp_timer_create_args_t notify_timer_args = {
+            .callback        = light_status_notify_timer_cb,
+            .arg             = light,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name            = "light_notify",
+        };
+
+        if (esp_timer_create(&notify_timer_args, &light->notify_timer) != ESP_OK) {
+            light->notify_timer = NULL;
+            light_status_unlock();
+            ESP_LOGW(TAG, "<ESP_ERR_NO_MEM> esp_timer_create");
+            return ESP_ERR_NO_MEM;
+        }
+
+        light->status_notified = light->status;
+    }
+
+    for (int i = 0; i < LIGHT_OBSERVER_MAX; i++) {
+        if (!light->observers[i].cb) {
+            light->observers[i].cb  = cb;
+            light->observers[i].arg = arg;
+            ret = ESP_OK;
+            break;
+        }
+    }
+
+    light_status_unlock();
+
+    LIGHT_ERROR_CHECK(ret != ESP_OK, ret, "Too many observers, at most %d", LIGHT_OBSERVER_MAX);
+
+    return ESP_OK;
+}
+
+esp_err_t light_handle_remove_observer(light_handle_t light, light_driver_observer_t cb, void *arg)
+{
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+
+    LIGHT_PARAM_CHECK(light);
+    LIGHT_PARAM_CHECK(cb);
+
+    light_status_lock();
+
+    for (int i = 0; i < LIGHT_OBSERVER_MAX; i++) {
+        if (light->observers[i].cb == cb && light->observers[i].arg == arg) {
+            light->observers[i].cb  = NULL;
+            light->observers[i].arg = NULL;
+            ret = ESP_OK;
+            break;
+        }
+    }
+
+    light_status_unlock();
+
+    return ret;
+}
+
+esp_err_t light_handle_set_follow(light_handle_t light, bool enable, uint32_t max_rate)
+{
+    LIGHT_PARAM_CHECK(light);
+
+    light_status_lock();
+
+    if (enable && !light->follow_timer) {
+        const esp_timer_create_args_t follow_timer_args = {
+            .callback        = light_follow_timer_cb,
+            .arg             = light,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name            = "light_follow",
+        };
+
+        if (esp_timer_create(&follow_timer_args, &light->follow_timer) != ESP_OK) {
+            ESP_LOGW(TAG, "esp_timer_create failed, the end of a followed stream is not settled");
+            light->follow_timer = NULL;
+        }
+    }
+
+    if (!enable && light->follow_timer) {
+        esp_timer_stop(light->follow_timer);
+    }
+
+    light_follow_config(&light->follow, enable, max_rate);
+
+    light_status_unlock();
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Apply the status again with the new power limit, must be called with the lock held
+ */
+static esp_err_t light_power_update(light_handle_t light)
+{
+    if (!light->status.on) {
+        return ESP_OK;
+    }
+
+    return light_driver_output(light, &light->status, light->status.fade_period_ms, light->easing);
+}
+
+esp_err_t light_handle_set_power_config(light_handle_t light, const light_driver_power_config_t *config)
+{
+    esp_err_t ret = ESP_OK;
+
+    LIGHT_PARAM_CHECK(light);
+    LIGHT_PARAM_CHECK(config);
+    LIGHT_PARAM_CHECK(config->derate_min_percent <= 100);
+    LIGHT_PARAM_CHECK(config->derate_end_c >= config->derate_start_c);
+
+    light_status_lock();
+
+    light->power                      = *config;
+    light->power_mw[CHANNEL_ID_RED]   = config->red_mw;
+    light->power_mw[CHANNEL_ID_GREEN] = config->green_mw;
+    light->power_mw[CHANNEL_ID_BLUE]  = config->blue_mw;
+    light->power_mw[CHANNEL_ID_WARM]  = config->warm_mw;
+    light->power_mw[CHANNEL_ID_COLD]  = config->cold_mw;
+
+    ret = light_power_update(light);
+
+    light_status_unlock();
+
+    LIGHT_ERROR_CHECK(ret != ESP_OK, ret, "light_driver_output, ret: %d", ret);
+
+    return ESP_OK;
+}
+
+esp_err_t light_handle_set_temperature(light_handle_t light, int16_t temperature_c)
+{
+    esp_err_t ret = ESP_OK;
+
+    LIGHT_PARAM_CHECK(light);
+    LIGHT_PARAM_CHECK(temperature_c != LIGHT_TEMPERATURE_NONE);
+
+    light_status_lock();
+
+    uint32_t budget_old = light_power_budget(light);
+    light->temperature_c = temperature_c;
+
+    if (light_power_budget(light) != budget_old) {
+        ret = light_power_update(light);
+    }
+
+    light_status_unlock();
+
+    LIGHT_ERROR_CHECK(ret != ESP_OK, ret, "light_driver_output, ret: %d", ret);
+
+    return ESP_OK;
+}
+
+esp_err_t light_handle_get_power(light_handle_t light, uint32_t *power_mw, uint32_t *budget_mw)
+{
+    uint16_t values[CHANNEL_ID_MAX] = {0};
+
+    LIGHT_PARAM_CHECK(light);
+    LIGHT_PARAM_CHECK(power_mw);
+
+    light_status_lock();
+
+    for (int id = 0; id < CHANNEL_ID_MAX; id++) {
+        light_get_channel(light, id, &values[id]);
+    }
+
+    *power_mw = light_power_mw(light, CHANNEL_MASK_ALL, values);
+
+    if (budget_mw) {
+        *budget_mw = (light_power_budget(light) == UINT32_MAX) ? 0 : light_power_budget(light);
+    }
+
+    light_status_unlock();
+
+    return ESP_OK;
+}
+
+esp_err_t light_handle_set_rgb(light_handle_t light, uint8_t red, uint8_t green, uint8_t blue)
+{
+    esp_err_t ret = 0;
+    uint16_t values[CHANNEL_ID_MAX] = {
+        [CHANNEL_ID_RED]   = light_color_u8_to_q16(red),
+        [CHANNEL_ID_GREEN] = light_color_u8_to_q16(green),
+        [CHANNEL_ID_BLUE]  = light_color_u8_to_q16(blue),
+    };
+
+    LIGHT_PARAM_CHECK(light);
+
+    light_status_lock();
+    ret = light_set_channels(light, CHANNEL_MASK_ALL, values, 0, IOT_LED_EASE_LINEAR);
+    light_status_unlock();
+
+    LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channels, ret: %d", ret);
+
+    return ESP_OK;
+}
+
+esp_err_t light_handle_set_hsv(light_handle_t light, uint16_t hue, uint8_t saturation, uint8_t value)
+{
+    return light_handle_set_hsv_ex(light, hue, saturation, value, LIGHT_TRANSITION_DEFAULT);
+}
+
+esp_err_t light_handle_set_hsv_ex(light_handle_t light, uint16_t hue, uint8_t saturation, uint8_t value,
+                                  uint32_t transition_ms)
+{
+    LIGHT_PARAM_CHECK(light);
+    LIGHT_PARAM_CHECK(hue <= 360);
+    LIGHT_PARAM_CHECK(saturation <= 100);
+    LIGHT_PARAM_CHECK(value <= 100);
+
+    light_cmd_t cmd = {
+        .hue        = hue,
+        .saturation = saturation,
+        .value      = value,
+        .on         = true,
+        .mode       = MODE_HSV,
+    };
+
+    return light_cmd_post_ex(light, &cmd, LIGHT_CMD_HSV | LIGHT_CMD_SWITCH | LIGHT_CMD_MODE, transition_ms);
+}
+
+esp_err_t light_handle_set_hue(light_handle_t light, uint16_t hue)
+{
+    return light_handle_set_hue_ex(light, hue, LIGHT_TRANSITION_DEFAULT);
+}
+
+esp_err_t light_handle_set_hue_ex(light_handle_t light, uint16_t hue, uint32_t transition_ms)
+{
+    LIGHT_PARAM_CHECK(light);
+    LIGHT_PARAM_CHECK(hue <= 360);
+
+    light_cmd_t cmd = {
+        .hue  = hue,
+        .on   = true,
+        .mode = MODE_HSV,
+    };
+
+    return light_cmd_post_ex(light, &cmd, LIGHT_CMD_HUE | LIGHT_CMD_SWITCH | LIGHT_CMD_MODE, transition_ms);
+}
+
+esp_err_t light_handle_set_saturation(light_handle_t light, uint8_t saturation)
+{
+    return light_handle_set_saturation_ex(light, saturation, LIGHT_TRANSITION_DEFAULT);
+}
+
+esp_err_t light_handle_set_saturation_ex(light_handle_t light, uint8_t saturation, uint32_t transition_ms)
+{
+    LIGHT_PARAM_CHECK(light);
+    LIGHT_PARAM_CHECK(saturation <= 100);
+
+    light_cmd_t cmd = {
+        .saturation = saturation,
+        .on         = true,
+        .mode       = MODE_HSV,
+    };
+
+    return light_cmd_post_ex(light, &cmd, LIGHT_CMD_SATURATION | LIGHT_CMD_SWITCH | LIGHT_CMD_MODE, transition_ms);
+}
+
+esp_err_t light_handle_set_value(light_handle_t light, uint8_t value)
+{
+    return light_handle_set_value_ex(light, value, LIGHT_TRANSITION_DEFAULT);
+}
+
+esp_err_t light_handle_set_value_ex(light_handle_t light, uint8_t value, uint32_t transition_ms)
+{
+    LIGHT_PARAM_CHECK(light);
+    LIGHT_PARAM_CHECK(value <= 100);
+
+    light_cmd_t cmd = {
+        .value = value,
+        .on    = true,
+        .mode  = MODE_HSV,
+    };
+
+    return light_cmd_post_ex(light, &cmd, LIGHT_CMD_VALUE | LIGHT_CMD_SWITCH | LIGHT_CMD_MODE, transition_ms);
+}
+
+esp_err_t light_handle_get_hsv(light_handle_t light, uint16_t *hue, uint8_t *saturation, uint8_t *value)
+{
+    LIGHT_PARAM_CHECK(light);
+    LIGHT_PARAM_CHECK(hue);
+    LIGHT_PARAM_CHECK(saturation);
+    LIGHT_PARAM_CHECK(value);
+
+    light_status_t status = light_status_get(light);
+
+    *hue        = status.hue;
+    *saturation = status.saturation;
+    *value      = status.value;
+
+    return ESP_OK;
+}
+
+uint16_t light_handle_get_hue(light_handle_t light)
+{
+    return light ? light_status_get(light).hue : 0;
+}
+
+uint8_t light_handle_get_saturation(light_handle_t light)
+{
+    return light ? light_status_get(light).saturation : 0;
+}
+
+uint8_t light_handle_get_value(light_handle_t light)
+{
+    return light ? light_status_get(light).value : 0;
+}
+
+uint8_t light_handle_get_mode(light_handle_t light)
+{
+    return light ? light_status_get(light).mode : MODE_NONE;
+}
+
+esp_err_t light_handle_set_ctb(light_handle_t light, uint8_t color_temperature, uint8_t brightness)
+{
+    return light_handle_set_ctb_ex(light, color_temperature, brightness, LIGHT_TRANSITION_DEFAULT);
+}
+
+esp_err_t light_handle_set_ctb_ex(light_handle_t light, uint8_t color_temperature, uint8_t brightness,
+                                  uint32_t transition_ms)
+{
+    LIGHT_PARAM_CHECK(light);
+    LIGHT_PARAM_CHECK(brightness <= 100);
+    LIGHT_PARAM_CHECK(color_temperature <= 100);
+
+    light_cmd_t cmd = {
+        .color_temperature = color_temperature,
+        .kelvin            = 0,
+        .brightness        = brightness,
+        .on                = true,
+        .mode              = MODE_CTB,
+    };
+
+    return light_cmd_post_ex(light, &cmd, LIGHT_CMD_CTB | LIGHT_CMD_KELVIN | LIGHT_CMD_SWITCH | LIGHT_CMD_MODE, transition_ms);
+}
+
+esp_err_t light_handle_set_cct(light_handle_t light, uint16_t kelvin, uint8_t brightness)
+{
+    return light_handle_set_cct_ex(light, kelvin, brightness, LIGHT_TRANSITION_DEFAULT);
+}
+
+esp_err_t light_handle_set_cct_ex(light_handle_t light, uint16_t kelvin, uint8_t brightness, uint32_t transition_ms)
+{
+    uint16_t kelvin_min = 0;
+    uint16_t kelvin_max = 0;
+
+    LIGHT_PARAM_CHECK(light);
+    LIGHT_PARAM_CHECK(brightness <= 100);
+
+    light_color_kelvin_range(&kelvin_min, &kelvin_max);
+    kelvin = MIN(MAX(kelvin, kelvin_min), kelvin_max);
+
+    light_cmd_t cmd = {
+        .color_temperature = light_color_q16_to_percent(light_color_kelvin_to_q16(kelvin)),
+        .kelvin            = kelvin,
+        .brightness        = brightness,
+        .on                = true,
+        .mode              = MODE_CTB,
+    };
+
+    return light_cmd_post_ex(light, &cmd, LIGHT_CMD_CTB | LIGHT_CMD_KELVIN | LIGHT_CMD_SWITCH | LIGHT_CMD_MODE, transition_ms);
+}
+
+esp_err_t light_handle_set_kelvin(light_handle_t light, uint16_t kelvin)
+{
+    return light_handle_set_kelvin_ex(light, kelvin, LIGHT_TRANSITION_DEFAULT);
+}
+
+esp_err_t light_handle_set_kelvin_ex(light_handle_t light, uint16_t kelvin, uint32_t transition_ms)
+{
+    uint16_t kelvin_min = 0;
+    uint16_t kelvin_max = 0;
+
+    LIGHT_PARAM_CHECK(light);
+
+    light_color_kelvin_range(&kelvin_min, &kelvin_max);
+    kelvin = MIN(MAX(kelvin, kelvin_min), kelvin_max);
+
+    light_cmd_t cmd = {
+        .color_temperature = light_color_q16_to_percent(light_color_kelvin_to_q16(kelvin)),
+        .kelvin            = kelvin,
+        .on                = true,
+        .mode              = MODE_CTB,
+    };
+
+    return light_cmd_post_ex(light, &cmd, LIGHT_CMD_COLOR_TEMPERATURE | LIGHT_CMD_KELVIN | LIGHT_CMD_SWITCH | LIGHT_CMD_MODE,
+                             transition_ms);
+}
+
+esp_err_t light_handle_set_color_temperature(light_handle_t light, uint8_t color_temperature)
+{
+    return light_handle_set_color_temperature_ex(light, color_temperature, LIGHT_TRANSITION_DEFAULT);
+}
+
+esp_err_t light_handle_set_color_temperature_ex(light_handle_t light, uint8_t color_temperature, uint32_t transition_ms)
+{
+    LIGHT_PARAM_CHECK(light);
+    LIGHT_PARAM_CHECK(color_temperature <= 100);
+
+    light_cmd_t cmd = {
+        .color_temperature = color_temperature,
+        .kelvin            = 0,
+        .on                = true,
+        .mode              = MODE_CTB,
+    };
+
+    return light_cmd_post_ex(light, &cmd, LIGHT_CMD_COLOR_TEMPERATURE | LIGHT_CMD_KELVIN | LIGHT_CMD_SWITCH | LIGHT_CMD_MODE, transition_ms);
+}
+
+esp_err_t light_handle_set_brightness(light_handle_t light, uint8_t brightness)
+{
+    return light_handle_set_brightness_ex(light, brightness, LIGHT_TRANSITION_DEFAULT);
+}
+
+esp_err_t light_handle_set_brightness_ex(light_handle_t light, uint8_t brightness, uint32_t transition_ms)
+{
+    LIGHT_PARAM_CHECK(light);
+    LIGHT_PARAM_CHECK(brightness <= 100);
+
+    light_cmd_t cmd = {
+        .brightness = brightness,
+        .on         = true,
+        .mode       = MODE_CTB,
+    };
+
+    return light_cmd_post_ex(light, &cmd, LIGHT_CMD_BRIGHTNESS | LIGHT_CMD_SWITCH | LIGHT_CMD_MODE, transition_ms);
+}
+
+esp_err_t light_handle_get_ctb(light_handle_t light, uint8_t *color_temperature, uint8_t *brightness)
+{
+    LIGHT_PARAM_CHECK(light);
+    LIGHT_PARAM_CHECK(color_temperature);
+    LIGHT_PARAM_CHECK(brightness);
+
+    light_status_t status = light_status_get(light);
+
+    *brightness        = status.brightness;
+    *color_temperature = status.color_temperature;
+
+    return ESP_OK;
+}
+
+uint8_t light_handle_get_color_temperature(light_handle_t light)
+{
+    return light ? light_status_get(light).color_temperature : 0;
+}
+
+uint8_t light_handle_get_brightness(light_handle_t light)
+{
+    return light ? light_status_get(light).brightness : 0;
+}
+
+uint16_t light_handle_get_cct(light_handle_t light)
+{
+    if (!light) {
+        return 0;
+    }
+
+    light_status_t status = light_status_get(light);
+
+    return status.kelvin ? status.kelvin : light_color_q16_to_kelvin(light_color_percent_to_q16(status.color_temperature));
+}
+
+esp_err_t light_handle_get_cct_range(light_handle_t light, uint16_t *kelvin_min, uint16_t *kelvin_max)
+{
+    LIGHT_PARAM_CHECK(light);
+    LIGHT_PARAM_CHECK(kelvin_min);
+    LIGHT_PARAM_CHECK(kelvin_max);
+
+    light_color_kelvin_range(kelvin_min, kelvin_max);
+
+    return ESP_OK;
+}
+
+esp_err_t light_handle_set_switch(light_handle_t light, bool on)
+{
+    return light_handle_set_switch_ex(light, on, LIGHT_TRANSITION_DEFAULT);
+}
+
+esp_err_t light_handle_set_switch_ex(light_handle_t light, bool on, uint32_t transition_ms)
+{
+    LIGHT_PARAM_CHECK(light);
+
+    light_cmd_t cmd = {
+        .on = on,
+    };
+
+    return light_cmd_post_ex(light, &cmd, LIGHT_CMD_SWITCH, transition_ms);
+}
+
+bool light_handle_get_switch(light_handle_t light)
+{
+    return light ? light_status_get(light).on : false;
+}
+
+esp_err_t light_handle_breath_start(light_handle_t light, uint8_t red, uint8_t green, uint8_t blue)
+{
+    esp_err_t ret = ESP_OK;
+
+    LIGHT_PARAM_CHECK(light);
+
+    light_status_lock();
+
+    ret = light_start_blink(light, CHANNEL_ID_RED,
+                            red, light->status.blink_period_ms, true);
+
+    if (ret >= 0) {
+        ret = light_start_blink(light, CHANNEL_ID_GREEN,
+                                green, light->status.blink_period_ms, true);
+    }
+
+    if (ret >= 0) {
+        ret = light_start_blink(light, CHANNEL_ID_BLUE,
+                                blue, light->status.blink_period_ms, true);
+    }
+
+    if (ret >= 0) {
+        light->blink_flag = true;
+    }
+
+    light_status_unlock();
+
+    LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_start_blink, ret: %d", ret);
+
+    return ESP_OK;
+}
+
+esp_err_t light_handle_breath_stop(light_handle_t light)
+{
+    esp_err_t ret = ESP_OK;
+
+    LIGHT_PARAM_CHECK(light);
+
+    light_status_lock();
+
+    if (light->blink_flag == false) {
+        light_status_unlock();
+        return ESP_OK;
+    }
+
+    ret = light_stop_blink(light, CHANNEL_ID_RED);
+
+    if (ret >= 0) {
+        ret = light_stop_blink(light, CHANNEL_ID_GREEN);
+    }
+
+    if (ret >= 0) {
+        ret = light_stop_blink(light, CHANNEL_ID_BLUE);
+    }
+
+    if (ret >= 0) {
+        light->blink_flag = false;
+    }
+
+    light_status_unlock();
+
+    LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_stop_blink, ret: %d", ret);
+
+    /**< Output the status of the light again, through the light task */
+    light_handle_set_switch(light, true);
+
+    return ESP_OK;
+}
+
+static esp_err_t light_fade_brightness(light_handle_t light, uint8_t brightness)
+{
+    esp_err_t ret = ESP_OK;
+    light->fade_mode = MODE_ON;
+    uint32_t fade_period_ms = 0;
+
+    if (light->status.mode == MODE_HSV) {
+        uint16_t red   = 0;
+        uint16_t green = 0;
+        uint16_t blue  = 0;
+        uint16_t values[CHANNEL_ID_MAX] = {0};
+
+        light_driver_hsv2rgb(light->status.hue, light->status.saturation, light->status.value, &red, &green, &blue);
+
+        if (brightness != 0) {
+            ret = light_get_rgb(light, &red, &green, &blue);
+            LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_get_channel, ret: %d", ret);
+
+            uint16_t max_color      = MAX(MAX(red, green), blue);
+            uint16_t change_value   = light_color_percent_to_q16(brightness) - max_color;
+            fade_period_ms = LIGHT_FADE_PERIOD_MAX_MS * change_value / LIGHT_COLOR_MAX;
+        } else {
+            fade_period_ms = LIGHT_FADE_PERIOD_MAX_MS * MAX(MAX(red, green), blue) / LIGHT_COLOR_MAX;
+            red   = 0;
+        }
+
+        light->status.value = brightness;
+        uint32_t channel_mask = light_hsv_to_channels(light, light->status.hue, light->status.saturation,
+                                                      light->status.value, values);
+
+        ret = light_set_channels(light, channel_mask, values, fade_period_ms, IOT_LED_EASE_LINEAR);
+        LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channels, ret: %d", ret);
+
+    } else if (light->status.mode == MODE_CTB) {
+        uint16_t values[CHANNEL_ID_MAX] = {0};
+        fade_period_ms = LIGHT_FADE_PERIOD_MAX_MS * light->status.brightness / 100;
+
+        if (brightness != 0) {
+            uint8_t change_value = brightness - light->status.brightness;
+            fade_period_ms = LIGHT_FADE_PERIOD_MAX_MS * change_value / 100;
+        }
+
+        light_driver_cct2cw(light->status.color_temperature, light->status.kelvin, brightness,
+                            &values[CHANNEL_ID_WARM], &values[CHANNEL_ID_COLD]);
+
+        ret = light_set_channels(light, CHANNEL_MASK_CW, values, fade_period_ms, IOT_LED_EASE_LINEAR);
+        LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channels, ret: %d", ret);
+
+        light->status.brightness = brightness;
+    }
+
+    ret = light_status_store(light);
+    LIGHT_ERROR_CHECK(ret < 0, ret, "light_status_store, ret: %d", ret);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Sweep the hue along the shorter arc of the colour circle, 60 degrees per LIGHT_FADE_PERIOD_MAX_MS / 3
+ */
+static esp_err_t light_fade_hue(light_handle_t light, uint16_t hue)
+{
+    esp_err_t ret = ESP_OK;
+    int arc = abs((int)hue - (int)light->status.hue) % 360;
+    light->fade_mode = MODE_HSV;
+
+    arc = (arc > 180) ? 360 - arc : arc;
+
+    if (light->status.mode != MODE_HSV && !light_white_mix_active(light)) {
+        const uint16_t values[CHANNEL_ID_MAX] = {0};
+
+        ret = light_set_channels(light, CHANNEL_MASK_CW, values, 0, IOT_LED_EASE_LINEAR);
+        LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channels, ret: %d", ret);
+    }
+
+    light->status.mode  = MODE_HSV;
+    light->status.value = (light->status.value == 0) ? 100 : light->status.value;
+    light->status.hue   = hue;
+
+    ret = light_set_hsv_channels(light, light->status.hue, light->status.saturation, light->status.value,
+                                 LIGHT_FADE_PERIOD_MAX_MS * arc / 180, IOT_LED_EASE_LINEAR);
+    LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_hsv_channels, ret: %d", ret);
+
+    ret = light_status_store(light);
+    LIGHT_ERROR_CHECK(ret < 0, ret, "light_status_store, ret: %d", ret);
+
+    return ESP_OK;
+}
+
+static esp_err_t light_fade_warm(light_handle_t light, uint8_t color_temperature)
+{
+    esp_err_t ret = ESP_OK;
+    uint16_t values[CHANNEL_ID_MAX] = {0};
+    light->fade_mode = MODE_CTB;
+
+    if (light->status.mode != MODE_CTB) {
+        ret = light_set_channels(light, CHANNEL_MASK_RGB, values, light->status.fade_period_ms, IOT_LED_EASE_LINEAR);
+        LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channels, ret: %d", ret);
+    }
+
+    /**< A light set in Kelvin sweeps through the table, to the same place in mired */
+    uint16_t kelvin = light->status.kelvin ? light_color_q16_to_kelvin(light_color_percent_to_q16(color_temperature)) : 0;
+
+    light_driver_cct2cw(color_temperature, kelvin, light->status.brightness,
+                        &values[CHANNEL_ID_WARM], &values[CHANNEL_ID_COLD]);
+
+    ret = light_set_channels(light, CHANNEL_MASK_CW, values, LIGHT_FADE_PERIOD_MAX_MS, IOT_LED_EASE_LINEAR);
+    LIGHT_ERROR_CHECK(ret < 0, ret, "iot_led_set_channels, ret: %d", ret);
+
+    light->status.mode              = MODE_CTB;
+    light->status.color_temperature = color_temperature;
+    light->status.kelvin            = kelvin;
+    ret = light_status_store(light);
+    LIGHT_ERROR_CHECK(ret < 0, ret, "light_status_store, ret: %d", ret);
+
+    return ESP_OK;
+}
+
+static esp_err_t light_fade_stop(light_handle_t light)
+{
+    esp_err_t ret = ESP_OK;
+
+    if (light->status.mode != MODE_CTB) {
+        uint16_t hue       = 0;
+        uint8_t saturation = 0;
+        uint8_t value      = 0;
+
+        ret = light_stop_blink(light, CHANNEL_ID_RED);
+        LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_stop_blink, ret: %d", ret);
+
+        ret = light_stop_blink(light, CHANNEL_ID_GREEN);
+        LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_stop_blink, ret: %d", ret);
+
+        ret = light_stop_blink(light, CHANNEL_ID_BLUE);
+        LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_stop_blink, ret: %d", ret);
+
+        uint16_t red, green, blue;
+
+        ret = light_get_rgb(light, &red, &green, &blue);
+        LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_get_channel, ret: %d", ret);
+
+        light_driver_rgb2hsv(red, green, blue, &hue, &saturation, &value);
+
+        light->status.hue   = (light->fade_mode == MODE_HSV) ? hue : light->status.hue;
+        light->status.value = (light->fade_mode == MODE_OFF || light->fade_mode == MODE_ON) ? value : light->status.value;
+    } else {
+        uint8_t color_temperature = 0;
+        uint8_t brightness        = 0;
+
+        ret = light_stop_blink(light, CHANNEL_ID_COLD);
+        LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_stop_blink, ret: %d", ret);
+
+        ret = light_stop_blink(light, CHANNEL_ID_WARM);
+        LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_stop_blink, ret: %d", ret);
+
+        uint16_t warm, cold;
+
+        ret = light_get_channel(light, CHANNEL_ID_WARM, &warm);
+        LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_get_channel, ret: %d", ret);
+
+        ret = light_get_channel(light, CHANNEL_ID_COLD, &cold);
+        LIGHT_ERROR_CHECK(ret < 0, ESP_FAIL, "iot_led_get_channel, ret: %d", ret);
+
+        uint16_t kelvin = light->status.kelvin;
+
+        light_driver_cw2cct(warm, cold, &color_temperature, &kelvin, &brightness);
+
+        light->status.brightness        = (light->fade_mode == MODE_OFF || light->fade_mode == MODE_ON) ? brightness : light->status.brightness;
+        light->status.color_temperature = (light->fade_mode == MODE_CTB) ? color_temperature : light->status.color_temperature;
+        light->status.kelvin            = (light->fade_mode == MODE_CTB) ? kelvin : light->status.kelvin;
+    }
+
+    ret = light_status_store(light);
+    LIGHT_ERROR_CHECK(ret < 0, ret, "light_status_store, ret: %d", ret);
+
+    light->fade_mode = MODE_NONE;
+    return ESP_OK;
+}
+
+/**
+ * @brief The fade operations run in the caller's context, serialised with the light task
+ */
+esp_err_t light_handle_fade_brightness(light_handle_t light, uint8_t brightness)
+{
+    LIGHT_PARAM_CHECK(light);
+
+    light_status_lock();
+    esp_err_t ret = light_fade_brightness(light, brightness);
+    light_status_unlock();
+
+    return ret;
+}
+
+esp_err_t light_handle_fade_hue(light_handle_t light, uint16_t hue)
+{
+    LIGHT_PARAM_CHECK(light);
+
+    light_status_lock();
+    esp_err_t ret = light_fade_hue(light, hue);
+    light_status_unlock();
+
+    return ret;
+}
+
+esp_err_t light_handle_fade_warm(light_handle_t light, uint8_t color_temperature)
+{
+    LIGHT_PARAM_CHECK(light);
+
+    light_status_lock();
+    esp_err_t ret = light_fade_warm(light, color_temperature);
+    light_status_unlock();
+
+    return ret;
+}
+
+esp_err_t light_handle_fade_stop(light_handle_t light)
+{
+    LIGHT_PARAM_CHECK(light);
+
+    light_status_lock();
+    esp_err_t ret = light_fade_stop(light);
+    light_status_unlock();
+
+    return ret;
+}
+
+/**
+ * @brief Keyframes of the built-in effects: {red, green, blue, warm, cold}, jitter, easing, duration_ms
+ */
+static const iot_led_keyframe_t g_candle_keyframes[] = {
+    {{255, 96, 8, 200, 0}, 30, IOT_LED_EASE_LINEAR, 120},
+    {{230, 80, 5, 170, 0}, 40, IOT_LED_EASE_SMOOTH, 90},
+    {{255, 100, 10, 210, 0}, 25, IOT_LED_EASE_LINEAR, 150},
+    {{200, 70, 4, 150, 0}, 40, IOT_LED_EASE_LINEAR, 80},
+    {{245, 90, 8, 190, 0}, 30, IOT_LED_EASE_SMOOTH, 200},
+    {{220, 78, 6, 165, 0}, 35, IOT_LED_EASE_LINEAR, 110},
+};
+
+static const iot_led_keyframe_t g_sunrise_keyframes[] = {
+    {{0, 0, 0, 0, 0}, 0, IOT_LED_EASE_STEP, 0},
+    {{40, 2, 0, 0, 0}, 0, IOT_LED_EASE_SMOOTH, 120 * 1000},
+    {{180, 60, 0, 60, 0}, 0, IOT_LED_EASE_LINEAR, 180 * 1000},
+    {{255, 160, 60, 200, 40}, 0, IOT_LED_EASE_LINEAR, 180 * 1000},
+    {{255, 230, 200, 255, 200}, 0, IOT_LED_EASE_SMOOTH, 120 * 1000},
+};
+
+static const iot_led_keyframe_t g_alert_keyframes[] = {
+    {{255, 0, 0, 0, 0}, 0, IOT_LED_EASE_STEP, 150},
+    {{0, 0, 0, 0, 0}, 0, IOT_LED_EASE_STEP, 100},
+    {{255, 0, 0, 0, 0}, 0, IOT_LED_EASE_STEP, 150},
+    {{0, 0, 0, 0, 0}, 0, IOT_LED_EASE_STEP, 600},
+};
+
+static const iot_led_program_t g_light_effects[LIGHT_EFFECT_MAX] = {
+    [LIGHT_EFFECT_CANDLE]  = {g_candle_keyframes, sizeof(g_candle_keyframes) / sizeof(iot_led_keyframe_t), 0, 0},
+    [LIGHT_EFFECT_SUNRISE] = {g_sunrise_keyframes, sizeof(g_sunrise_keyframes) / sizeof(iot_led_keyframe_t), 0, 1},
+    [LIGHT_EFFECT_ALERT]   = {g_alert_keyframes, sizeof(g_alert_keyframes) / sizeof(iot_led_keyframe_t), 0, 0},
+};
+
+esp_err_t light_handle_program_start(light_handle_t light, const iot_led_program_t *program)
+{
+    esp_err_t ret = ESP_OK;
+    ledc_channel_t channels[CHANNEL_ID_MAX] = {0};
+    int ids[CHANNEL_ID_MAX] = {0};
+    uint8_t channel_num = 0;
+
+    LIGHT_PARAM_CHECK(light);
+    LIGHT_PARAM_CHECK(program && program->keyframes && program->keyframe_num > 0);
+
+    /**< Keep only the values of the connected colours, iot_led copies the result again */
+    iot_led_keyframe_t *keyframes = calloc(program->keyframe_num, sizeof(iot_led_keyframe_t));
+    LIGHT_ERROR_CHECK(keyframes == NULL, ESP_ERR_NO_MEM, "Remap %d keyframes", program->keyframe_num);
+
+    /**< The channels and the power budget are read and the program started as one step */
+    light_status_lock();
+
+    for (int id = 0; id < CHANNEL_ID_MAX; id++) {
+        if (light->channel[id] != CHANNEL_NONE) {
+            channels[channel_num] = light->channel[id];
+            ids[channel_num++]    = id;
+        }
+    }
+
+    for (int i = 0; i < program->keyframe_num; i++) {
+        uint16_t values[CHANNEL_ID_MAX] = {0};
+
+        for (int id = 0; id < CHANNEL_ID_MAX; id++) {
+            values[id] = light_color_u8_to_q16(program->keyframes[i].values[id]);
+        }
+
+        light_power_limit(light, CHANNEL_MASK_ALL, values);
+        keyframes[i] = program->keyframes[i];
+
+        for (int j = 0; j < channel_num; j++) {
+            keyframes[i].values[j] = light_color_q16_to_u8(values[ids[j]]);
+        }
+    }
+
+    iot_led_program_t remapped = *program;
+    remapped.keyframes = keyframes;
+
+    ret = iot_led_start_program(channels, channel_num, &remapped);
+
+    light_status_unlock();
+
+    free(keyframes);
+    LIGHT_ERROR_CHECK(ret != ESP_OK, ret, "iot_led_start_program, ret: %d", ret);
+
+    return ESP_OK;
+}
+
+esp_err_t light_handle_effect_start(light_handle_t light, light_effect_t effect)
+{
+    LIGHT_PARAM_CHECK(effect < LIGHT_EFFECT_MAX);
+
+    return light_handle_program_start(light, g_light_effects + effect);
+}
+
+esp_err_t light_handle_effect_stop(light_handle_t light)
+{
+    esp_err_t ret = ESP_OK;
+    uint32_t channel_mask = 0;
+
+    LIGHT_PARAM_CHECK(light);
+
+    light_status_lock();
+
+    for (int id = 0; id < CHANNEL_ID_MAX; id++) {
+        if (light->channel[id] != CHANNEL_NONE) {
+            channel_mask |= BIT(light->channel[id]);
+        }
+    }
+
+    ret = iot_led_stop_program(channel_mask);
+    bool on = light->status.on;
+
+    light_status_unlock();
+
+    LIGHT_ERROR_CHECK(ret != ESP_OK, ret, "iot_led_stop_program, ret: %d", ret);
+
+    /**< Output the status of the light again, through the light task */
+    return light_handle_set_switch(light, on);
+}
+
+/**
+ * @brief The light_driver_* functions operate on the light created by light_driver_init()
+ */
+esp_err_t light_driver_init(light_driver_config_t *config)
+{
+    LIGHT_ERROR_CHECK(g_light_default != NULL, ESP_ERR_INVALID_STATE, "light_driver_init() has been called");
+
+    return light_handle_create(config, &g_light_default);
+}
+
+esp_err_t light_driver_deinit()
+{
+    LIGHT_ERROR_CHECK(g_light_default == NULL, ESP_ERR_INVALID_STATE, "light_driver_init() must be called first");
+
+    return light_handle_delete(g_light_default);
+}
+
+light_handle_t light_driver_get_handle()
+{
+    return g_light_default;
+}
+
+esp_err_t light_driver_get_store_stats(light_driver_store_stats_t *stats)
+{
+    return light_handle_get_store_stats(g_light_default, stats);
+}
+
+esp_err_t light_driver_get_isr_stats(iot_led_isr_stats_t *stats, bool reset)
+{
+    return iot_led_get_isr_stats(stats, reset);
+}
+
+esp_err_t light_driver_add_observer(light_driver_observer_t cb, void *arg)
+{
+    return light_handle_add_observer(g_light_default, cb, arg);
+}
+
+esp_err_t light_driver_remove_observer(light_driver_observer_t cb, void *arg)
+{
+    return light_handle_remove_observer(g_light_default, cb, arg);
+}
+
+esp_err_t light_driver_set_follow(bool enable, uint32_t max_rate)
+{
+    return light_handle_set_follow(g_light_default, enable, max_rate);
+}
+
+esp_err_t light_driver_set_power_config(const light_driver_power_config_t *config)
+{
+    return light_handle_set_power_config(g_light_default, config);
+}
+
+esp_err_t light_driver_set_temperature(int16_t temperature_c)
+{
+    return light_handle_set_temperature(g_light_default, temperature_c);
+}
+
+esp_err_t light_driver_get_power(uint32_t *power_mw, uint32_t *budget_mw)
+{
+    return light_handle_get_power(g_light_default, power_mw, budget_mw);
+}
+
+esp_err_t light_driver_config(uint32_t fade_period_ms, uint32_t blink_period_ms)
+{
+    return light_handle_config(g_light_default, fade_period_ms, blink_period_ms);
+}
+
+esp_err_t light_driver_set_easing(iot_led_easing_t easing)
+{
+    return light_handle_set_easing(g_light_default, easing);
+}
+
+esp_err_t light_driver_set_white_mix(bool enable)
+{
+    return light_handle_set_white_mix(g_light_default, enable);
+}
+
+esp_err_t light_driver_set_rgb(uint8_t red, uint8_t green, uint8_t blue)
+{
+    return light_handle_set_rgb(g_light_default, red, green, blue);
+}
+
+esp_err_t light_driver_set_hsv(uint16_t hue, uint8_t saturation, uint8_t value)
+{
+    return light_handle_set_hsv(g_light_default, hue, saturation, value);
+}
+
+esp_err_t light_driver_set_hsv_ex(uint16_t hue, uint8_t saturation, uint8_t value, uint32_t transition_ms)
+{
+    return light_handle_set_hsv_ex(g_light_default, hue, saturation, value, transition_ms);
+}
+
+esp_err_t light_driver_set_hue(uint16_t hue)
+{
+    return light_handle_set_hue(g_light_default, hue);
+}
+
+esp_err_t light_driver_set_hue_ex(uint16_t hue, uint32_t transition_ms)
+{
+    return light_handle_set_hue_ex(g_light_default, hue, transition_ms);
+}
+
+esp_err_t light_driver_set_saturation(uint8_t saturation)
+{
+    return light_handle_set_saturation(g_light_default, saturation);
+}
+
+esp_err_t light_driver_set_saturation_ex(uint8_t saturation, uint32_t transition_ms)
+{
+    return light_handle_set_saturation_ex(g_light_default, saturation, transition_ms);
+}
+
+esp_err_t light_driver_set_value(uint8_t value)
+{
+    return light_handle_set_value(g_light_default, value);
+}
+
+esp_err_t light_driver_set_value_ex(uint8_t value, uint32_t transition_ms)
+{
+    return light_handle_set_value_ex(g_light_default, value, transition_ms);
+}
+
+esp_err_t light_driver_get_hsv(uint16_t *hue, uint8_t *saturation, uint8_t *value)
+{
+    return light_handle_get_hsv(g_light_default, hue, saturation, value);
+}
+
+uint16_t light_driver_get_hue()
+{
+    return light_handle_get_hue(g_light_default);
+}
+
+uint8_t light_driver_get_saturation()
+{
+    return light_handle_get_saturation(g_light_default);
+}
+
+uint8_t light_driver_get_value()
+{
+    return light_handle_get_value(g_light_default);
+}
+
+uint8_t light_driver_get_mode()
+{
+    return light_handle_get_mode(g_light_default);
+}
+
+esp_err_t light_driver_set_ctb(uint8_t color_temperature, uint8_t brightness)
+{
+    return light_handle_set_ctb(g_light_default, color_temperature, brightness);
+}
+
+esp_err_t light_driver_set_ctb_ex(uint8_t color_temperature, uint8_t brightness, uint32_t transition_ms)
+{
+    return light_handle_set_ctb_ex(g_light_default, color_temperature, brightness, transition_ms);
+}
+
+esp_err_t light_driver_set_cct(uint16_t kelvin, uint8_t brightness)
+{
+    return light_handle_set_cct(g_light_default, kelvin, brightness);
+}
+
+esp_err_t light_driver_set_cct_ex(uint16_t kelvin, uint8_t brightness, uint32_t transition_ms)
+{
+    return light_handle_set_cct_ex(g_light_default, kelvin, brightness, transition_ms);
+}
+
+esp_err_t light_driver_set_kelvin(uint16_t kelvin)
+{
+    return light_handle_set_kelvin(g_light_default, kelvin);
+}
+
+esp_err_t light_driver_set_kelvin_ex(uint16_t kelvin, uint32_t transition_ms)
+{
+    return light_handle_set_kelvin_ex(g_light_default, kelvin, transition_ms);
+}
+
+esp_err_t light_driver_set_color_temperature(uint8_t color_temperature)
+{
+    return light_handle_set_color_temperature(g_light_default, color_temperature);
+}
+
+esp_err_t light_driver_set_color_temperature_ex(uint8_t color_temperature, uint32_t transition_ms)
+{
+    return light_handle_set_color_temperature_ex(g_light_default, color_temperature, transition_ms);
+}
+
+esp_err_t light_driver_set_brightness(uint8_t brightness)
+{
+    return light_handle_set_brightness(g_light_default, brightness);
+}
+
+esp_err_t light_driver_set_brightness_ex(uint8_t brightness, uint32_t transition_ms)
+{
+    return light_handle_set_brightness_ex(g_light_default, brightness, transition_ms);
+}
+
+esp_err_t light_driver_get_ctb(uint8_t *color_temperature, uint8_t *brightness)
+{
+    return light_handle_get_ctb(g_light_default, color_temperature, brightness);
+}
+
+uint8_t light_driver_get_color_temperature()
+{
+    return light_handle_get_color_temperature(g_light_default);
+}
+
+uint8_t light_driver_get_brightness()
+{
+    return light_handle_get_brightness(g_light_default);
+}
+
+uint16_t light_driver_get_cct()
+{
+    return light_handle_get_cct(g_light_default);
+}
+
+esp_err_t light_driver_get_cct_range(uint16_t *kelvin_min, uint16_t *kelvin_max)
+{
+    return light_handle_get_cct_range(g_light_default, kelvin_min, kelvin_max);
+}
+
+esp_err_t light_driver_set_switch(bool on)
+{
+    return light_handle_set_switch(g_light_default, on);
+}
+
+esp_err_t light_driver_set_switch_ex(bool on, uint32_t transition_ms)
+{
+    return light_handle_set_switch_ex(g_light_default, on, transition_ms);
+}
+
+bool light_driver_get_switch()
+{
+    return light_handle_get_switch(g_light_default);
+}
+
+esp_err_t light_driver_breath_start(uint8_t red, uint8_t green, uint8_t blue)
+{
+    return light_handle_breath_start(g_light_default, red, green, blue);
+}
+
+esp_err_t light_driver_breath_stop()
+{
+    return light_handle_breath_stop(g_light_default);
+}
+
+esp_err_t light_driver_fade_brightness(uint8_t brightness)
+{
+    return light_handle_fade_brightness(g_light_default, brightness);
+}
+
+esp_err_t light_driver_fade_hue(uint16_t hue)
+{
+    return light_handle_fade_hue(g_light_default, hue);
+}
+
+esp_err_t light_driver_fade_warm(uint8_t color_temperature)
+{
+    return light_handle_fade_warm(g_light_default, color_temperature);
+}
+
+esp_err_t light_driver_fade_stop()
+{
+    return light_handle_fade_stop(g_light_default);
+}
+
+esp_err_t light_driver_effect_start(light_effect_t effect)
+{
+    return light_handle_effect_start(g_light_default, effect);
+}
+
+esp_err_t light_driver_program_start(const iot_led_program_t *program)
+{
+    return light_handle_program_start(g_light_default, program);
+}
+
+esp_err_t light_driver_effect_stop()
+{
+    return light_handle_effect_stop(g_light_default);
+}
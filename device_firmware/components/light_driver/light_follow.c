@@ -0,0 +1,138 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+
+#include "light_follow.h"
+
+#define LIGHT_FOLLOW_HUE_RANGE (360)    /**< Hue wraps around at 360 degrees */
+#define LIGHT_FOLLOW_RANGE     (100)    /**< Range of the other fields, in percent */
+
+/**
+ * @brief Signed change of a field, hue moves along the shorter arc
+ */
+static int light_follow_delta(int field, int to, int from)
+{
+    int delta = to - from;
+
+    if (field == LIGHT_FOLLOW_HUE) {
+        delta = ((delta % LIGHT_FOLLOW_HUE_RANGE) + LIGHT_FOLLOW_HUE_RANGE + LIGHT_FOLLOW_HUE_RANGE / 2)
+                % LIGHT_FOLLOW_HUE_RANGE - LIGHT_FOLLOW_HUE_RANGE / 2;
+    }
+
+    return delta;
+}
+
+/**
+ * @brief Predict one field an interval ahead, from its smoothed rate
+ *
+ * The prediction is never further ahead than the last step, so a stream that
+ * stops overshoots by at most one step, which the settle takes back.
+ */
+static int light_follow_field(int field, int value, int last, int32_t *rate, uint32_t dt_ms, uint32_t interval_ms)
+{
+    int delta = light_follow_delta(field, value, last);
+
+    *rate = (*rate + delta * 256 * 1000 / (int)dt_ms) / 2;
+
+    int ahead = (int)((int64_t)*rate * (int)interval_ms / (256 * 1000));
+    ahead = MIN(MAX(ahead, -abs(delta)), abs(delta));
+
+    if (field == LIGHT_FOLLOW_HUE) {
+        return ((value + ahead) % LIGHT_FOLLOW_HUE_RANGE + LIGHT_FOLLOW_HUE_RANGE) % LIGHT_FOLLOW_HUE_RANGE;
+    }
+
+    return MIN(MAX(value + ahead, 0), LIGHT_FOLLOW_RANGE);
+}
+
+/**
+ * @brief Time to move from one point to the other at the largest rate, at least min_ms
+ */
+static uint32_t light_follow_slew(const light_follow_t *follow, const light_follow_point_t *from,
+                                  const light_follow_point_t *to, uint32_t min_ms)
+{
+    int distance = 0;
+
+    if (!follow->max_rate) {
+        return min_ms;
+    }
+
+    for (int i = 0; i < LIGHT_FOLLOW_FIELD_MAX; ++i) {
+        distance = MAX(distance, abs(light_follow_delta(i, to->field[i], from->field[i])));
+    }
+
+    return MAX(min_ms, distance * 1000 / follow->max_rate);
+}
+
+void light_follow_config(light_follow_t *follow, bool enable, uint32_t max_rate)
+{
+    follow->enable   = enable;
+    follow->max_rate = max_rate;
+    follow->last_us  = 0;
+    follow->active   = false;
+}
+
+bool light_follow_update(light_follow_t *follow, int64_t now_us, bool transition, bool continues,
+                         const light_follow_point_t *point, light_follow_point_t *output, uint32_t *fade_ms)
+{
+    uint32_t dt_ms = (now_us - follow->last_us) / 1000;
+
+    *output = *point;
+
+    if (!follow->enable) {
+        return false;
+    }
+
+    /**< An explicit transition always wins, it starts over from this command */
+    if (transition || !continues || !follow->last_us || dt_ms >= LIGHT_FOLLOW_TIMEOUT_MS) {
+        memset(follow->rate, 0, sizeof(follow->rate));
+        follow->interval_ms = LIGHT_FOLLOW_INTERVAL_MS;
+        follow->last_us     = now_us;
+        follow->last        = *point;
+        follow->target      = *point;
+        follow->active      = false;
+        return false;
+    }
+
+    dt_ms = MAX(dt_ms, LIGHT_FOLLOW_DT_MIN_MS);
+    follow->interval_ms = (follow->interval_ms * 3 + dt_ms) / 4;
+
+    for (int i = 0; i < LIGHT_FOLLOW_FIELD_MAX; ++i) {
+        output->field[i] = light_follow_field(i, point->field[i], follow->last.field[i],
+                                              &follow->rate[i], dt_ms, follow->interval_ms);
+    }
+
+    *fade_ms = light_follow_slew(follow, &follow->target, output, follow->interval_ms);
+
+    follow->last_us = now_us;
+    follow->last    = *point;
+    follow->target  = *output;
+    follow->active  = true;
+
+    return true;
+}
+
+bool light_follow_settle(light_follow_t *follow, const light_follow_point_t *point, uint32_t *fade_ms)
+{
+    if (!follow->enable || !follow->active) {
+        return false;
+    }
+
+    follow->active = false;
+    *fade_ms = light_follow_slew(follow, &follow->target, point, follow->interval_ms);
+
+    return true;
+}
@@ -0,0 +1,89 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __SIM_DRIVER_TIMER_H__
+#define __SIM_DRIVER_TIMER_H__
+
+#include "esp_err.h"
+#include "soc/timer_group_struct.h"
+
+/**
+ * @brief The subset of the ESP32-C3 timer group driver API that iot_led.c uses,
+ *        implemented on the simulated registers by ledc_sim.c
+ */
+typedef enum {
+    TIMER_GROUP_0,
+    TIMER_GROUP_1,
+    TIMER_GROUP_MAX,
+} timer_group_t;
+
+typedef enum {
+    TIMER_0,
+    TIMER_MAX,
+} timer_idx_t;
+
+typedef enum {
+    TIMER_COUNT_DOWN,
+    TIMER_COUNT_UP,
+} timer_count_dir_t;
+
+typedef enum {
+    TIMER_PAUSE,
+    TIMER_START,
+} timer_start_t;
+
+typedef enum {
+    TIMER_ALARM_DIS,
+    TIMER_ALARM_EN,
+} timer_alarm_t;
+
+typedef enum {
+    TIMER_INTR_LEVEL,
+} timer_intr_mode_t;
+
+typedef enum {
+    TIMER_SRC_CLK_APB,
+    TIMER_SRC_CLK_XTAL,
+} timer_src_clk_t;
+
+typedef struct {
+    timer_alarm_t alarm_en;
+    timer_start_t counter_en;
+    timer_intr_mode_t intr_type;
+    timer_count_dir_t counter_dir;
+    bool auto_reload;
+    uint32_t divider;
+    timer_src_clk_t clk_src;
+} timer_config_t;
+
+typedef void *intr_handle_t;
+typedef intr_handle_t timer_isr_handle_t;
+
+#define TIMER_BASE_CLK     (80 * 1000 * 1000)
+#define ESP_INTR_FLAG_IRAM BIT(10)
+
+esp_err_t timer_init(timer_group_t group_num, timer_idx_t timer_num, const timer_config_t *config);
+esp_err_t timer_set_counter_value(timer_group_t group_num, timer_idx_t timer_num, uint64_t load_val);
+esp_err_t timer_set_alarm_value(timer_group_t group_num, timer_idx_t timer_num, uint64_t alarm_value);
+esp_err_t timer_get_counter_value(timer_group_t group_num, timer_idx_t timer_num, uint64_t *timer_val);
+void timer_group_set_alarm_value_in_isr(timer_group_t group_num, timer_idx_t timer_num, uint64_t alarm_val);
+uint64_t timer_group_get_counter_value_in_isr(timer_group_t group_num, timer_idx_t timer_num);
+esp_err_t timer_enable_intr(timer_group_t group_num, timer_idx_t timer_num);
+esp_err_t timer_disable_intr(timer_group_t group_num, timer_idx_t timer_num);
+esp_err_t timer_isr_register(timer_group_t group_num, timer_idx_t timer_num, void (*fn)(void *),
+                             void *arg, int intr_alloc_flags, timer_isr_handle_t *handle);
+esp_err_t timer_start(timer_group_t group_num, timer_idx_t timer_num);
+esp_err_t esp_intr_free(intr_handle_t handle);
+
+#endif /**< __SIM_DRIVER_TIMER_H__ */
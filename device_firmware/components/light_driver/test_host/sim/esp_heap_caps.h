@@ -0,0 +1,25 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __SIM_ESP_HEAP_CAPS_H__
+#define __SIM_ESP_HEAP_CAPS_H__
+
+#include <stdlib.h>
+
+#define MALLOC_CAP_8BIT     BIT(2)
+#define MALLOC_CAP_INTERNAL BIT(11)
+
+#define heap_caps_malloc(size, caps) malloc(size)
+
+#endif /**< __SIM_ESP_HEAP_CAPS_H__ */
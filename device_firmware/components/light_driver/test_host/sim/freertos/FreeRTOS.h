@@ -0,0 +1,33 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __SIM_FREERTOS_H__
+#define __SIM_FREERTOS_H__
+
+#include "esp_err.h"
+#include "esp_attr.h"
+
+/**< The simulator runs the fade interrupt on the calling thread, critical sections only count nesting */
+typedef struct {
+    int count;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+
+#define portENTER_CRITICAL(mux)     ((mux)->count++)
+#define portEXIT_CRITICAL(mux)      ((mux)->count--)
+#define portENTER_CRITICAL_ISR(mux) ((mux)->count++)
+#define portEXIT_CRITICAL_ISR(mux)  ((mux)->count--)
+
+#endif /**< __SIM_FREERTOS_H__ */
@@ -0,0 +1,481 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_system.h"
+#include "ledc_sim.h"
+#include "hal/cpu_hal.h"
+
+#define SIM_CHANNEL_DUTY_MAX (BIT(19) - 1)
+#define SIM_TIME_NONE        (UINT64_MAX)
+
+/**
+ * @brief State of a channel that is not visible in its registers
+ */
+typedef struct {
+    bool configured;
+    uint32_t duty;          /**< Output duty, 4 fractional bits */
+    uint32_t hpoint;        /**< Latched hpoint */
+    uint32_t num;           /**< Duty steps left */
+    uint32_t cycle;
+    uint32_t cycle_count;
+    uint32_t scale;
+    bool inc;
+    uint64_t next_ns;       /**< Start of the next PWM period */
+    ledc_sim_sample_t *timeline;
+    size_t timeline_len;
+    size_t timeline_size;
+} sim_channel_t;
+
+typedef struct {
+    uint32_t divider;
+    uint64_t alarm;
+    uint64_t start_ns;      /**< Time the counter was 0 */
+    uint64_t next_ns;       /**< Time of the next alarm, SIM_TIME_NONE if the timer is stopped */
+    void (*isr)(void *);
+    void *isr_arg;
+} sim_timer_t;
+
+ledc_dev_t LEDC;
+timg_dev_t TIMERG0;
+timg_dev_t TIMERG1;
+
+static uint64_t g_now_ns = 0;
+static uint32_t g_random = 1;
+static sim_channel_t g_channel[LEDC_CHANNEL_MAX];
+static sim_timer_t g_timer;
+static ledc_sim_stats_t g_stats;
+static uint64_t g_isr_latency_ns = 0;
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+        case ESP_OK:
+            return "ESP_OK";
+
+        case ESP_ERR_NO_MEM:
+            return "ESP_ERR_NO_MEM";
+
+        case ESP_ERR_INVALID_ARG:
+            return "ESP_ERR_INVALID_ARG";
+
+        case ESP_ERR_INVALID_STATE:
+            return "ESP_ERR_INVALID_STATE";
+
+        default:
+            return "ESP_FAIL";
+    }
+}
+
+uint32_t esp_random(void)
+{
+    /**< Deterministic, so that failures can be reproduced */
+    g_random = g_random * 1103515245 + 12345;
+    return g_random;
+}
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *timer_conf)
+{
+    uint64_t precision = BIT(timer_conf->duty_resolution);
+    uint64_t divider   = ((uint64_t)LEDC_APB_CLK_HZ << 8) / (timer_conf->freq_hz * precision);
+
+    if (timer_conf->timer_num >= LEDC_TIMER_MAX || divider < 256 || divider >= BIT(18)) {
+        return ESP_FAIL;
+    }
+
+    LEDC.timer_group[0].timer[timer_conf->timer_num].conf.duty_resolution = timer_conf->duty_resolution;
+    LEDC.timer_group[0].timer[timer_conf->timer_num].conf.clock_divider   = divider;
+    LEDC.timer_group[0].timer[timer_conf->timer_num].conf.tick_sel        = LEDC_APB_CLK;
+
+    return ESP_OK;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *ledc_conf)
+{
+    if (ledc_conf->channel >= LEDC_CHANNEL_MAX || ledc_conf->timer_sel >= LEDC_TIMER_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    sim_channel_t *channel = g_channel + ledc_conf->channel;
+
+    LEDC.channel_group[0].channel[ledc_conf->channel].conf0.timer_sel  = ledc_conf->timer_sel;
+    LEDC.channel_group[0].channel[ledc_conf->channel].conf0.sig_out_en = 1;
+    LEDC.channel_group[0].channel[ledc_conf->channel].hpoint.hpoint    = ledc_conf->hpoint;
+    LEDC.channel_group[0].channel[ledc_conf->channel].duty.duty        = ledc_conf->duty << 4;
+    LEDC.channel_group[0].channel[ledc_conf->channel].conf1.duty_start = 1;
+    LEDC.channel_group[0].channel[ledc_conf->channel].conf0.low_speed_update = 1;
+
+    channel->configured = true;
+    channel->next_ns    = g_now_ns;
+
+    return ESP_OK;
+}
+
+esp_err_t ledc_stop(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t idle_level)
+{
+    if (channel >= LEDC_CHANNEL_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    LEDC.channel_group[0].channel[channel].conf0.sig_out_en = 0;
+    LEDC.channel_group[0].channel[channel].conf0.idle_lv    = idle_level;
+    LEDC.channel_group[0].channel[channel].conf0.low_speed_update = 1;
+
+    return ESP_OK;
+}
+
+esp_err_t timer_init(timer_group_t group_num, timer_idx_t timer_num, const timer_config_t *config)
+{
+    if (group_num != TIMER_GROUP_0 || timer_num != TIMER_0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    g_timer.divider  = config->divider;
+    g_timer.next_ns  = SIM_TIME_NONE;
+    TIMERG0.hw_timer[0].config.divider  = config->divider;
+    TIMERG0.hw_timer[0].config.alarm_en = config->alarm_en;
+    TIMERG0.hw_timer[0].config.enable   = config->counter_en;
+
+    return ESP_OK;
+}
+
+static uint64_t sim_timer_count_ns(uint64_t count)
+{
+    return count * g_timer.divider * 1000 / (TIMER_BASE_CLK / 1000 / 1000);
+}
+
+/**
+ * @brief Move a pending alarm after a change of the counter or the alarm value,
+ *        an alarm value the counter has passed fires at once
+ */
+static void sim_timer_reschedule(void)
+{
+    if (g_timer.next_ns == SIM_TIME_NONE) {
+        return;
+    }
+
+    g_timer.next_ns = g_timer.start_ns + sim_timer_count_ns(g_timer.alarm);
+    g_timer.next_ns = (g_timer.next_ns < g_now_ns) ? g_now_ns : g_timer.next_ns;
+}
+
+esp_err_t timer_set_counter_value(timer_group_t group_num, timer_idx_t timer_num, uint64_t load_val)
+{
+    g_timer.start_ns = g_now_ns - sim_timer_count_ns(load_val);
+    sim_timer_reschedule();
+    return ESP_OK;
+}
+
+esp_err_t timer_get_counter_value(timer_group_t group_num, timer_idx_t timer_num, uint64_t *timer_val)
+{
+    uint64_t elapsed_ns = (g_timer.next_ns == SIM_TIME_NONE) ? 0 : g_now_ns - g_timer.start_ns;
+
+    *timer_val = elapsed_ns * (TIMER_BASE_CLK / 1000 / 1000) / g_timer.divider / 1000;
+    return ESP_OK;
+}
+
+uint64_t timer_group_get_counter_value_in_isr(timer_group_t group_num, timer_idx_t timer_num)
+{
+    uint64_t timer_val = 0;
+
+    /**< The interrupt is entered g_isr_latency_ns after the alarm reloaded the counter */
+    timer_get_counter_value(group_num, timer_num, &timer_val);
+    return timer_val + g_isr_latency_ns * (TIMER_BASE_CLK / 1000 / 1000) / g_timer.divider / 1000;
+}
+
+esp_err_t timer_set_alarm_value(timer_group_t group_num, timer_idx_t timer_num, uint64_t alarm_value)
+{
+    g_timer.alarm = alarm_value;
+    sim_timer_reschedule();
+    return ESP_OK;
+}
+
+void timer_group_set_alarm_value_in_isr(timer_group_t group_num, timer_idx_t timer_num, uint64_t alarm_val)
+{
+    timer_set_alarm_value(group_num, timer_num, alarm_val);
+}
+
+esp_err_t timer_enable_intr(timer_group_t group_num, timer_idx_t timer_num)
+{
+    return ESP_OK;
+}
+
+esp_err_t timer_disable_intr(timer_group_t group_num, timer_idx_t timer_num)
+{
+    g_timer.isr = NULL;
+    return ESP_OK;
+}
+
+esp_err_t timer_isr_register(timer_group_t group_num, timer_idx_t timer_num, void (*fn)(void *),
+                             void *arg, int intr_alloc_flags, timer_isr_handle_t *handle)
+{
+    g_timer.isr     = fn;
+    g_timer.isr_arg = arg;
+
+    if (handle) {
+        *handle = &g_timer;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t timer_start(timer_group_t group_num, timer_idx_t timer_num)
+{
+    TIMERG0.hw_timer[0].config.enable = 1;
+    return ESP_OK;
+}
+
+esp_err_t esp_intr_free(intr_handle_t handle)
+{
+    g_timer.isr = NULL;
+    return ESP_OK;
+}
+
+static uint64_t sim_timer_period_ns(void)
+{
+    return sim_timer_count_ns(g_timer.alarm);
+}
+
+static uint64_t sim_pwm_period_ns(int channel)
+{
+    uint32_t timer_sel = LEDC.channel_group[0].channel[channel].conf0.timer_sel;
+    uint64_t precision = BIT(LEDC.timer_group[0].timer[timer_sel].conf.duty_resolution);
+    uint64_t divider   = LEDC.timer_group[0].timer[timer_sel].conf.clock_divider;
+
+    /**< precision * (divider / 256) cycles of the 80 MHz APB clock */
+    return precision * divider * 1000 / (256 * (LEDC_APB_CLK_HZ / 1000 / 1000));
+}
+
+static void sim_record(int channel_num, uint32_t duty)
+{
+    sim_channel_t *channel = g_channel + channel_num;
+
+    if (channel->timeline_len && channel->timeline[channel->timeline_len - 1].duty == duty) {
+        return;
+    }
+
+    if (channel->timeline_len == channel->timeline_size) {
+        channel->timeline_size = channel->timeline_size ? channel->timeline_size * 2 : 256;
+        channel->timeline = realloc(channel->timeline, channel->timeline_size * sizeof(ledc_sim_sample_t));
+
+        if (!channel->timeline) {
+            fprintf(stderr, "ledc_sim: out of memory\n");
+            exit(1);
+        }
+    }
+
+    channel->timeline[channel->timeline_len].time_us = g_now_ns / 1000;
+    channel->timeline[channel->timeline_len].duty    = duty;
+    channel->timeline_len++;
+}
+
+/**
+ * @brief One PWM period of a channel: latch a pending update, output the duty, step the fade
+ */
+static void sim_channel_period(int channel_num)
+{
+    sim_channel_t *channel = g_channel + channel_num;
+    typeof(LEDC.channel_group[0].channel[0]) *reg = &LEDC.channel_group[0].channel[channel_num];
+    uint32_t resolution = LEDC.timer_group[0].timer[reg->conf0.timer_sel].conf.duty_resolution;
+    uint32_t duty_max = (BIT(resolution) << 4) > SIM_CHANNEL_DUTY_MAX ? SIM_CHANNEL_DUTY_MAX : (BIT(resolution) << 4);
+
+    if (reg->conf0.low_speed_update) {
+        reg->conf0.low_speed_update = 0;
+        channel->hpoint = reg->hpoint.hpoint;
+
+        if (reg->conf1.duty_start) {
+            reg->conf1.duty_start = 0;
+            channel->duty        = reg->duty.duty;
+            channel->num         = reg->conf1.duty_num;
+            channel->cycle       = reg->conf1.duty_cycle ? reg->conf1.duty_cycle : 1;
+            channel->scale       = reg->conf1.duty_scale;
+            channel->inc         = reg->conf1.duty_inc;
+            channel->cycle_count = 0;
+            g_stats.updates[channel_num]++;
+        }
+    }
+
+    uint32_t output = reg->conf0.sig_out_en ? channel->duty : 0;
+
+    reg->duty_rd.duty_read = channel->duty;
+    sim_record(channel_num, output);
+
+    if (channel->num && channel->scale && ++channel->cycle_count >= channel->cycle) {
+        uint32_t scale = channel->scale << 4;
+
+        channel->cycle_count = 0;
+        channel->num--;
+        g_stats.steps[channel_num]++;
+
+        if (channel->inc) {
+            channel->duty = (channel->duty + scale > duty_max) ? duty_max : channel->duty + scale;
+        } else {
+            channel->duty = (channel->duty < scale) ? 0 : channel->duty - scale;
+        }
+    }
+}
+
+static uint64_t sim_host_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 * 1000 * 1000 + now.tv_nsec;
+}
+
+uint32_t cpu_hal_get_cycle_count(void)
+{
+    return sim_host_ns() * 160 / 1000;
+}
+
+static void sim_timer_alarm(void)
+{
+    /**< The alarm fires once, the interrupt has to enable it again */
+    if (!TIMERG0.hw_timer[0].config.alarm_en || !g_timer.isr) {
+        return;
+    }
+
+    TIMERG0.hw_timer[0].config.alarm_en = 0;
+    TIMERG0.int_st.t0 = 1;
+
+    uint64_t start = sim_host_ns();
+    g_timer.isr(g_timer.isr_arg);
+    uint64_t cost = sim_host_ns() - start;
+
+    g_stats.isr_count++;
+    g_stats.isr_ns += cost;
+    g_stats.isr_max_ns = cost > g_stats.isr_max_ns ? cost : g_stats.isr_max_ns;
+
+    if (TIMERG0.int_clr.t0) {
+        TIMERG0.int_clr.t0 = 0;
+        TIMERG0.int_st.t0  = 0;
+    }
+}
+
+void ledc_sim_run_ms(uint32_t ms)
+{
+    uint64_t end_ns = g_now_ns + (uint64_t)ms * 1000 * 1000;
+
+    for (;;) {
+        uint64_t next_ns = end_ns;
+
+        /**< The timer counts from the moment it is enabled */
+        if (TIMERG0.hw_timer[0].config.enable && g_timer.next_ns == SIM_TIME_NONE) {
+            g_timer.start_ns = g_now_ns;
+            g_timer.next_ns  = g_now_ns + sim_timer_period_ns();
+        } else if (!TIMERG0.hw_timer[0].config.enable) {
+            g_timer.next_ns = SIM_TIME_NONE;
+        }
+
+        if (g_timer.next_ns < next_ns) {
+            next_ns = g_timer.next_ns;
+        }
+
+        for (int i = 0; i < LEDC_CHANNEL_MAX; i++) {
+            if (g_channel[i].configured && g_channel[i].next_ns < next_ns) {
+                next_ns = g_channel[i].next_ns;
+            }
+        }
+
+        if (next_ns >= end_ns) {
+            g_now_ns = end_ns;
+            return;
+        }
+
+        g_now_ns = next_ns;
+
+        for (int i = 0; i < LEDC_CHANNEL_MAX; i++) {
+            if (g_channel[i].configured && g_channel[i].next_ns == g_now_ns) {
+                sim_channel_period(i);
+                g_channel[i].next_ns += sim_pwm_period_ns(i);
+            }
+        }
+
+        /**< Auto-reload, the interrupt may set the alarm of the next period */
+        if (g_timer.next_ns == g_now_ns) {
+            g_timer.start_ns = g_now_ns;
+            g_timer.next_ns  = g_now_ns + sim_timer_period_ns();
+            sim_timer_alarm();
+        }
+    }
+}
+
+void ledc_sim_clear_timeline(void)
+{
+    for (int i = 0; i < LEDC_CHANNEL_MAX; i++) {
+        g_channel[i].timeline_len = 0;
+    }
+
+    memset(&g_stats, 0, sizeof(g_stats));
+}
+
+void ledc_sim_reset(void)
+{
+    for (int i = 0; i < LEDC_CHANNEL_MAX; i++) {
+        free(g_channel[i].timeline);
+    }
+
+    memset((void *)&LEDC, 0, sizeof(LEDC));
+    memset((void *)&TIMERG0, 0, sizeof(TIMERG0));
+    memset((void *)&TIMERG1, 0, sizeof(TIMERG1));
+    memset(g_channel, 0, sizeof(g_channel));
+    memset(&g_timer, 0, sizeof(g_timer));
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_isr_latency_ns = 0;
+    g_timer.next_ns = SIM_TIME_NONE;
+    g_now_ns = 0;
+    g_random = 1;
+}
+
+uint64_t ledc_sim_time_us(void)
+{
+    return g_now_ns / 1000;
+}
+
+uint32_t ledc_sim_duty(ledc_channel_t channel)
+{
+    if (!LEDC.channel_group[0].channel[channel].conf0.sig_out_en) {
+        return 0;
+    }
+
+    return g_channel[channel].duty;
+}
+
+uint32_t ledc_sim_hpoint(ledc_channel_t channel)
+{
+    return g_channel[channel].hpoint;
+}
+
+void ledc_sim_set_isr_latency(uint32_t latency_us)
+{
+    g_isr_latency_ns = (uint64_t)latency_us * 1000;
+}
+
+bool ledc_sim_timer_running(void)
+{
+    return TIMERG0.hw_timer[0].config.enable;
+}
+
+size_t ledc_sim_timeline(ledc_channel_t channel, const ledc_sim_sample_t **samples)
+{
+    *samples = g_channel[channel].timeline;
+    return g_channel[channel].timeline_len;
+}
+
+void ledc_sim_get_stats(ledc_sim_stats_t *stats)
+{
+    *stats = g_stats;
+}
@@ -0,0 +1,122 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __LEDC_SIM_H__
+#define __LEDC_SIM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "driver/ledc.h"
+#include "driver/timer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Simulated LEDC and timer group backend of iot_led.c
+ *
+ * iot_led.c is compiled unchanged against the headers of this directory. It
+ * writes the simulated LEDC and TIMERG0 registers, and ledc_sim_run_ms() models
+ * the hardware on the host:
+ *     - every PWM period a channel latches a pending update (duty_start) and
+ *       steps its duty by duty_scale every duty_cycle periods, duty_num times
+ *     - duty_rd follows the output duty, with 4 fractional bits
+ *     - the periodic timer calls the registered interrupt while it is enabled,
+ *       the alarm has to be re-armed by the interrupt like on the chip
+ *
+ * Every change of the output duty of a channel is recorded in its timeline.
+ */
+
+/**
+ * @brief One change of the output duty of a channel
+ */
+typedef struct {
+    uint64_t time_us;
+    uint32_t duty;          /**< Output duty with 4 fractional bits, like duty_rd */
+} ledc_sim_sample_t;
+
+/**
+ * @brief Counters of the simulated hardware
+ */
+typedef struct {
+    uint32_t isr_count;     /**< Calls of the timer interrupt */
+    uint64_t isr_ns;        /**< Host time spent in the timer interrupt */
+    uint64_t isr_max_ns;    /**< Longest call of the timer interrupt */
+    uint32_t updates[LEDC_CHANNEL_MAX];    /**< Updates latched by each channel */
+    uint32_t steps[LEDC_CHANNEL_MAX];      /**< Hardware duty steps of each channel */
+} ledc_sim_stats_t;
+
+/**
+ * @brief Reset the registers, the time, the timelines and the counters
+ */
+void ledc_sim_reset(void);
+
+/**
+ * @brief Run the simulated hardware for the given time
+ */
+void ledc_sim_run_ms(uint32_t ms);
+
+/**
+ * @brief Simulated time since ledc_sim_reset()
+ */
+uint64_t ledc_sim_time_us(void);
+
+/**
+ * @brief Output duty of the channel, with 4 fractional bits
+ */
+uint32_t ledc_sim_duty(ledc_channel_t channel);
+
+/**
+ * @brief Timer count at which the channel output switches on
+ */
+uint32_t ledc_sim_hpoint(ledc_channel_t channel);
+
+/**
+ * @brief Pretend the timer interrupt is entered this long after its alarm,
+ *        only the counter it reads is affected
+ */
+void ledc_sim_set_isr_latency(uint32_t latency_us);
+
+/**
+ * @brief Whether the fade interrupt timer is running
+ */
+bool ledc_sim_timer_running(void);
+
+/**
+ * @brief Duty timeline of the channel since the last ledc_sim_reset() or ledc_sim_clear_timeline()
+ *
+ * @param  channel The LEDC channel
+ * @param  samples Set to the first sample, valid until the simulation runs again
+ *
+ * @return Number of samples
+ */
+size_t ledc_sim_timeline(ledc_channel_t channel, const ledc_sim_sample_t **samples);
+
+/**
+ * @brief Drop the recorded timelines and reset the counters, the hardware state is kept
+ */
+void ledc_sim_clear_timeline(void);
+
+/**
+ * @brief Counters since the last ledc_sim_reset() or ledc_sim_clear_timeline()
+ */
+void ledc_sim_get_stats(ledc_sim_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /**< __LEDC_SIM_H__ */
@@ -0,0 +1,29 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __SIM_SOC_LEDC_REG_H__
+#define __SIM_SOC_LEDC_REG_H__
+
+/**< Field masks and shifts of the ESP32-C3 LEDC_LSCH0_CONF1_REG */
+#define LEDC_HPOINT_LSCH1_V     0x3FFF
+#define LEDC_DUTY_INC_LSCH0_V   0x1
+#define LEDC_DUTY_INC_LSCH0_S   30
+#define LEDC_DUTY_NUM_LSCH0_V   0x3FF
+#define LEDC_DUTY_NUM_LSCH0_S   20
+#define LEDC_DUTY_CYCLE_LSCH0_V 0x3FF
+#define LEDC_DUTY_CYCLE_LSCH0_S 10
+#define LEDC_DUTY_SCALE_LSCH0_V 0x3FF
+#define LEDC_DUTY_SCALE_LSCH0_S 0
+
+#endif /**< __SIM_SOC_LEDC_REG_H__ */
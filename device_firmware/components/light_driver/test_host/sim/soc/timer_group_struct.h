@@ -0,0 +1,66 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __SIM_SOC_TIMER_GROUP_STRUCT_H__
+#define __SIM_SOC_TIMER_GROUP_STRUCT_H__
+
+#include <stdint.h>
+
+/**
+ * @brief The fields of the ESP32-C3 timer group registers that iot_led.c uses
+ */
+typedef volatile struct {
+    struct {
+        union {
+            struct {
+                uint32_t reserved0: 10;
+                uint32_t alarm_en: 1;
+                uint32_t reserved11: 2;
+                uint32_t divider: 16;
+                uint32_t autoreload: 1;
+                uint32_t increase: 1;
+                uint32_t enable: 1;
+            };
+            uint32_t val;
+        } config;
+        union {
+            struct {
+                uint32_t reserved0: 31;
+                uint32_t update: 1;
+            };
+            uint32_t val;
+        } update;
+    } hw_timer[1];
+    union {
+        struct {
+            uint32_t t0: 1;
+            uint32_t wdt: 1;
+            uint32_t reserved2: 30;
+        };
+        uint32_t val;
+    } int_st;
+    union {
+        struct {
+            uint32_t t0: 1;
+            uint32_t wdt: 1;
+            uint32_t reserved2: 30;
+        };
+        uint32_t val;
+    } int_clr;
+} timg_dev_t;
+
+extern timg_dev_t TIMERG0;
+extern timg_dev_t TIMERG1;
+
+#endif /**< __SIM_SOC_TIMER_GROUP_STRUCT_H__ */
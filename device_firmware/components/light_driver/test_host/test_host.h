@@ -0,0 +1,41 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __TEST_HOST_H__
+#define __TEST_HOST_H__
+
+#include <stdio.h>
+#include <sys/param.h>
+
+/**
+ * @brief Minimal assertion helpers for the light_driver host tests
+ */
+static int g_test_failures = 0;
+
+#define TEST_ASSERT(con) do { \
+        if (!(con)) { \
+            printf("%s:%d: FAIL: %s\n", __FILE__, __LINE__, #con); \
+            g_test_failures++; \
+        } \
+    } while(0)
+
+#define RUN_TEST(func) do { \
+        int failures = g_test_failures; \
+        func(); \
+        printf("%s: %s\n", #func, failures == g_test_failures ? "OK" : "FAIL"); \
+    } while(0)
+
+#define TEST_RESULT() (g_test_failures ? 1 : 0)
+
+#endif /**< __TEST_HOST_H__ */
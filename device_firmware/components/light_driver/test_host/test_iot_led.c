@@ -0,0 +1,701 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @brief Regression tests and benchmark of the fade engine of iot_led.c,
+ *        running on the simulated LEDC and timer of sim/ledc_sim.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "iot_led.h"
+#include "light_color.h"
+#include "../iot_led_gamma.h"
+#include "ledc_sim.h"
+#include "test_host.h"
+
+#define TEST_FREQ_HZ      (5000)
+#define TEST_TRANSITIONS  (2000)
+#define BENCH_TRANSITIONS (20000)
+#define DUTY_MAX          (BIT(LEDC_TIMER_13_BIT) << 4)
+
+static void led_setup(int channel_num)
+{
+    ledc_sim_reset();
+    TEST_ASSERT(iot_led_init(LEDC_TIMER_0, LEDC_LOW_SPEED_MODE, TEST_FREQ_HZ,
+                             LEDC_USE_APB_CLK, LEDC_TIMER_13_BIT) == ESP_OK);
+
+    for (int i = 0; i < channel_num; i++) {
+        TEST_ASSERT(iot_led_regist_channel(i, i) == ESP_OK);
+    }
+}
+
+static void led_teardown(void)
+{
+    iot_led_deinit();
+}
+
+/**
+ * @brief Run until the fade interrupt stops itself, return the simulated time it took
+ */
+static uint32_t run_until_idle(uint32_t limit_ms)
+{
+    uint32_t ms = 0;
+
+    while (ledc_sim_timer_running() && ms < limit_ms) {
+        ledc_sim_run_ms(DUTY_SET_CYCLE);
+        ms += DUTY_SET_CYCLE;
+    }
+
+    /**< Let the last update be latched */
+    ledc_sim_run_ms(DUTY_SET_CYCLE);
+
+    return ms;
+}
+
+static void test_fade_reaches_target(void)
+{
+    led_setup(2);
+
+    for (int i = 0; i < TEST_TRANSITIONS; i++) {
+        uint8_t value    = rand() % 256;
+        uint32_t fade_ms = rand() % 1000;
+
+        /**< Channel 1 is set at once, the faded channel 0 must end on the same duty */
+        TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_0, value, fade_ms) == ESP_OK);
+        TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_1, value, 0) == ESP_OK);
+
+        /**< Every fourth transition is retargeted half way */
+        if (i % 4 == 0) {
+            ledc_sim_run_ms(fade_ms / 2);
+            value = rand() % 256;
+            TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_0, value, fade_ms) == ESP_OK);
+            TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_1, value, 0) == ESP_OK);
+        }
+
+        uint32_t ms = run_until_idle(fade_ms + 10 * DUTY_SET_CYCLE);
+
+        TEST_ASSERT(!ledc_sim_timer_running());
+        TEST_ASSERT(ms <= MAX(fade_ms, DUTY_SET_CYCLE) + DUTY_SET_CYCLE);
+        TEST_ASSERT(ledc_sim_duty(LEDC_CHANNEL_0) == ledc_sim_duty(LEDC_CHANNEL_1));
+    }
+
+    led_teardown();
+}
+
+static void test_fade_monotonic(void)
+{
+    const ledc_sim_sample_t *samples = NULL;
+
+    led_setup(1);
+    ledc_sim_clear_timeline();
+
+    TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_0, 255, 1000) == ESP_OK);
+    run_until_idle(2000);
+
+    size_t len = ledc_sim_timeline(LEDC_CHANNEL_0, &samples);
+
+    for (size_t i = 1; i < len; i++) {
+        TEST_ASSERT(samples[i].duty >= samples[i - 1].duty);
+    }
+
+    /**< The final duty is reached after the fade time, within two ticks */
+    TEST_ASSERT(len > 100);
+    TEST_ASSERT(samples[len - 1].time_us >= (1000 - 2 * DUTY_SET_CYCLE) * 1000);
+    TEST_ASSERT(samples[len - 1].time_us <= (1000 + 2 * DUTY_SET_CYCLE) * 1000);
+
+    led_teardown();
+}
+
+static void test_hsv_fade_keeps_saturation(void)
+{
+    const ledc_channel_t rgb[3] = {LEDC_CHANNEL_0, LEDC_CHANNEL_1, LEDC_CHANNEL_2};
+    uint32_t peak_min = UINT32_MAX, green_max = 0;
+
+    led_setup(3);
+
+    TEST_ASSERT(iot_led_set_hsv_channels(rgb, 0, LIGHT_COLOR_MAX, LIGHT_COLOR_MAX, 0) == ESP_OK);
+    run_until_idle(1000);
+
+    /**< Red to blue takes the shorter arc through magenta, green stays off */
+    TEST_ASSERT(iot_led_set_hsv_channels(rgb, 0xAAAB, LIGHT_COLOR_MAX, LIGHT_COLOR_MAX, 1000) == ESP_OK);
+
+    while (ledc_sim_timer_running()) {
+        ledc_sim_run_ms(DUTY_SET_CYCLE / 2);
+
+        uint32_t peak = MAX(ledc_sim_duty(LEDC_CHANNEL_0), ledc_sim_duty(LEDC_CHANNEL_2));
+        peak_min  = MIN(peak_min, peak);
+        green_max = MAX(green_max, ledc_sim_duty(LEDC_CHANNEL_1));
+    }
+
+    printf("hsv fade red -> blue: lowest peak duty %.1f %%, highest green duty %.1f %%\n",
+           peak_min * 100.0 / DUTY_MAX, green_max * 100.0 / DUTY_MAX);
+
+    TEST_ASSERT(peak_min >= DUTY_MAX * 95 / 100);
+    TEST_ASSERT(green_max <= DUTY_MAX / 100);
+
+    led_teardown();
+}
+
+static void test_program(void)
+{
+    const ledc_channel_t channels[1] = {LEDC_CHANNEL_0};
+    const iot_led_keyframe_t blink[] = {
+        {{255}, 0, IOT_LED_EASE_STEP, 100},
+        {{0}, 0, IOT_LED_EASE_STEP, 100},
+    };
+    const iot_led_keyframe_t ramp[] = {
+        {{255}, 0, IOT_LED_EASE_LINEAR, 400},
+    };
+    const iot_led_program_t blink_program = {blink, 2, 0, 3};
+    const iot_led_program_t forever_program = {blink, 2, 0, 0};
+    const iot_led_program_t ramp_program = {ramp, 1, 0, 1};
+    const ledc_sim_sample_t *samples = NULL;
+    int edges = 0;
+
+    led_setup(2);
+
+    /**< Three runs of on and off, then the program ends off and the timer stops */
+    ledc_sim_clear_timeline();
+    TEST_ASSERT(iot_led_start_program(channels, 1, &blink_program) == ESP_OK);
+    run_until_idle(2000);
+
+    size_t len = ledc_sim_timeline(LEDC_CHANNEL_0, &samples);
+
+    for (size_t i = 1; i < len; i++) {
+        edges += (samples[i].duty == 0) != (samples[i - 1].duty == 0);
+    }
+
+    TEST_ASSERT(edges == 6);
+    TEST_ASSERT(ledc_sim_duty(LEDC_CHANNEL_0) == 0);
+    TEST_ASSERT(!ledc_sim_timer_running());
+
+    /**< A linear keyframe ends on the same duty as a direct set */
+    TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_1, 255, 0) == ESP_OK);
+    TEST_ASSERT(iot_led_start_program(channels, 1, &ramp_program) == ESP_OK);
+    uint32_t ms = run_until_idle(2000);
+    TEST_ASSERT(ms >= 400 && ms <= 400 + 2 * DUTY_SET_CYCLE);
+    TEST_ASSERT(ledc_sim_duty(LEDC_CHANNEL_0) == ledc_sim_duty(LEDC_CHANNEL_1));
+
+    /**< Setting the channel stops an endless program */
+    TEST_ASSERT(iot_led_start_program(channels, 1, &forever_program) == ESP_OK);
+    ledc_sim_run_ms(1000);
+    TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_0, 128, 0) == ESP_OK);
+    TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_1, 128, 0) == ESP_OK);
+    run_until_idle(1000);
+    TEST_ASSERT(!ledc_sim_timer_running());
+    TEST_ASSERT(ledc_sim_duty(LEDC_CHANNEL_0) == ledc_sim_duty(LEDC_CHANNEL_1));
+
+    led_teardown();
+}
+
+static void test_gamma_table(void)
+{
+    uint16_t linear[GAMMA_TABLE_SIZE];
+
+    /**< The generated table is the one the former powf() code computed at boot */
+    for (int i = 0; i < GAMMA_TABLE_SIZE; i++) {
+        float value = powf((float)i / (GAMMA_TABLE_SIZE - 1), 1.0f / (float)GAMMA_CORRECTION);
+        uint16_t expected = (uint16_t)(int)(value * GAMMA_TABLE_SIZE * 256);
+
+        TEST_ASSERT(s_gamma_table_default[i] == ((expected || i == 0) ? expected : UINT16_MAX));
+    }
+
+    for (int i = 0; i < GAMMA_TABLE_SIZE; i++) {
+        linear[i] = i * 257;
+    }
+
+    /**< Linear light follows the curve, and a value comes back from its light */
+    TEST_ASSERT(abs(iot_led_value_to_linear(32768) - (int)(powf(0.5f, 1.0f / (float)GAMMA_CORRECTION) * UINT16_MAX)) <= 64);
+    TEST_ASSERT(iot_led_value_to_linear(0) == 0 && iot_led_value_to_linear(UINT16_MAX) == UINT16_MAX);
+    TEST_ASSERT(iot_led_linear_to_value(0) == 0 && iot_led_linear_to_value(UINT16_MAX) == UINT16_MAX);
+
+    for (uint32_t i = 0; i <= UINT16_MAX; i++) {
+        TEST_ASSERT(abs(iot_led_value_to_linear(iot_led_linear_to_value(i)) - (int)i) <= 2);
+    }
+
+    led_setup(1);
+    TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_0, 128, 0) == ESP_OK);
+    run_until_idle(100);
+    TEST_ASSERT(ledc_sim_duty(LEDC_CHANNEL_0) == (s_gamma_table_default[128] * BIT(LEDC_TIMER_13_BIT) / UINT16_MAX) << 4);
+
+    TEST_ASSERT(iot_led_set_gamma_table(linear) == ESP_OK);
+    TEST_ASSERT(abs(iot_led_value_to_linear(12345) - 12345) <= 1 && abs(iot_led_linear_to_value(12345) - 12345) <= 1);
+    TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_0, 128, 0) == ESP_OK);
+    run_until_idle(100);
+    TEST_ASSERT(ledc_sim_duty(LEDC_CHANNEL_0) == (128 * 257 * BIT(LEDC_TIMER_13_BIT) / UINT16_MAX) << 4);
+    led_teardown();
+
+    /**< iot_led_deinit() restores the default table */
+    led_setup(1);
+    TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_0, 128, 0) == ESP_OK);
+    run_until_idle(100);
+    TEST_ASSERT(ledc_sim_duty(LEDC_CHANNEL_0) == (s_gamma_table_default[128] * BIT(LEDC_TIMER_13_BIT) / UINT16_MAX) << 4);
+    led_teardown();
+}
+
+static void test_calibration(void)
+{
+    const iot_led_calibration_t linear_half = {1000, UINT16_MAX / 2, 0};
+    const iot_led_calibration_t offset = {0, UINT16_MAX, 4096};
+
+    led_setup(3);
+
+    TEST_ASSERT(iot_led_set_calibration(LEDC_CHANNEL_0, &linear_half) == ESP_OK);
+    TEST_ASSERT(iot_led_set_calibration(LEDC_CHANNEL_1, &offset) == ESP_OK);
+    TEST_ASSERT(iot_led_set_calibration(LEDC_CHANNEL_2, &(iot_led_calibration_t) {0}) == ESP_ERR_INVALID_ARG);
+
+    /**< The duty follows the calibration of the channel, the linear light the shared curve */
+    TEST_ASSERT(abs(iot_led_value_to_duty(LEDC_CHANNEL_0, UINT16_MAX) - UINT16_MAX / 2) <= 1);
+    TEST_ASSERT(iot_led_value_to_duty(LEDC_CHANNEL_2, 32768) == iot_led_value_to_linear(32768));
+
+    /**< Full scale is scaled by the gain, the shared curve of channel 2 is unchanged */
+    TEST_ASSERT(iot_led_set_channels(0x7, (const uint8_t[]) {255, 255, 255}, 0) == ESP_OK);
+    run_until_idle(100);
+    TEST_ASSERT(abs((int)ledc_sim_duty(LEDC_CHANNEL_0) - DUTY_MAX / 2) <= 16);
+    TEST_ASSERT(ledc_sim_duty(LEDC_CHANNEL_1) == DUTY_MAX);
+    TEST_ASSERT(ledc_sim_duty(LEDC_CHANNEL_2) == DUTY_MAX);
+
+    /**< The lowest non-zero value starts at the offset, zero stays off */
+    TEST_ASSERT(iot_led_set_channels(0x7, (const uint8_t[]) {1, 1, 0}, 0) == ESP_OK);
+    run_until_idle(100);
+    TEST_ASSERT(ledc_sim_duty(LEDC_CHANNEL_1) >= (4096 * BIT(LEDC_TIMER_13_BIT) / UINT16_MAX) << 4);
+    TEST_ASSERT(ledc_sim_duty(LEDC_CHANNEL_2) == 0);
+
+    /**< Removing the calibration goes back to the shared curve */
+    TEST_ASSERT(iot_led_set_calibration(LEDC_CHANNEL_0, NULL) == ESP_OK);
+    TEST_ASSERT(iot_led_value_to_duty(LEDC_CHANNEL_0, UINT16_MAX) == iot_led_value_to_linear(UINT16_MAX));
+    TEST_ASSERT(iot_led_set_channels(0x5, (const uint8_t[]) {128, 0, 128}, 0) == ESP_OK);
+    run_until_idle(100);
+    TEST_ASSERT(ledc_sim_duty(LEDC_CHANNEL_0) == ledc_sim_duty(LEDC_CHANNEL_2));
+
+    led_teardown();
+}
+
+static void test_duty_resolution(void)
+{
+    ledc_sim_reset();
+    TEST_ASSERT(iot_led_init(LEDC_TIMER_0, LEDC_LOW_SPEED_MODE, TEST_FREQ_HZ,
+                             LEDC_USE_APB_CLK, LEDC_TIMER_11_BIT) == ESP_OK);
+    TEST_ASSERT(iot_led_regist_channel(LEDC_CHANNEL_0, 0) == ESP_OK);
+
+    /**< Full scale is the full period of the configured resolution, not of 13 bits */
+    TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_0, 255, 0) == ESP_OK);
+    run_until_idle(100);
+    TEST_ASSERT(ledc_sim_duty(LEDC_CHANNEL_0) == BIT(LEDC_TIMER_11_BIT) << 4);
+
+    /**< A fade takes its time at the lower resolution too */
+    TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_0, 0, 500) == ESP_OK);
+    ledc_sim_run_ms(250);
+    TEST_ASSERT(ledc_sim_duty(LEDC_CHANNEL_0) > 0 && ledc_sim_duty(LEDC_CHANNEL_0) < BIT(LEDC_TIMER_11_BIT) << 4);
+    run_until_idle(1000);
+    TEST_ASSERT(ledc_sim_duty(LEDC_CHANNEL_0) == 0);
+
+    /**< A second group runs from its own timer, 80 MHz / 16 kHz leaves 12 bits */
+    TEST_ASSERT(iot_led_regist_channel_ex(LEDC_CHANNEL_1, 1, LEDC_TIMER_1) == ESP_ERR_INVALID_ARG);
+    TEST_ASSERT(iot_led_timer_config(LEDC_TIMER_1, 16000, LEDC_USE_APB_CLK, IOT_LED_DUTY_RESOLUTION_AUTO) == ESP_OK);
+    TEST_ASSERT(iot_led_regist_channel_ex(LEDC_CHANNEL_1, 1, LEDC_TIMER_1) == ESP_OK);
+    TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_0, 255, 0) == ESP_OK);
+    TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_1, 255, 500) == ESP_OK);
+    run_until_idle(1000);
+    TEST_ASSERT(ledc_sim_duty(LEDC_CHANNEL_0) == BIT(LEDC_TIMER_11_BIT) << 4);
+    TEST_ASSERT(ledc_sim_duty(LEDC_CHANNEL_1) == BIT(LEDC_TIMER_12_BIT) << 4);
+
+    /**< Both full, each channel starts at 0 of the period of its own timer */
+    TEST_ASSERT(ledc_sim_hpoint(LEDC_CHANNEL_0) == 0 && ledc_sim_hpoint(LEDC_CHANNEL_1) == 0);
+
+    /**< Reconfiguring a timer rewrites the duties of its channels at the new resolution, 14 bits at 2 kHz */
+    TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_1, 128, 0) == ESP_OK);
+    run_until_idle(100);
+    uint32_t duty = ledc_sim_duty(LEDC_CHANNEL_1);
+    TEST_ASSERT(iot_led_timer_config(LEDC_TIMER_1, 2000, LEDC_USE_APB_CLK, IOT_LED_DUTY_RESOLUTION_AUTO) == ESP_OK);
+    run_until_idle(100);
+    TEST_ASSERT(abs((int)ledc_sim_duty(LEDC_CHANNEL_1) - (int)duty * 4) < 4 << 4);
+
+    led_teardown();
+}
+
+static void test_channel16(void)
+{
+    const ledc_sim_sample_t *samples = NULL;
+    uint16_t value = 0;
+    size_t levels = 1;
+
+    led_setup(2);
+
+    /**< The 16-bit state keeps the exact target, 8-bit values are value * 257 */
+    for (uint32_t target = 0; target <= UINT16_MAX; target += 4099) {
+        TEST_ASSERT(iot_led_set_channel16(LEDC_CHANNEL_0, target, 100) == ESP_OK);
+        run_until_idle(1000);
+        TEST_ASSERT(iot_led_get_channel16(LEDC_CHANNEL_0, &value) == ESP_OK);
+        TEST_ASSERT(value == target);
+    }
+
+    TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_0, 77, 0) == ESP_OK);
+    TEST_ASSERT(iot_led_set_channel16(LEDC_CHANNEL_1, 77 * 257, 0) == ESP_OK);
+    run_until_idle(100);
+    TEST_ASSERT(ledc_sim_duty(LEDC_CHANNEL_0) == ledc_sim_duty(LEDC_CHANNEL_1));
+
+    /**< A slow fade over one 8-bit level still moves the duty on every tick */
+    TEST_ASSERT(iot_led_set_channel16(LEDC_CHANNEL_0, 20 * 257, 0) == ESP_OK);
+    run_until_idle(100);
+    ledc_sim_clear_timeline();
+    TEST_ASSERT(iot_led_set_channel16(LEDC_CHANNEL_0, 21 * 257, 1000) == ESP_OK);
+    run_until_idle(2000);
+
+    size_t len = ledc_sim_timeline(LEDC_CHANNEL_0, &samples);
+
+    for (size_t i = 1; i < len; i++) {
+        TEST_ASSERT(samples[i].duty >= samples[i - 1].duty);
+        levels += samples[i].duty != samples[i - 1].duty;
+    }
+
+    printf("fade over one 8-bit level: %zu duty levels\n", levels);
+    TEST_ASSERT(levels >= 8);
+
+    led_teardown();
+}
+
+static void test_dither(void)
+{
+    uint32_t duty = 0, last = UINT32_MAX, last_whole = UINT32_MAX;
+    size_t levels = 0, whole_levels = 0;
+
+    led_setup(1);
+
+    /**< The dim end keeps the fractional duty bits, 16 levels per LSB */
+    for (uint32_t value = 0; value <= 2 * 257; value += 2) {
+        TEST_ASSERT(iot_led_set_channel16(LEDC_CHANNEL_0, value, 0) == ESP_OK);
+        run_until_idle(100);
+
+        duty = ledc_sim_duty(LEDC_CHANNEL_0);
+        TEST_ASSERT(duty < CONFIG_LIGHT_DRIVER_DITHER_THRESHOLD << 4);
+        levels += duty != last;
+        whole_levels += (duty >> 4) != last_whole;
+        last = duty;
+        last_whole = duty >> 4;
+    }
+
+    printf("dim end: %zu dithered duty levels, %zu whole duty levels\n", levels, whole_levels);
+    TEST_ASSERT(levels >= whole_levels * 4);
+
+    /**< Above the threshold the duty stays whole */
+    TEST_ASSERT(iot_led_set_channel16(LEDC_CHANNEL_0, 100 * 257 + 100, 0) == ESP_OK);
+    run_until_idle(100);
+    TEST_ASSERT((ledc_sim_duty(LEDC_CHANNEL_0) & 0xf) == 0);
+
+    led_teardown();
+}
+
+static void test_hardware_fade(void)
+{
+    const ledc_sim_sample_t *samples = NULL;
+    ledc_sim_stats_t stats = {0};
+    uint32_t error_max = 0;
+
+    led_setup(2);
+
+    /**< The segments stay close to the gamma curve the timer path follows */
+    TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_1, 255, 1000) == ESP_OK);
+    TEST_ASSERT(iot_led_set_fade_mode(IOT_LED_FADE_HARDWARE) == ESP_OK);
+    TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_0, 255, 1000) == ESP_OK);
+
+    for (int ms = 0; ms < 1100; ms += DUTY_SET_CYCLE) {
+        ledc_sim_run_ms(DUTY_SET_CYCLE);
+        uint32_t error = abs((int)ledc_sim_duty(LEDC_CHANNEL_0) - (int)ledc_sim_duty(LEDC_CHANNEL_1));
+        error_max = MAX(error_max, error);
+    }
+
+    printf("hardware fade: largest distance to the timer fade %.1f %%\n", error_max * 100.0 / DUTY_MAX);
+    TEST_ASSERT(error_max < DUTY_MAX / 20);
+    TEST_ASSERT(ledc_sim_duty(LEDC_CHANNEL_0) == DUTY_MAX);
+
+    /**< Alone, the timer only fires between the segments */
+    ledc_sim_clear_timeline();
+    TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_0, 0, 2000) == ESP_OK);
+    uint32_t ms = run_until_idle(4000);
+    ledc_sim_get_stats(&stats);
+
+    size_t len = ledc_sim_timeline(LEDC_CHANNEL_0, &samples);
+
+    for (size_t i = 1; i < len; i++) {
+        TEST_ASSERT(samples[i].duty <= samples[i - 1].duty);
+    }
+
+    printf("hardware fade of 2000 ms: %u interrupts\n", stats.isr_count);
+    TEST_ASSERT(stats.isr_count <= HW_FADE_SEGMENT_MAX + 2);
+    TEST_ASSERT(ms <= 2000 + 2 * DUTY_SET_CYCLE);
+    TEST_ASSERT(ledc_sim_duty(LEDC_CHANNEL_0) == 0);
+
+    /**< A change during a segment is served at once and the segment still ends on time */
+    TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_0, 255, 2000) == ESP_OK);
+    ledc_sim_run_ms(310);
+    TEST_ASSERT(iot_led_set_fade_mode(IOT_LED_FADE_TIMER) == ESP_OK);
+    TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_1, 0, 0) == ESP_OK);
+    ledc_sim_run_ms(2 * DUTY_SET_CYCLE);
+    TEST_ASSERT(ledc_sim_duty(LEDC_CHANNEL_1) == 0);
+    ms = run_until_idle(4000);
+    TEST_ASSERT(ms <= 2000 - 310 + DUTY_SET_CYCLE);
+    TEST_ASSERT(ledc_sim_duty(LEDC_CHANNEL_0) == DUTY_MAX);
+
+    led_teardown();
+}
+
+/**
+ * @brief Highest number of channels that are on at the same time during one PWM period
+ */
+static int hpoint_overlap(int channel_num)
+{
+    uint32_t period = BIT(LEDC_TIMER_13_BIT);
+    int overlap_max = 0;
+
+    for (uint32_t count = 0; count < period; count++) {
+        int overlap = 0;
+
+        for (int i = 0; i < channel_num; i++) {
+            uint32_t hpoint = ledc_sim_hpoint(i);
+            uint32_t duty = (ledc_sim_duty(i) + 15) >> 4;
+
+            TEST_ASSERT(hpoint + duty <= period);
+            overlap += count >= hpoint && count < hpoint + duty;
+        }
+
+        overlap_max = (overlap > overlap_max) ? overlap : overlap_max;
+    }
+
+    return overlap_max;
+}
+
+static void test_hpoint(void)
+{
+    uint16_t values[LEDC_CHANNEL_MAX] = {0};
+
+    led_setup(3);
+
+    /**< Duties that fit in the period do not overlap */
+    values[0] = 24000;
+    values[1] = 27000;
+    values[2] = 25000;
+    TEST_ASSERT(iot_led_set_channels16(0x7, values, 0) == ESP_OK);
+    run_until_idle(100);
+    TEST_ASSERT(hpoint_overlap(3) == 1);
+
+    /**< Recomputed when a duty changes, also in the middle of a fade */
+    values[0] = 16000;
+    TEST_ASSERT(iot_led_set_channels16(0x1, values, 500) == ESP_OK);
+    ledc_sim_run_ms(200);
+    TEST_ASSERT(hpoint_overlap(3) == 1);
+    run_until_idle(1000);
+    TEST_ASSERT(hpoint_overlap(3) == 1);
+
+    /**< Together more than the period, no channel wraps and two overlap */
+    values[0] = values[1] = values[2] = 36000;
+    TEST_ASSERT(iot_led_set_channels16(0x7, values, 0) == ESP_OK);
+    run_until_idle(100);
+    TEST_ASSERT(hpoint_overlap(3) == 2);
+
+    /**< A channel in the middle of a hardware fade keeps its hpoint until its next segment */
+    values[0] = values[1] = values[2] = 16000;
+    TEST_ASSERT(iot_led_set_channels16(0x7, values, 0) == ESP_OK);
+    run_until_idle(100);
+    TEST_ASSERT(iot_led_set_fade_mode(IOT_LED_FADE_HARDWARE) == ESP_OK);
+    values[2] = 24000;
+    TEST_ASSERT(iot_led_set_channels16(0x4, values, 2000) == ESP_OK);
+    ledc_sim_run_ms(100);
+    uint32_t hpoint = ledc_sim_hpoint(LEDC_CHANNEL_2);
+    values[0] = 8000;
+    TEST_ASSERT(iot_led_set_channels16(0x1, values, 0) == ESP_OK);
+    ledc_sim_run_ms(2 * DUTY_SET_CYCLE);
+    TEST_ASSERT(ledc_sim_hpoint(LEDC_CHANNEL_2) == hpoint);
+    run_until_idle(3000);
+    TEST_ASSERT(ledc_sim_hpoint(LEDC_CHANNEL_2) != hpoint);
+    TEST_ASSERT(hpoint_overlap(3) == 1);
+    TEST_ASSERT(iot_led_set_fade_mode(IOT_LED_FADE_TIMER) == ESP_OK);
+
+    led_teardown();
+}
+
+static void test_isr_stats(void)
+{
+    iot_led_isr_stats_t isr_stats = {0};
+    ledc_sim_stats_t stats = {0};
+    uint32_t hist_count = 0;
+
+    led_setup(2);
+
+    TEST_ASSERT(iot_led_get_isr_stats(NULL, false) == ESP_ERR_INVALID_ARG);
+    TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_0, 255, 500) == ESP_OK);
+    TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_1, 128, 200) == ESP_OK);
+    run_until_idle(1000);
+    ledc_sim_get_stats(&stats);
+
+    TEST_ASSERT(iot_led_get_isr_stats(&isr_stats, true) == ESP_OK);
+    TEST_ASSERT(isr_stats.count == stats.isr_count);
+    TEST_ASSERT(isr_stats.cycles_min <= isr_stats.cycles_max);
+    TEST_ASSERT(isr_stats.cycles_total >= (uint64_t)isr_stats.cycles_max);
+    TEST_ASSERT(isr_stats.channels >= 500 / DUTY_SET_CYCLE + 200 / DUTY_SET_CYCLE);
+    TEST_ASSERT(isr_stats.channels_max == 2);
+    TEST_ASSERT(isr_stats.missed == 0);
+
+    for (int i = 0; i < IOT_LED_ISR_HIST_NUM; i++) {
+        hist_count += isr_stats.hist[i];
+    }
+
+    TEST_ASSERT(hist_count == isr_stats.count);
+
+    /**< An interrupt entered two and a half intervals late missed two alarms */
+    ledc_sim_clear_timeline();
+    ledc_sim_set_isr_latency(DUTY_SET_CYCLE * 2500);
+    TEST_ASSERT(iot_led_set_channel(LEDC_CHANNEL_0, 0, 100) == ESP_OK);
+    run_until_idle(1000);
+    ledc_sim_get_stats(&stats);
+
+    TEST_ASSERT(iot_led_get_isr_stats(&isr_stats, false) == ESP_OK);
+    TEST_ASSERT(isr_stats.count == stats.isr_count);
+    TEST_ASSERT(isr_stats.missed == 2 * isr_stats.count);
+    TEST_ASSERT(isr_stats.channels_max == 1);
+
+    led_teardown();
+}
+
+static void test_easing(void)
+{
+    /**< Each curve at half of the fade, from the formulas of easing_table.py */
+    const struct {
+        iot_led_easing_t easing;
+        double half;
+    } curves[] = {
+        {IOT_LED_EASE_LINEAR, 0.5},
+        {IOT_LED_EASE_SMOOTH, 0.5},
+        {IOT_LED_EASE_IN_CUBIC, 0.125},
+        {IOT_LED_EASE_OUT_CUBIC, 0.875},
+        {IOT_LED_EASE_IN_OUT_CUBIC, 0.5},
+        {IOT_LED_EASE_OUT_SINE, 0.7071},
+        {IOT_LED_EASE_IN_OUT_SINE, 0.5},
+        {IOT_LED_EASE_OUT_EXPO, 0.9697},
+        {IOT_LED_EASE_IN_OUT_EXPO, 0.5},
+        {IOT_LED_EASE_PERCEPTUAL, 0.2587},
+    };
+    const uint16_t target = UINT16_MAX;
+    uint16_t value = 0, last = 0;
+
+    led_setup(3);
+
+    for (int i = 0; i < sizeof(curves) / sizeof(curves[0]); i++) {
+        TEST_ASSERT(iot_led_set_channel16(LEDC_CHANNEL_0, 0, 0) == ESP_OK);
+        run_until_idle(100);
+        TEST_ASSERT(iot_led_set_channels16_ex(BIT(LEDC_CHANNEL_0), &target, 1000, curves[i].easing) == ESP_OK);
+        last = 0;
+
+        for (int ms = 0; ms < 1000; ms += DUTY_SET_CYCLE) {
+            ledc_sim_run_ms(DUTY_SET_CYCLE);
+            TEST_ASSERT(iot_led_get_channel16(LEDC_CHANNEL_0, &value) == ESP_OK);
+            TEST_ASSERT(value >= last);
+            last = value;
+
+            /**< The tick at 500 ms has run, 25 of 50 */
+            if (ms == 500) {
+                TEST_ASSERT(fabs(value / (double)UINT16_MAX - curves[i].half) < 0.02);
+            }
+        }
+
+        run_until_idle(100);
+        TEST_ASSERT(iot_led_get_channel16(LEDC_CHANNEL_0, &value) == ESP_OK);
+        TEST_ASSERT(value == target);
+    }
+
+    /**< The lightness curve runs backwards on a fade to off, half way is half the lightness again */
+    TEST_ASSERT(iot_led_set_channels16_ex(BIT(LEDC_CHANNEL_0), (const uint16_t[]) {0}, 1000, IOT_LED_EASE_PERCEPTUAL) == ESP_OK);
+    ledc_sim_run_ms(500 + DUTY_SET_CYCLE);
+    TEST_ASSERT(iot_led_get_channel16(LEDC_CHANNEL_0, &value) == ESP_OK);
+    TEST_ASSERT(fabs(value / (double)UINT16_MAX - 0.2587) < 0.02);
+    run_until_idle(1000);
+
+    /**< An eased hue fade reaches most of its brightness early too */
+    const ledc_channel_t channels[3] = {LEDC_CHANNEL_0, LEDC_CHANNEL_1, LEDC_CHANNEL_2};
+    TEST_ASSERT(iot_led_set_hsv_channels_ex(channels, 0, UINT16_MAX, UINT16_MAX, 1000, IOT_LED_EASE_OUT_CUBIC) == ESP_OK);
+    ledc_sim_run_ms(500 + DUTY_SET_CYCLE);
+    TEST_ASSERT(iot_led_get_channel16(LEDC_CHANNEL_0, &value) == ESP_OK);
+    TEST_ASSERT(fabs(value / (double)UINT16_MAX - 0.875) < 0.02);
+    run_until_idle(1000);
+    TEST_ASSERT(iot_led_get_channel16(LEDC_CHANNEL_0, &value) == ESP_OK);
+    TEST_ASSERT(value == UINT16_MAX);
+
+    TEST_ASSERT(iot_led_set_channels16_ex(BIT(LEDC_CHANNEL_0), &target, 1000, IOT_LED_EASE_MAX) == ESP_ERR_INVALID_ARG);
+
+    led_teardown();
+}
+
+static void bench(void)
+{
+    ledc_sim_stats_t stats = {0};
+    uint64_t steps = 0, updates = 0;
+
+    led_setup(LEDC_CHANNEL_MAX);
+    ledc_sim_clear_timeline();
+
+    for (int i = 0; i < BENCH_TRANSITIONS; i++) {
+        uint8_t values[LEDC_CHANNEL_MAX];
+
+        for (int j = 0; j < LEDC_CHANNEL_MAX; j++) {
+            values[j] = rand() % 256;
+        }
+
+        iot_led_set_channels(BIT(LEDC_CHANNEL_MAX) - 1, values, rand() % 1000);
+        ledc_sim_run_ms(rand() % 1000);
+    }
+
+    ledc_sim_get_stats(&stats);
+
+    for (int j = 0; j < LEDC_CHANNEL_MAX; j++) {
+        steps   += stats.steps[j];
+        updates += stats.updates[j];
+    }
+
+    printf("%d transitions of %d channels: %u interrupts, %.1f ns average, %.1f us max per interrupt (host)\n",
+           BENCH_TRANSITIONS, LEDC_CHANNEL_MAX, stats.isr_count, (double)stats.isr_ns / stats.isr_count,
+           stats.isr_max_ns / 1000.0);
+    printf("LEDC updates %.1f, hardware duty steps %.1f per channel and transition\n",
+           (double)updates / BENCH_TRANSITIONS / LEDC_CHANNEL_MAX, (double)steps / BENCH_TRANSITIONS / LEDC_CHANNEL_MAX);
+
+    led_teardown();
+}
+
+int main(int argc, char **argv)
+{
+    srand(1);
+
+    RUN_TEST(test_fade_reaches_target);
+    RUN_TEST(test_fade_monotonic);
+    RUN_TEST(test_hsv_fade_keeps_saturation);
+    RUN_TEST(test_program);
+    RUN_TEST(test_gamma_table);
+    RUN_TEST(test_calibration);
+    RUN_TEST(test_duty_resolution);
+    RUN_TEST(test_channel16);
+    RUN_TEST(test_dither);
+    RUN_TEST(test_hardware_fade);
+    RUN_TEST(test_easing);
+    RUN_TEST(test_hpoint);
+    RUN_TEST(test_isr_stats);
+
+    if (argc > 1) {
+        bench();
+    }
+
+    return TEST_RESULT();
+}
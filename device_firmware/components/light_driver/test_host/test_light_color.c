@@ -0,0 +1,361 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @brief Accuracy tests and micro-benchmark of light_color.c against the
+ *        percent/double based conversions it replaces in light_driver.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+
+#include "light_color.h"
+#include "test_host.h"
+
+#define BENCH_LOOPS (4 * 1000 * 1000)
+
+/**
+ * @brief Reference implementations copied from the previous light_driver.c
+ */
+static void legacy_hsv2rgb(uint16_t hue, uint8_t saturation, uint8_t value,
+                           uint8_t *red, uint8_t *green, uint8_t *blue)
+{
+    uint16_t hi = (hue / 60) % 6;
+    uint16_t F = 100 * hue / 60 - 100 * hi;
+    uint16_t P = value * (100 - saturation) / 100;
+    uint16_t Q = value * (10000 - F * saturation) / 10000;
+    uint16_t T = value * (10000 - saturation * (100 - F)) / 10000;
+
+    switch (hi) {
+        case 0: *red = value, *green = T, *blue = P; break;
+        case 1: *red = Q, *green = value, *blue = P; break;
+        case 2: *red = P, *green = value, *blue = T; break;
+        case 3: *red = P, *green = Q, *blue = value; break;
+        case 4: *red = T, *green = P, *blue = value; break;
+        default: *red = value, *green = P, *blue = Q; break;
+    }
+
+    *red   = *red * 255 / 100;
+    *green = *green * 255 / 100;
+    *blue  = *blue * 255 / 100;
+}
+
+static void legacy_rgb2hsv(uint16_t red, uint16_t green, uint16_t blue,
+                           uint16_t *h, uint8_t *s, uint8_t *v)
+{
+    double hue, saturation, value;
+    double m_max = MAX(red, MAX(green, blue));
+    double m_min = MIN(red, MIN(green, blue));
+    double m_delta = m_max - m_min;
+
+    value = m_max / 255.0;
+
+    if (m_delta == 0) {
+        hue = 0;
+        saturation = 0;
+    } else {
+        saturation = m_delta / m_max;
+
+        if (red == m_max) {
+            hue = (green - blue) / m_delta;
+        } else if (green == m_max) {
+            hue = 2 + (blue - red) / m_delta;
+        } else {
+            hue = 4 + (red - green) / m_delta;
+        }
+
+        hue = hue * 60;
+
+        if (hue < 0) {
+            hue = hue + 360;
+        }
+    }
+
+    *h = (int)(hue + 0.5);
+    *s = (int)(saturation * 100 + 0.5);
+    *v = (int)(value * 100 + 0.5);
+}
+
+/**
+ * @brief Exact HSV to RGB, all components in 0 .. 1, hue in degrees
+ */
+static void ideal_hsv2rgb(double hue, double saturation, double value, double rgb[3])
+{
+    double h6 = fmod(hue, 360.0) / 60.0;
+    int sector = (int)h6;
+    double f = h6 - sector;
+    double p = value * (1 - saturation);
+    double q = value * (1 - saturation * f);
+    double t = value * (1 - saturation * (1 - f));
+    const double table[6][3] = {
+        {value, t, p}, {q, value, p}, {p, value, t},
+        {p, q, value}, {t, p, value}, {value, p, q},
+    };
+
+    for (int i = 0; i < 3; i++) {
+        rgb[i] = table[sector][i];
+    }
+}
+
+static void test_hsv2rgb_accuracy(void)
+{
+    double legacy_max = 0, new_max = 0, new16_max = 0;
+
+    for (int hue = 0; hue <= 360; hue++) {
+        for (int saturation = 0; saturation <= 100; saturation++) {
+            for (int value = 0; value <= 100; value++) {
+                double ideal[3];
+                uint8_t legacy[3];
+                uint16_t out[3];
+
+                ideal_hsv2rgb(hue, saturation / 100.0, value / 100.0, ideal);
+                legacy_hsv2rgb(hue, saturation, value, &legacy[0], &legacy[1], &legacy[2]);
+                light_color_hsv2rgb(light_color_degree_to_hue(hue), light_color_percent_to_q16(saturation),
+                                    light_color_percent_to_q16(value), &out[0], &out[1], &out[2]);
+
+                for (int i = 0; i < 3; i++) {
+                    /**< The legacy code overflows at 360 degrees, compare its precision below that */
+                    if (hue < 360) {
+                        legacy_max = fmax(legacy_max, fabs(legacy[i] - ideal[i] * 255));
+                    }
+
+                    new_max    = fmax(new_max, fabs(light_color_q16_to_u8(out[i]) - ideal[i] * 255));
+                    new16_max  = fmax(new16_max, fabs(out[i] - ideal[i] * LIGHT_COLOR_MAX));
+                }
+            }
+        }
+    }
+
+    printf("hsv2rgb max error: legacy %.3f LSB8, fixed-point %.3f LSB8 (%.3f LSB16)\n",
+           legacy_max, new_max, new16_max);
+
+    TEST_ASSERT(new_max <= 0.52);
+    TEST_ASSERT(new16_max <= 4.0);
+    TEST_ASSERT(new_max < legacy_max);
+}
+
+static void test_rgb2hsv_round_trip(void)
+{
+    int legacy_max = 0, new_max = 0, new16_max = 0;
+
+    for (int red = 0; red < 256; red++) {
+        for (int green = 0; green < 256; green++) {
+            for (int blue = 0; blue < 256; blue++) {
+                const int in[3] = {red, green, blue};
+                uint16_t hue, saturation, value, rgb16[3];
+                uint16_t degree;
+                uint8_t percent_s, percent_v, legacy[3];
+
+                light_color_rgb2hsv(light_color_u8_to_q16(red), light_color_u8_to_q16(green),
+                                    light_color_u8_to_q16(blue), &hue, &saturation, &value);
+                light_color_hsv2rgb(hue, saturation, value, &rgb16[0], &rgb16[1], &rgb16[2]);
+
+                legacy_rgb2hsv(red, green, blue, &degree, &percent_s, &percent_v);
+                legacy_hsv2rgb(degree % 360, percent_s, percent_v, &legacy[0], &legacy[1], &legacy[2]);
+
+                for (int i = 0; i < 3; i++) {
+                    legacy_max = MAX(legacy_max, abs(legacy[i] - in[i]));
+                    new_max    = MAX(new_max, abs(light_color_q16_to_u8(rgb16[i]) - in[i]));
+                    new16_max  = MAX(new16_max, abs(rgb16[i] - light_color_u8_to_q16(in[i])));
+                }
+            }
+        }
+    }
+
+    printf("rgb -> hsv -> rgb max error: legacy %d LSB8, fixed-point %d LSB8 (%d LSB16)\n",
+           legacy_max, new_max, new16_max);
+
+    TEST_ASSERT(new_max == 0);
+    /**< One step of the 16-bit hue moves a component by up to 6 LSB16 */
+    TEST_ASSERT(new16_max <= 6);
+}
+
+static void test_ctb_round_trip(void)
+{
+    int ct_max = 0, brightness_max = 0;
+
+    for (uint32_t brightness = 0; brightness <= LIGHT_COLOR_MAX; brightness += 37) {
+        for (uint32_t ct = 0; ct <= LIGHT_COLOR_MAX; ct += 41) {
+            uint16_t warm, cold, ct_out, brightness_out;
+
+            light_color_ctb2cw(ct, brightness, &warm, &cold);
+            light_color_cw2ctb(warm, cold, &ct_out, &brightness_out);
+
+            brightness_max = MAX(brightness_max, abs((int)brightness_out - (int)brightness));
+
+            /**< Color temperature of a dark light is only defined to the LSB of warm and cold */
+            if (brightness >= LIGHT_COLOR_MAX / 4) {
+                ct_max = MAX(ct_max, abs((int)ct_out - (int)ct));
+            }
+        }
+    }
+
+    printf("ctb -> cw -> ctb max error: brightness %d LSB16, color temperature %d LSB16\n",
+           brightness_max, ct_max);
+
+    TEST_ASSERT(brightness_max <= 3);
+    TEST_ASSERT(ct_max <= 8);
+}
+
+static void test_rgb2rgbw(void)
+{
+    const uint16_t warm_point[3] = {65535, 27714, 6517};
+    const uint16_t cold_point[3] = {65535, 61875, 65000};
+    int error_max = 0;
+
+    /**< The white points themselves go entirely to their LED */
+    uint16_t rgb[3] = {warm_point[0], warm_point[1], warm_point[2]};
+    uint16_t warm, cold;
+    light_color_rgb2rgbw(rgb, warm_point, cold_point, &warm, &cold);
+    TEST_ASSERT(warm == LIGHT_COLOR_MAX && cold == 0);
+    TEST_ASSERT(rgb[0] + rgb[1] + rgb[2] == 0);
+
+    rgb[0] = cold_point[0] / 2, rgb[1] = cold_point[1] / 2, rgb[2] = cold_point[2] / 2;
+    light_color_rgb2rgbw(rgb, warm_point, cold_point, &warm, &cold);
+    TEST_ASSERT(warm == 0 && abs((int)cold - LIGHT_COLOR_MAX / 2) <= 1);
+    TEST_ASSERT(rgb[0] + rgb[1] + rgb[2] <= 3);
+
+    /**< Saturated colours hold no white */
+    rgb[0] = LIGHT_COLOR_MAX, rgb[1] = 0, rgb[2] = 0;
+    light_color_rgb2rgbw(rgb, warm_point, cold_point, &warm, &cold);
+    TEST_ASSERT(warm == 0 && cold == 0 && rgb[0] == LIGHT_COLOR_MAX);
+
+    /**< Whites and what is left add up to the colour, never above it */
+    for (uint32_t i = 0; i < 200000; i++) {
+        uint16_t in[3] = {i * 2654435761U >> 16, i * 40503U, i * 9973U};
+        uint16_t out[3] = {in[0], in[1], in[2]};
+
+        light_color_rgb2rgbw(out, warm_point, cold_point, &warm, &cold);
+
+        for (int c = 0; c < 3; c++) {
+            int sum = out[c] + (((uint32_t)warm_point[c] * warm + 0x8000) >> 16)
+                      + (((uint32_t)cold_point[c] * cold + 0x8000) >> 16);
+            error_max = MAX(error_max, abs(sum - (int)in[c]));
+        }
+    }
+
+    printf("rgb -> rgbw max error: %d LSB16\n", error_max);
+
+    TEST_ASSERT(error_max <= 2);
+}
+
+static void test_kelvin2cw(void)
+{
+    uint16_t kelvin_min = 0, kelvin_max = 0, warm = 0, cold = 0, last_warm = 0;
+    int sum_max = 0, round_trip_max = 0, inverse_max = 0, brightness_max = 0;
+
+    light_color_kelvin_range(&kelvin_min, &kelvin_max);
+    TEST_ASSERT(kelvin_min < kelvin_max);
+
+    /**< Each end is one LED alone, beyond them the output is clamped */
+    light_color_kelvin2cw(kelvin_min, &warm, &cold);
+    TEST_ASSERT(warm == LIGHT_COLOR_MAX && cold == 0);
+    light_color_kelvin2cw(kelvin_max + 1000, &warm, &cold);
+    TEST_ASSERT(warm == 0 && cold == LIGHT_COLOR_MAX);
+
+    /**< Warmer only ever adds warm, and LEDs of equal flux always add up to full brightness */
+    for (uint32_t kelvin = kelvin_max; kelvin >= kelvin_min; kelvin--) {
+        light_color_kelvin2cw(kelvin, &warm, &cold);
+        TEST_ASSERT(warm >= last_warm);
+        last_warm = warm;
+        sum_max = MAX(sum_max, abs((int)warm + (int)cold - LIGHT_COLOR_MAX));
+
+        uint16_t kelvin_out = light_color_q16_to_kelvin(light_color_kelvin_to_q16(kelvin));
+        round_trip_max = MAX(round_trip_max, abs((int)kelvin_out - (int)kelvin));
+
+        /**< Back from the output dimmed to 40 % */
+        uint16_t brightness = 0;
+        light_color_cw2kelvin(warm * 2 / 5, cold * 2 / 5, &kelvin_out, &brightness);
+        inverse_max = MAX(inverse_max, abs((int)kelvin_out - (int)kelvin));
+        brightness_max = MAX(brightness_max, abs((int)brightness - LIGHT_COLOR_MAX * 2 / 5));
+    }
+
+    /**< Half way in mired the mix is not an even split of the flux, as the linear split assumed */
+    light_color_kelvin2cw(light_color_q16_to_kelvin(LIGHT_COLOR_MAX / 2), &warm, &cold);
+    printf("kelvin2cw: half way %d K, warm %d, cold %d, sum error %d LSB16, round trip %d K\n",
+           light_color_q16_to_kelvin(LIGHT_COLOR_MAX / 2), warm, cold, sum_max, round_trip_max);
+    printf("cw2kelvin: max error %d K, brightness %d LSB16\n", inverse_max, brightness_max);
+
+    TEST_ASSERT(sum_max <= 1);
+    TEST_ASSERT(round_trip_max <= 1);
+    TEST_ASSERT(inverse_max <= 2 && brightness_max <= 3);
+    TEST_ASSERT(warm > LIGHT_COLOR_MAX * 52 / 100 && warm < LIGHT_COLOR_MAX * 57 / 100);
+}
+
+static double bench_seconds(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void bench(void)
+{
+    struct timespec start;
+    volatile uint32_t sink = 0;
+    uint8_t r8, g8, b8, s8, v8;
+    uint16_t r, g, b, h, s, v;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t i = 0; i < BENCH_LOOPS; i++) {
+        legacy_hsv2rgb(i % 361, i % 101, (i >> 3) % 101, &r8, &g8, &b8);
+        sink += r8 + g8 + b8;
+    }
+    double legacy_hsv = bench_seconds(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t i = 0; i < BENCH_LOOPS; i++) {
+        light_color_hsv2rgb(i * 2654435761U, i * 40503U, i * 9973U, &r, &g, &b);
+        sink += r + g + b;
+    }
+    double new_hsv = bench_seconds(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t i = 0; i < BENCH_LOOPS; i++) {
+        legacy_rgb2hsv(i & 0xFF, (i >> 8) & 0xFF, (i >> 16) & 0xFF, &h, &s8, &v8);
+        sink += h + s8 + v8;
+    }
+    double legacy_rgb = bench_seconds(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t i = 0; i < BENCH_LOOPS; i++) {
+        light_color_rgb2hsv(i * 257, (i >> 8) * 257, (i >> 16) * 257, &h, &s, &v);
+        sink += h + s + v;
+    }
+    double new_rgb = bench_seconds(&start);
+
+    printf("hsv2rgb: legacy %.1f ns, fixed-point %.1f ns per call\n",
+           legacy_hsv * 1e9 / BENCH_LOOPS, new_hsv * 1e9 / BENCH_LOOPS);
+    printf("rgb2hsv: legacy %.1f ns, fixed-point %.1f ns per call (host FPU, the ESP32-C3 emulates double)\n",
+           legacy_rgb * 1e9 / BENCH_LOOPS, new_rgb * 1e9 / BENCH_LOOPS);
+    (void)sink;
+}
+
+int main(int argc, char **argv)
+{
+    RUN_TEST(test_hsv2rgb_accuracy);
+    RUN_TEST(test_rgb2hsv_round_trip);
+    RUN_TEST(test_ctb_round_trip);
+    RUN_TEST(test_rgb2rgbw);
+    RUN_TEST(test_kelvin2cw);
+
+    if (argc > 1) {
+        bench();
+    }
+
+    return TEST_RESULT();
+}
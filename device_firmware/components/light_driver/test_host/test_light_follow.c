@@ -0,0 +1,143 @@
+// Copyright 2017 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @brief Tests of the dead reckoning of light_follow.c
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "light_follow.h"
+#include "test_host.h"
+
+#define STREAM_INTERVAL_US (50 * 1000)
+#define STREAM_MAX_RATE    (250)
+
+static light_follow_point_t point_hsv(uint16_t hue, uint16_t saturation, uint16_t value)
+{
+    light_follow_point_t point = {{0}};
+
+    point.field[LIGHT_FOLLOW_HUE]        = hue;
+    point.field[LIGHT_FOLLOW_SATURATION] = saturation;
+    point.field[LIGHT_FOLLOW_VALUE]      = value;
+
+    return point;
+}
+
+/**
+ * @brief Send a stream of value commands without a transition, 5 % every 50 ms from value
+ *
+ * @return Time of the last command
+ */
+static int64_t send_stream(light_follow_t *follow, int64_t now_us, uint16_t value, int count)
+{
+    light_follow_point_t point, output;
+
+    for (int i = 0; i < count; ++i, now_us += STREAM_INTERVAL_US, value += 5) {
+        uint32_t fade_ms = 100;
+        point = point_hsv(0, 100, value);
+        bool followed = light_follow_update(follow, now_us, false, true, &point, &output, &fade_ms);
+        TEST_ASSERT(followed == (i > 0));
+    }
+
+    return now_us - STREAM_INTERVAL_US;
+}
+
+static void test_stream_is_predicted(void)
+{
+    light_follow_t follow = {0};
+    light_follow_point_t point = point_hsv(0, 100, 40), output;
+    uint32_t fade_ms = 100;
+
+    light_follow_config(&follow, true, STREAM_MAX_RATE);
+    int64_t now_us = send_stream(&follow, 1000 * 1000, 10, 6);
+
+    /**< The next step of the ramp is ahead of the command, by no more than one step */
+    now_us += STREAM_INTERVAL_US;
+    TEST_ASSERT(light_follow_update(&follow, now_us, false, true, &point, &output, &fade_ms));
+    TEST_ASSERT(output.field[LIGHT_FOLLOW_VALUE] > 40 && output.field[LIGHT_FOLLOW_VALUE] <= 45);
+    TEST_ASSERT(fade_ms >= STREAM_INTERVAL_US / 1000 / 2 && fade_ms < 100);
+    TEST_ASSERT(follow.active);
+
+    /**< The end of the stream is settled on the last command */
+    TEST_ASSERT(light_follow_settle(&follow, &point, &fade_ms));
+    TEST_ASSERT(!light_follow_settle(&follow, &point, &fade_ms));
+}
+
+static void test_explicit_transition_wins(void)
+{
+    light_follow_t follow = {0};
+    light_follow_point_t point = point_hsv(120, 100, 80), output;
+
+    light_follow_config(&follow, true, STREAM_MAX_RATE);
+    int64_t now_us = send_stream(&follow, 1000 * 1000, 10, 6);
+
+    /**< A 0 ms command during the stream is applied at once, as it is */
+    uint32_t fade_ms = 0;
+    now_us += STREAM_INTERVAL_US;
+    TEST_ASSERT(!light_follow_update(&follow, now_us, true, true, &point, &output, &fade_ms));
+    TEST_ASSERT(fade_ms == 0);
+    TEST_ASSERT(!memcmp(&output, &point, sizeof(point)));
+    TEST_ASSERT(!follow.active);
+
+    /**< And the settle of the stream does not move the light afterwards */
+    TEST_ASSERT(!light_follow_settle(&follow, &point, &fade_ms));
+    TEST_ASSERT(fade_ms == 0);
+
+    /**< A following command without a transition starts a new stream from it */
+    fade_ms = 100;
+    now_us += STREAM_INTERVAL_US;
+    TEST_ASSERT(light_follow_update(&follow, now_us, false, true, &point, &output, &fade_ms));
+    TEST_ASSERT(!memcmp(&output, &point, sizeof(point)));
+}
+
+static void test_stream_ends(void)
+{
+    light_follow_t follow = {0};
+    light_follow_point_t point = point_hsv(0, 100, 50), output;
+    uint32_t fade_ms = 100;
+
+    /**< Disabled, nothing is followed */
+    light_follow_config(&follow, false, STREAM_MAX_RATE);
+    TEST_ASSERT(!light_follow_update(&follow, 1000, false, true, &point, &output, &fade_ms));
+    TEST_ASSERT(!light_follow_update(&follow, 2000, false, true, &point, &output, &fade_ms));
+    TEST_ASSERT(fade_ms == 100);
+
+    /**< A pause longer than the timeout, or a mode change, starts over */
+    light_follow_config(&follow, true, STREAM_MAX_RATE);
+    int64_t now_us = send_stream(&follow, 1000 * 1000, 10, 3);
+    now_us += LIGHT_FOLLOW_TIMEOUT_MS * 1000;
+    TEST_ASSERT(!light_follow_update(&follow, now_us, false, true, &point, &output, &fade_ms));
+    now_us += STREAM_INTERVAL_US;
+    TEST_ASSERT(!light_follow_update(&follow, now_us, false, false, &point, &output, &fade_ms));
+    TEST_ASSERT(fade_ms == 100);
+
+    /**< Hue takes the shorter arc across 0 */
+    now_us = send_stream(&follow, now_us + 1000 * 1000, 10, 1);
+    point = point_hsv(350, 100, 10);
+    now_us += STREAM_INTERVAL_US;
+    TEST_ASSERT(light_follow_update(&follow, now_us, false, true, &point, &output, &fade_ms));
+    TEST_ASSERT(output.field[LIGHT_FOLLOW_HUE] >= 340 && output.field[LIGHT_FOLLOW_HUE] <= 350);
+}
+
+int main(int argc, char **argv)
+{
+    RUN_TEST(test_stream_is_predicted);
+    RUN_TEST(test_explicit_transition_wins);
+    RUN_TEST(test_stream_ends);
+
+    return TEST_RESULT();
+}
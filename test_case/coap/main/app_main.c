@@ -24,6 +24,9 @@
 #include "lwip/err.h"
 #include "lwip/sys.h"
 
+#include "cJSON.h"
+#include "light_driver.h"
+
 #include "app_priv.h"
 #if 1
 /* Needed until coap_dtls.h becomes a part of libcoap proper */
@@ -131,6 +134,31 @@ static void wifi_station_initialize(void)
 }
 
 static char buf[100] = "{\"status\": true}";
+
+// 解析 {"status": true, "transition": 500} 格式的数据并控制灯，transition (ms) 可选
+static esp_err_t app_light_parse(const char *json)
+{
+    esp_err_t ret = ESP_ERR_INVALID_ARG;
+    cJSON *root = cJSON_Parse(json);
+    if (!root) {
+        return ret;
+    }
+
+    const cJSON *status = cJSON_GetObjectItem(root, "status");
+    const cJSON *transition = cJSON_GetObjectItem(root, "transition");
+    if (cJSON_IsBool(status)) {
+        uint32_t transition_ms = LIGHT_TRANSITION_DEFAULT;
+        if (cJSON_IsNumber(transition) && transition->valueint >= 0) {
+            transition_ms = (transition->valueint > TRANSITION_MAX) ? TRANSITION_MAX : transition->valueint;
+        }
+        app_driver_set_state_ex(cJSON_IsTrue(status), transition_ms);
+        ret = ESP_OK;
+    }
+
+    cJSON_Delete(root);
+    return ret;
+}
+
 // CoAP GET 方法回调处理函数
 static void esp_coap_get(coap_context_t *ctx, coap_resource_t *resource,
                   coap_session_t *session,
@@ -160,15 +188,23 @@ static void esp_coap_put(coap_context_t *ctx,
     /* 读取收到的 CoAP 数据 */
     (void)coap_get_data(request, &size, &data);
 
-    if (size) {
+    if (size && size < sizeof(buf)) {
         if (strncmp((char *)data, buf, size)) {
-            memcpy(buf, data, size);
-            buf[size] = 0;
-            response->code = COAP_RESPONSE_CODE(204);
+            /* 先解析临时缓冲区, 解析成功后才更新 GET 返回的状态 */
+            char payload[sizeof(buf)];
+            memcpy(payload, data, size);
+            payload[size] = 0;
+
+            if (app_light_parse(payload) == ESP_OK) {
+                memcpy(buf, payload, size + 1);
+                response->code = COAP_RESPONSE_CODE(204);
+            } else {
+                response->code = COAP_RESPONSE_CODE(400);
+            }
         } else {
             response->code = COAP_RESPONSE_CODE(500);
         }
-    } else { /* size 为 0 表示接收错误 */
+    } else { /* size 为 0 表示接收错误, 过长的数据也无法保存 */
         response->code = COAP_RESPONSE_CODE(500);
     }
 }
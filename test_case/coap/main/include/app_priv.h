@@ -15,6 +15,8 @@
 #ifndef __APP_PRIVATE_H__
 #define __APP_PRIVATE_H__
 
+#define TRANSITION_MAX      10000   /**< ms, longest fade a client may ask for */
+
 /**
  * @brief 
  * 
@@ -29,6 +31,15 @@ void app_driver_init(void);
  */
 int app_driver_set_state(bool state);
 
+/**
+ * @brief 
+ * 
+ * @param state 
+ * @param transition_ms fade time of this change, LIGHT_TRANSITION_DEFAULT for the configured one
+ * @return int 
+ */
+int app_driver_set_state_ex(bool state, uint32_t transition_ms);
+
 /**
  * @brief 
  * 
@@ -63,17 +63,22 @@ void app_driver_init()
 }
 
 int IRAM_ATTR app_driver_set_state(bool state)
+{
+    return app_driver_set_state_ex(state, LIGHT_TRANSITION_DEFAULT);
+}
+
+int app_driver_set_state_ex(bool state, uint32_t transition_ms)
 {
     if (g_output_state != state) {
         g_output_state = state;
         if (g_output_state) {
             // light on
             ESP_LOGI(TAG, "Light ON");
-            light_driver_set_switch(true);
+            light_driver_set_switch_ex(true, transition_ms);
         } else {
             // light off
             ESP_LOGI(TAG, "Light OFF");
-            light_driver_set_switch(false);
+            light_driver_set_switch_ex(false, transition_ms);
         }
     }
     return ESP_OK;
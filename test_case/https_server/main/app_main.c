@@ -25,6 +25,9 @@
 #include "lwip/sys.h"
 
 #include "app_storage.h"
+#include "cJSON.h"
+#include "light_driver.h"
+
 #include "app_priv.h"
 #include <esp_https_server.h>
 
@@ -127,6 +130,31 @@ static void wifi_station_initialize(void)
 }
 
 static char buf[100] = "{\"status\": true}";
+
+// 解析 {"status": true, "transition": 500} 格式的数据并控制灯，transition (ms) 可选
+static esp_err_t app_light_parse(const char *json)
+{
+    esp_err_t ret = ESP_ERR_INVALID_ARG;
+    cJSON *root = cJSON_Parse(json);
+    if (!root) {
+        return ret;
+    }
+
+    const cJSON *status = cJSON_GetObjectItem(root, "status");
+    const cJSON *transition = cJSON_GetObjectItem(root, "transition");
+    if (cJSON_IsBool(status)) {
+        uint32_t transition_ms = LIGHT_TRANSITION_DEFAULT;
+        if (cJSON_IsNumber(transition) && transition->valueint >= 0) {
+            transition_ms = (transition->valueint > TRANSITION_MAX) ? TRANSITION_MAX : transition->valueint;
+        }
+        app_driver_set_state_ex(cJSON_IsTrue(status), transition_ms);
+        ret = ESP_OK;
+    }
+
+    cJSON_Delete(root);
+    return ret;
+}
+
 // HTTP GET 请求回调处理函数
 static esp_err_t esp_light_get_handler(httpd_req_t *req)
 {
@@ -139,10 +167,14 @@ static esp_err_t esp_light_get_handler(httpd_req_t *req)
 static esp_err_t esp_light_set_handler(httpd_req_t *req)
 {
     int ret, remaining = req->content_len;
-    memset(buf, 0 ,sizeof(buf));
+    char content[sizeof(buf)] = {0};
+    if (remaining >= (int)sizeof(content)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Content too long");
+        return ESP_FAIL;
+    }
     while (remaining > 0) {
         // 读取 http 请求数据
-        if ((ret = httpd_req_recv(req, buf, remaining)) <= 0) {
+        if ((ret = httpd_req_recv(req, content + req->content_len - remaining, remaining)) <= 0) {
             if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
                 continue;
             }
@@ -150,8 +182,14 @@ static esp_err_t esp_light_set_handler(httpd_req_t *req)
         }
         remaining -= ret;
     }
-    ESP_LOGI(TAG, "%.*s", req->content_len, buf);
-    // TODO: 读到数据后解析并且操作灯
+    ESP_LOGI(TAG, "%.*s", req->content_len, content);
+    // 读到数据后解析并且操作灯, 解析成功后才更新 GET 返回的状态
+    if (app_light_parse(content) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid light status");
+        return ESP_FAIL;
+    }
+    memcpy(buf, content, sizeof(buf));
+    httpd_resp_send(req, NULL, 0);
     return ESP_OK;
 }
 